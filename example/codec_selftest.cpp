@@ -0,0 +1,103 @@
+#include <Arduino.h>
+#include "Megaphone/AudioCodec.hpp"
+
+// 解码器自检：和参考向量逐位比较，并验证分段解码与一次解码结果一致
+// 参考向量由 Python audioop(adpcm2lin / ulaw2lin / alaw2lin) 生成
+
+// IMA-ADPCM(无包头，初始状态 0/0，低 4 位在前)
+static const uint8_t kImaInput[8] = {112, 243, 24, 41, 198, 81, 14, 132};
+static const int16_t kImaExpected[16] = {0, 11, 25, 0, -3, 7, -2, 11, 44, 3, 19, 75, -22, -9, 100, 86};
+
+struct G711Vector {
+    uint8_t code;
+    int16_t muLaw;
+    int16_t aLaw;
+};
+static const G711Vector kG711Vectors[] = {
+    {0x00, -32124, -5504},
+    {0x80, 32124, 5504},
+    {0xFF, 0, 848},
+    {0x7F, 0, -848},
+    {0xD5, 716, 8},
+    {0x55, -716, -8},
+    {0xAA, 5372, 32256},
+    {0x2A, -5372, -32256},
+};
+
+static int failures = 0;
+
+static void check(bool ok, const char* what) {
+    if (!ok) {
+        failures++;
+        Serial.printf("FAIL: %s\n", what);
+    }
+}
+
+static void testImaAdpcm() {
+    int16_t out[16];
+    size_t used = 0;
+
+    // 一次解码
+    ImaAdpcmDecoder one(false);
+    size_t n = one.decode(kImaInput, sizeof(kImaInput), used, out, 16);
+    check(n == 16 && used == sizeof(kImaInput), "ima length");
+    check(memcmp(out, kImaExpected, sizeof(out)) == 0, "ima reference vector");
+
+    // 每次只给 1 个输出位置(模拟缓冲区回绕)，结果必须一致
+    ImaAdpcmDecoder split(false);
+    size_t total = 0, offset = 0;
+    while (total < 16) {
+        size_t got = split.decode(kImaInput + offset, sizeof(kImaInput) - offset, used, out + total, 1);
+        if (got == 0 && used == 0) break;
+        total += got;
+        offset += used;
+    }
+    check(total == 16 && memcmp(out, kImaExpected, sizeof(out)) == 0, "ima split decode");
+
+    // 带包头: 预测值 1000、步长序号 20，包头本身输出一个采样
+    static const uint8_t kPacket[6] = {0xE8, 0x03, 20, 0x00, kImaInput[0], kImaInput[1]};
+    static const int16_t kPacketExpected[5] = {1000, 1006, 1089, 1173, 1008};
+    ImaAdpcmDecoder block(true);
+    block.startPacket();
+    check(block.maxOutput(sizeof(kPacket)) == 5, "ima block max output");
+    n = block.decode(kPacket, sizeof(kPacket), used, out, 16);
+    check(n == 5 && memcmp(out, kPacketExpected, sizeof(kPacketExpected)) == 0, "ima block reference vector");
+}
+
+static void testG711() {
+    G711Decoder mu(CodecType::MuLaw);
+    G711Decoder a(CodecType::ALaw);
+    for (size_t i = 0; i < sizeof(kG711Vectors) / sizeof(kG711Vectors[0]); i++) {
+        int16_t m, l;
+        size_t used;
+        mu.decode(&kG711Vectors[i].code, 1, used, &m, 1);
+        a.decode(&kG711Vectors[i].code, 1, used, &l, 1);
+        check(m == kG711Vectors[i].muLaw, "mu-law reference vector");
+        check(l == kG711Vectors[i].aLaw, "a-law reference vector");
+    }
+
+    // 查找表与 ITU 参考算法逐个码字比较
+    uint8_t codes[256];
+    int16_t outMu[256], outA[256];
+    for (int i = 0; i < 256; i++) codes[i] = (uint8_t)i;
+    size_t used;
+    mu.decode(codes, 256, used, outMu, 256);
+    a.decode(codes, 256, used, outA, 256);
+    for (int i = 0; i < 256; i++) {
+        check(outMu[i] == G711Decoder::muLawToLinear((uint8_t)i), "mu-law table");
+        check(outA[i] == G711Decoder::aLawToLinear((uint8_t)i), "a-law table");
+    }
+}
+
+void setup() {
+    Serial.begin(115200);
+    delay(1000); // 等待串口初始化
+
+    testImaAdpcm();
+    testG711();
+    Serial.printf("Codec self-test: %s (%d failures)\n", failures == 0 ? "PASS" : "FAIL", failures);
+}
+
+void loop() {
+    delay(1000);
+}
@@ -0,0 +1,44 @@
+#include <Arduino.h>
+#include "Megaphone/Megaphone.hpp"
+#include "Megaphone/FileSource.hpp"
+
+// 非阻塞播放 SPIFFS 里的提示音：play() 立即返回，预读任务在后台读文件
+// 按下按键播放 /chime.wav，播放期间 loop() 不受影响
+
+Megaphone megaphone;
+FileSource prompts(megaphone, SPIFFS);
+
+void onPromptDone(void* context) {
+    Serial.printf("提示音播放完成, t=%lu ms\n", millis());
+}
+
+void setup() {
+    Serial.begin(115200);
+    delay(1000); // 等待串口初始化
+
+    // 文件系统只在启动时挂载一次
+    if (!SPIFFS.begin(true)) {
+        Serial.println("Failed to mount SPIFFS");
+        while (1) { delay(1000); }
+    }
+    if (!megaphone.begin() || !prompts.begin()) {
+        Serial.println("Megaphone initialization failed.");
+        while (1) { delay(1000); }
+    }
+    megaphone.startWriterTask();
+    megaphone.setVolume(0.3f);
+
+    prompts.play("/startup.wav", Megaphone_PRIORITY_HIGH, 1.0f, onPromptDone);
+    pinMode(0, INPUT_PULLUP);
+}
+
+void loop() {
+    if (digitalRead(0) == LOW) {
+        unsigned long t0 = millis();
+        prompts.stop();             // 打断上一个提示音
+        prompts.play("/chime.wav", Megaphone_PRIORITY_HIGH, 1.0f, onPromptDone);
+        Serial.printf("play() 返回用时 %lu ms\n", millis() - t0);
+        while (digitalRead(0) == LOW) { delay(10); }
+    }
+    delay(20);
+}
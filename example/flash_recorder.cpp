@@ -0,0 +1,40 @@
+#include <Arduino.h>
+#include "MicRecorder/MicRecorder.hpp"
+#include "MicRecorder/FlashRecorder.hpp"
+
+// 按下按键录音，松开后保存为 /rec.wav，用于排查现场 STT 识别失败的问题
+
+MicRecorder recorder;
+FlashRecorder flashRecorder(SPIFFS);
+
+void setup() {
+    Serial.begin(115200);
+    delay(1000); // 等待串口初始化
+
+    if (!SPIFFS.begin(true)) {
+        Serial.println("Failed to mount SPIFFS");
+        while (1) { delay(1000); }
+    }
+    if (!recorder.begin()) {
+        Serial.println("MicRecorder initialization failed.");
+        while (1) { delay(1000); }
+    }
+
+    pinMode(0, INPUT_PULLUP);
+    recorder.startRecording();
+    // 采集任务每读到一块数据就交给 FlashRecorder，写 flash 在低优先级任务中进行
+    recorder.setCaptureCallback(FlashRecorder::captureTap, &flashRecorder);
+}
+
+void loop() {
+    bool pressed = digitalRead(0) == LOW;
+
+    if (pressed && !flashRecorder.isActive()) {
+        flashRecorder.start("/rec.wav", MicRecorder_DEFAULT_SAMPLE_RATE);
+    }
+    else if (!pressed && flashRecorder.isActive()) {
+        flashRecorder.stop();
+        recorder.printStats(); // 确认录音期间没有出现采集溢出
+    }
+    delay(20);
+}
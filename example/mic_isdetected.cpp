@@ -14,6 +14,8 @@ void setup() {
         while (1) delay(1000);
     }
     Serial.println("MicRecorder initialized successfully.");
+    // 启动后台采集，isVoiceDetected() 读取的是采集路径持续更新的缓存值
+    mic.startRecording();
 }
 
 void loop() {
@@ -24,4 +26,5 @@ void loop() {
     else {
         Serial.println("No voice detected.");
     }
+    delay(50);
 }
\ No newline at end of file
@@ -0,0 +1,77 @@
+#include <Arduino.h>
+#include "Megaphone/Megaphone.hpp"
+#include "Megaphone/OpusStreamDecoder.hpp"
+
+// Opus 解码开销测试：在设备上把 5 秒合成语音编码成 24 kbit/s、20ms 帧，
+// 再按实时速度推给 OpusStreamDecoder 播放，每隔一段时间模拟一次丢包，最后打印解码耗时和 CPU 占用
+
+#define SAMPLE_RATE   16000
+#define FRAME_SAMPLES (SAMPLE_RATE / 50)
+#define TOTAL_FRAMES  250
+
+Megaphone megaphone;
+OpusStreamDecoder opusDecoder(megaphone);
+
+// 带音高起伏和包络的合成元音，比纯正弦更接近语音的编码负载
+static void synthFrame(int16_t* out, int frame) {
+    static float phase = 0.0f;
+    for (int i = 0; i < FRAME_SAMPLES; i++) {
+        float t = (float)(frame * FRAME_SAMPLES + i) / SAMPLE_RATE;
+        float f0 = 140.0f + 40.0f * sinf(2.0f * PI * 0.7f * t);
+        phase += 2.0f * PI * f0 / SAMPLE_RATE;
+        float env = 0.5f + 0.5f * sinf(2.0f * PI * 3.0f * t);
+        float v = sinf(phase) + 0.5f * sinf(2.0f * phase) + 0.25f * sinf(3.0f * phase);
+        out[i] = (int16_t)(6000.0f * env * v);
+    }
+}
+
+void onDone(void* context) {
+    Serial.println("Playback finished");
+    opusDecoder.printStats();
+}
+
+void setup() {
+    Serial.begin(115200);
+    delay(1000); // 等待串口初始化
+
+    if (!megaphone.begin() || !opusDecoder.begin(SAMPLE_RATE)) {
+        Serial.println("Initialization failed.");
+        while (1) { delay(1000); }
+    }
+    megaphone.startWriterTask();
+    megaphone.setVolume(0.2f);
+
+    int err = 0;
+    OpusEncoder* encoder = opus_encoder_create(SAMPLE_RATE, 1, OPUS_APPLICATION_VOIP, &err);
+    if (!encoder) {
+        Serial.printf("opus_encoder_create failed: %s\n", opus_strerror(err));
+        while (1) { delay(1000); }
+    }
+    opus_encoder_ctl(encoder, OPUS_SET_BITRATE(24000));
+    opus_encoder_ctl(encoder, OPUS_SET_COMPLEXITY(2));
+
+    int16_t pcm[FRAME_SAMPLES];
+    uint8_t packet[OpusStream_MAX_PACKET_BYTES];
+    uint32_t totalBytes = 0;
+    for (int frame = 0; frame < TOTAL_FRAMES; frame++) {
+        synthFrame(pcm, frame);
+        int len = opus_encode(encoder, pcm, FRAME_SAMPLES, packet, sizeof(packet));
+        if (len <= 0)
+            continue;
+        totalBytes += len;
+        // 每 50 帧丢一个包，由序号跳跃触发 PLC
+        if (frame % 50 != 49) {
+            opusDecoder.pushPacket(packet, len, frame);
+        }
+        delay(20); // 按实时速度推送
+    }
+    opus_encoder_destroy(encoder);
+    opusDecoder.endOfStream(onDone);
+
+    Serial.printf("Encoded %d frames, %u bytes (%u bit/s)\n",
+                  TOTAL_FRAMES, totalBytes, totalBytes * 8 * 50 / TOTAL_FRAMES);
+}
+
+void loop() {
+    delay(1000);
+}
@@ -0,0 +1,142 @@
+#include <Arduino.h>
+#include "AudioMemory/AudioMemory.hpp"
+#include "Megaphone/PcmRingBuffer.hpp"
+
+// 对比旧的 malloc + FreeRTOS 队列 与 PcmRingBuffer 的吞吐量和最坏延迟
+// 生产者/消费者分别运行在两个核上，模拟 websocket 回调和 i2sWriterTask，不接 I2S
+
+#define BENCH_CHUNK_SAMPLES 1024
+#define BENCH_CHUNKS        2000
+#define BENCH_QUEUE_LEN     50
+
+struct BenchChunk {
+    int16_t* data;
+    size_t   size;
+};
+
+struct BenchResult {
+    uint32_t totalUs;
+    uint32_t maxPushUs;
+    uint32_t maxPopUs;
+};
+
+static int16_t source[BENCH_CHUNK_SAMPLES];
+static QueueHandle_t chunkQueue;
+static PcmRingBuffer ring;
+static volatile uint32_t maxPopUs;
+static volatile bool consumerDone;
+
+// 两种实现用同样的方式计时: 都轮询等待，只统计真正读写的耗时，等待数据或空间的时间不算
+
+// ------------------- 旧实现：每块 malloc + memcpy + 队列 -------------------
+void queueConsumer(void* parameter) {
+    for (int i = 0; i < BENCH_CHUNKS; ) {
+        BenchChunk chunk;
+        uint32_t t0 = micros();
+        if (xQueueReceive(chunkQueue, &chunk, 0) != pdTRUE) {
+            vTaskDelay(1);
+            continue;
+        }
+        free(chunk.data);
+        i++;
+        uint32_t dt = micros() - t0;
+        if (dt > maxPopUs) maxPopUs = dt;
+    }
+    consumerDone = true;
+    vTaskDelete(NULL);
+}
+
+BenchResult benchQueue() {
+    BenchResult r = {0, 0, 0};
+    chunkQueue = xQueueCreate(BENCH_QUEUE_LEN, sizeof(BenchChunk));
+    maxPopUs = 0;
+    consumerDone = false;
+    xTaskCreatePinnedToCore(queueConsumer, "queueConsumer", 4096, NULL, 5, NULL, 1);
+
+    uint32_t start = micros();
+    for (int i = 0; i < BENCH_CHUNKS; i++) {
+        while (uxQueueSpacesAvailable(chunkQueue) == 0) {
+            vTaskDelay(1);
+        }
+        uint32_t t0 = micros();
+        BenchChunk chunk;
+        chunk.data = (int16_t*)malloc(BENCH_CHUNK_SAMPLES * sizeof(int16_t));
+        memcpy(chunk.data, source, sizeof(source));
+        chunk.size = BENCH_CHUNK_SAMPLES;
+        xQueueSend(chunkQueue, &chunk, 0);   // 单生产者，上面已确认有空位
+        uint32_t dt = micros() - t0;
+        if (dt > r.maxPushUs) r.maxPushUs = dt;
+    }
+    while (!consumerDone) vTaskDelay(1);
+    r.totalUs = micros() - start;
+    r.maxPopUs = maxPopUs;
+    vQueueDelete(chunkQueue);
+    return r;
+}
+
+// ------------------- 新实现：reserve/commit + peek/consume -------------------
+void ringConsumer(void* parameter) {
+    size_t remaining = (size_t)BENCH_CHUNKS * BENCH_CHUNK_SAMPLES;
+    while (remaining > 0) {
+        uint32_t t0 = micros();
+        int16_t* slice;
+        size_t n = ring.peek(&slice, 512);
+        if (n == 0) {
+            vTaskDelay(1);
+            continue;
+        }
+        ring.consume(n);
+        remaining -= n;
+        uint32_t dt = micros() - t0;
+        if (dt > maxPopUs) maxPopUs = dt;
+    }
+    consumerDone = true;
+    vTaskDelete(NULL);
+}
+
+BenchResult benchRing(AudioPool pool) {
+    BenchResult r = {0, 0, 0};
+    ring.begin(BENCH_QUEUE_LEN * BENCH_CHUNK_SAMPLES, pool);
+    maxPopUs = 0;
+    consumerDone = false;
+    xTaskCreatePinnedToCore(ringConsumer, "ringConsumer", 4096, NULL, 5, NULL, 1);
+
+    uint32_t start = micros();
+    for (int i = 0; i < BENCH_CHUNKS; i++) {
+        while (ring.freeSpace() < BENCH_CHUNK_SAMPLES) {
+            vTaskDelay(1);
+        }
+        uint32_t t0 = micros();
+        ring.write(source, BENCH_CHUNK_SAMPLES);
+        uint32_t dt = micros() - t0;
+        if (dt > r.maxPushUs) r.maxPushUs = dt;
+    }
+    while (!consumerDone) vTaskDelay(1);
+    r.totalUs = micros() - start;
+    r.maxPopUs = maxPopUs;
+    ring.end();
+    return r;
+}
+
+void printResult(const char* name, const BenchResult& r) {
+    float samplesPerSec = (float)BENCH_CHUNKS * BENCH_CHUNK_SAMPLES * 1000000.0f / r.totalUs;
+    Serial.printf("%-14s total=%8uus  %.2f Msamples/s  maxPush=%uus  maxPop=%uus\n",
+                  name, r.totalUs, samplesPerSec / 1000000.0f, r.maxPushUs, r.maxPopUs);
+}
+
+void setup() {
+    Serial.begin(115200);
+    delay(1000); // 等待串口初始化
+    for (int i = 0; i < BENCH_CHUNK_SAMPLES; i++) {
+        source[i] = (int16_t)(i * 31);
+    }
+
+    printResult("malloc+queue", benchQueue());
+    printResult("ring internal", benchRing(AudioPool::Internal));
+    printResult("ring psram", benchRing(AudioPool::Psram));
+    AudioMemory::printStats();
+}
+
+void loop() {
+    delay(1000);
+}
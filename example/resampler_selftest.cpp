@@ -0,0 +1,176 @@
+#include <Arduino.h>
+#include <math.h>
+#include "Megaphone/Resampler.hpp"
+
+// 重采样自检：常见的 TTS/提示音采样率转到 16kHz，单声道和立体声
+// 1. 随机大小分块送入，每次的输出数量必须和 outputFor()/inputFor() 的预测一致
+// 2. 440Hz 正弦的输出按最小二乘拟合同频正弦(与延迟无关)，残差需低于 -50dB
+// 3. 抽取时高于输出奈奎斯特频率的正弦(9kHz、12kHz)，混叠下来的能量需低于 -60dB
+
+#define SELFTEST_OUT_RATE     16000
+#define SELFTEST_FREQ         440.0
+#define SELFTEST_AMPLITUDE    10000.0
+#define SELFTEST_MAX_CHUNK    700     // 每次送入的最大帧数
+#define SELFTEST_MAX_OUT      500     // 每次给出的最大输出空间
+#define SELFTEST_SKIP         64      // 跳过开头滤波器的建立过程
+#define SELFTEST_MAX_ERROR_DB -50.0
+#define SELFTEST_MAX_ALIAS_DB -60.0
+
+static const double kStopbandFreqs[] = {9000.0, 12000.0};
+
+static const uint32_t kInputRates[] = {8000, 11025, 16000, 22050, 24000, 44100, 48000};
+
+static int failures = 0;
+static uint32_t lcg = 1;
+
+static void check(bool ok, const char* what, uint32_t rate, int channels) {
+    if (!ok) {
+        failures++;
+        Serial.printf("FAIL: %s (%u Hz x %d)\n", what, rate, channels);
+    }
+}
+
+static uint32_t nextRandom(uint32_t range) {
+    lcg = lcg * 1664525u + 1013904223u;
+    return (lcg >> 8) % range;
+}
+
+// 最小二乘拟合 y = a*sin + b*cos 的累加量
+struct SineFit {
+    double ss, cc, sc, ys, yc, yy;
+    size_t count;
+
+    void add(double y, double phase) {
+        double s = sin(phase), c = cos(phase);
+        ss += s * s; cc += c * c; sc += s * c;
+        ys += y * s; yc += y * c; yy += y * y;
+        count++;
+    }
+
+    // 残差能量相对于正弦能量(dB)
+    double errorDb() const {
+        double det = ss * cc - sc * sc;
+        if (count == 0 || det <= 0.0) return 0.0;
+        double a = (ys * cc - yc * sc) / det;
+        double b = (yc * ss - ys * sc) / det;
+        double residual = yy - (a * ys + b * yc);
+        double signal = SELFTEST_AMPLITUDE * SELFTEST_AMPLITUDE / 2.0 * count;
+        if (residual < 1e-9 * signal) residual = 1e-9 * signal;
+        return 10.0 * log10(residual / signal);
+    }
+};
+
+static void testRate(uint32_t inRate, int channels) {
+    Resampler rs;
+    if (!rs.configure(inRate, SELFTEST_OUT_RATE, (uint8_t)channels)) {
+        check(false, "configure", inRate, channels);
+        return;
+    }
+
+    static int16_t in[SELFTEST_MAX_CHUNK * 2];
+    static int16_t out[SELFTEST_MAX_OUT];
+    SineFit fit = {};
+    size_t totalIn = inRate;   // 1 秒
+    size_t pos = 0;
+    size_t produced = 0;
+    bool countsOk = true;
+
+    while (pos < totalIn) {
+        size_t chunk = 1 + nextRandom(SELFTEST_MAX_CHUNK);
+        if (chunk > totalIn - pos) chunk = totalIn - pos;
+        size_t maxOut = nextRandom(SELFTEST_MAX_OUT);
+
+        // 两个声道相同，下混后仍是同一个正弦
+        for (size_t i = 0; i < chunk; i++) {
+            int16_t v = (int16_t)lround(SELFTEST_AMPLITUDE * sin(2.0 * M_PI * SELFTEST_FREQ * (pos + i) / inRate));
+            for (int c = 0; c < channels; c++) in[i * channels + c] = v;
+        }
+
+        size_t expected = rs.outputFor(chunk);
+        size_t fitIn = rs.inputFor(maxOut);
+        // 上次没取走的输出已经超过 maxOut 时只能返回 0
+        if ((fitIn > 0 && rs.outputFor(fitIn) > maxOut) || rs.outputFor(fitIn + 1) <= maxOut) countsOk = false;
+
+        size_t used = 0;
+        size_t n = rs.process(in, chunk, out, maxOut, used);
+        if (n != (expected < maxOut ? expected : maxOut)) countsOk = false;
+        if (expected <= maxOut && used != chunk) countsOk = false;
+
+        for (size_t i = 0; i < n; i++, produced++) {
+            if (produced >= SELFTEST_SKIP) {
+                fit.add(out[i], 2.0 * M_PI * SELFTEST_FREQ * produced / SELFTEST_OUT_RATE);
+            }
+        }
+        pos += used;
+    }
+
+    check(countsOk, "outputFor/inputFor prediction", inRate, channels);
+    long drift = (long)produced - (long)SELFTEST_OUT_RATE;
+    check(drift >= -2 && drift <= 2, "output length", inRate, channels);
+    double err = fit.errorDb();
+    check(err < SELFTEST_MAX_ERROR_DB, "sine error", inRate, channels);
+    Serial.printf("%5u Hz x %d -> %u: %u samples, error %.1f dB\n",
+                  inRate, channels, SELFTEST_OUT_RATE, (unsigned)produced, err);
+}
+
+// 阻带正弦的输出能量相对于输入正弦能量(dB)
+static void testAlias(uint32_t inRate, double freq) {
+    Resampler rs;
+    if (!rs.configure(inRate, SELFTEST_OUT_RATE, 1)) {
+        check(false, "configure", inRate, 1);
+        return;
+    }
+
+    static int16_t in[SELFTEST_MAX_CHUNK];
+    static int16_t out[SELFTEST_MAX_OUT];
+    size_t totalIn = inRate;
+    size_t pos = 0;
+    size_t produced = 0;
+    double energy = 0.0;
+    size_t counted = 0;
+
+    while (pos < totalIn) {
+        size_t chunk = 1 + nextRandom(SELFTEST_MAX_CHUNK);
+        if (chunk > totalIn - pos) chunk = totalIn - pos;
+        for (size_t i = 0; i < chunk; i++) {
+            in[i] = (int16_t)lround(SELFTEST_AMPLITUDE * sin(2.0 * M_PI * freq * (pos + i) / inRate));
+        }
+        size_t used = 0;
+        size_t n = rs.process(in, chunk, out, SELFTEST_MAX_OUT, used);
+        for (size_t i = 0; i < n; i++, produced++) {
+            if (produced >= SELFTEST_SKIP) {
+                energy += (double)out[i] * out[i];
+                counted++;
+            }
+        }
+        pos += used;
+    }
+
+    double signal = SELFTEST_AMPLITUDE * SELFTEST_AMPLITUDE / 2.0 * counted;
+    double db = 10.0 * log10((energy > 1e-9 * signal ? energy : 1e-9 * signal) / signal);
+    check(counted > 0 && db < SELFTEST_MAX_ALIAS_DB, "stopband rejection", inRate, 1);
+    Serial.printf("%5u Hz -> %u: %.0f Hz tone, alias %.1f dB\n", inRate, SELFTEST_OUT_RATE, freq, db);
+}
+
+void setup() {
+    Serial.begin(115200);
+    delay(1000); // 等待串口初始化
+
+    for (size_t i = 0; i < sizeof(kInputRates) / sizeof(kInputRates[0]); i++) {
+        testRate(kInputRates[i], 1);
+        testRate(kInputRates[i], 2);
+    }
+    for (size_t i = 0; i < sizeof(kInputRates) / sizeof(kInputRates[0]); i++) {
+        for (size_t f = 0; f < sizeof(kStopbandFreqs) / sizeof(kStopbandFreqs[0]); f++) {
+            // 只有抽取才有混叠；正弦要能在输入采样率下表示
+            if (kInputRates[i] > SELFTEST_OUT_RATE && kStopbandFreqs[f] < kInputRates[i] / 2.0) {
+                testAlias(kInputRates[i], kStopbandFreqs[f]);
+            }
+        }
+    }
+    Serial.printf("Resampler self-test: %s (%d failures)\n", failures == 0 ? "PASS" : "FAIL", failures);
+}
+
+void loop() {
+    delay(1000);
+}
@@ -0,0 +1,59 @@
+#pragma once
+
+#include <Arduino.h>
+#include <esp_heap_caps.h>
+
+/**
+ * @brief 音频缓冲区放置位置
+ *
+ * - Internal: 内部 RAM，访问快，用于 DSP 临时缓冲等
+ * - Dma:      内部 RAM 且可被 DMA 访问，用于直接交给外设的缓冲
+ * - Psram:    外部 PSRAM(8MB)，用于大块、对延迟不敏感的缓冲：
+ *             预录、抖动缓冲、录音、提示音缓存等。没有 PSRAM 时退回内部 RAM
+ */
+enum class AudioPool : uint8_t {
+    Internal = 0,
+    Dma,
+    Psram,
+    Count
+};
+
+/**
+ * @brief 每个内存池的使用统计
+ */
+struct AudioPoolStats {
+    uint32_t allocs;      // 成功分配次数
+    uint32_t frees;       // 释放次数
+    uint32_t failures;    // 分配失败次数
+    uint32_t fallbacks;   // PSRAM 不可用、退回内部 RAM 的次数
+    size_t   inUse;       // 当前占用字节数
+    size_t   peak;        // 历史峰值
+};
+
+/**
+ * @brief 音频内存分配器：按用途把缓冲区放到合适的内存里，并统计各池的使用量
+ *        释放 WiFi/TLS 需要的内部堆，也让播放缓冲可以远大于原来的 50 块队列
+ */
+class AudioMemory {
+public:
+    static void* alloc(size_t bytes, AudioPool pool);
+    static void* calloc(size_t bytes, AudioPool pool);
+    static void  free(void* ptr);
+
+    static bool hasPsram();
+    static AudioPoolStats getStats(AudioPool pool);
+    static void printStats();
+
+private:
+    // 每块前面的管理头，保持 16 字节对齐
+    struct BlockHeader {
+        uint32_t size;
+        uint8_t  pool;
+        uint8_t  reserved[11];
+    };
+
+    static AudioPoolStats s_stats[(int)AudioPool::Count];
+    static portMUX_TYPE   s_lock;
+
+    static uint32_t capsFor(AudioPool pool);
+};
@@ -20,6 +20,19 @@ public:
     static void convertInt16ToFloat(const int16_t* input, float* output, size_t sampleCount);
     static void convertFloatToInt16(const float* input, int16_t* output, size_t sampleCount);
 
+    // ======================== 混音 ========================
+    // 增益为 Q15 定点(32768 = 1.0，上限 65535 约 2.0)，从 gainFrom 线性过渡到 gainTo
+    static void mixAccumulate(int32_t* accumulator, const int16_t* samples, size_t sampleCount,
+                              int32_t gainFromQ15, int32_t gainToQ15);
+    static void saturateToInt16(const int32_t* accumulator, int16_t* output, size_t sampleCount);
+    // 多声道: accumulator 按声道分块存放(第 c 声道从 accumulator + c * planeStride 开始)，
+    // 饱和的同时交错写入 output(frames x channels)，一次遍历完成
+    static void saturateInterleave(const int32_t* accumulator, size_t planeStride, uint8_t channels,
+                                   int16_t* output, size_t frames);
+    static int32_t gainToQ15(float gain);
+    static int32_t mulQ15(int32_t a, int32_t b);   // 两个 Q15 增益相乘，结果截到 65535
+    static void applyGainQ15(int16_t* samples, size_t sampleCount, int32_t gainQ15);
+
     // ======================== 声音效果处理 ========================
     static void applyEcho(int16_t* samples, size_t sampleCount, float delay, float decay);
     static void applyReverb(int16_t* samples, size_t sampleCount, 
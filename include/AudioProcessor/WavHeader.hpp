@@ -0,0 +1,43 @@
+#pragma once
+
+#include <Arduino.h>
+
+/**
+ * @brief 标准 44 字节 PCM WAV 文件头(小端)
+ */
+struct __attribute__((packed)) WavHeader {
+    char     riff[4];        // "RIFF"
+    uint32_t riffSize;       // 文件总长度 - 8
+    char     wave[4];        // "WAVE"
+    char     fmt[4];         // "fmt "
+    uint32_t fmtSize;        // 16
+    uint16_t audioFormat;    // 1 = PCM
+    uint16_t numChannels;
+    uint32_t sampleRate;
+    uint32_t byteRate;
+    uint16_t blockAlign;
+    uint16_t bitsPerSample;
+    char     data[4];        // "data"
+    uint32_t dataSize;       // PCM 数据长度(字节)
+
+    /**
+     * @brief 生成 16 位 PCM 的文件头
+     */
+    static WavHeader make(uint32_t sampleRate, uint16_t channels, uint32_t dataBytes) {
+        WavHeader h;
+        memcpy(h.riff, "RIFF", 4);
+        h.riffSize = dataBytes + sizeof(WavHeader) - 8;
+        memcpy(h.wave, "WAVE", 4);
+        memcpy(h.fmt, "fmt ", 4);
+        h.fmtSize = 16;
+        h.audioFormat = 1;
+        h.numChannels = channels;
+        h.sampleRate = sampleRate;
+        h.bitsPerSample = 16;
+        h.blockAlign = channels * sizeof(int16_t);
+        h.byteRate = sampleRate * h.blockAlign;
+        memcpy(h.data, "data", 4);
+        h.dataSize = dataBytes;
+        return h;
+    }
+};
@@ -0,0 +1,89 @@
+#pragma once
+
+#include <Arduino.h>
+
+/**
+ * @brief 服务端下发音频的编码格式
+ */
+enum class CodecType : uint8_t {
+    Pcm16,      // 16 位小端 PCM，不需要解码器
+    ImaAdpcm,   // IMA-ADPCM，4 bit/采样
+    MuLaw,      // G.711 µ-law，8 bit/采样
+    ALaw        // G.711 A-law，8 bit/采样
+};
+
+/**
+ * @brief 增量解码器接口
+ *
+ * decode() 可以在任意字节处停下(例如播放缓冲回绕处只剩一点连续空间)，
+ * 下次调用从停下的位置继续，保证分段解码和一次解码的结果逐位一致。
+ */
+class AudioDecoder {
+public:
+    virtual ~AudioDecoder() {}
+
+    virtual CodecType type() const = 0;
+    virtual void reset() {}          // 新的流会话，清除解码状态
+    virtual void startPacket() {}    // 每个网络包开头调用(带包头的格式在这里重新同步)
+
+    // inBytes 字节最多解码出的采样数，用于预留播放缓冲
+    virtual size_t maxOutput(size_t inBytes) const = 0;
+
+    /**
+     * @brief 解码
+     * @param[out] consumed 实际使用的输入字节数
+     * @return 写入 out 的采样数
+     */
+    virtual size_t decode(const uint8_t* in, size_t inBytes, size_t& consumed,
+                          int16_t* out, size_t maxSamples) = 0;
+};
+
+/**
+ * @brief IMA-ADPCM 解码器(低 4 位在前，与 WAV 中的 IMA-ADPCM 相同)
+ *
+ * blockHeader 为 true 时每个包以 4 字节包头开始: int16 预测值、uint8 步长序号、保留字节，
+ * 包头本身输出一个采样，丢包后下一个包可以立即重新同步。
+ */
+class ImaAdpcmDecoder : public AudioDecoder {
+public:
+    explicit ImaAdpcmDecoder(bool blockHeader = true);
+
+    CodecType type() const override { return CodecType::ImaAdpcm; }
+    void reset() override;
+    void startPacket() override;
+    size_t maxOutput(size_t inBytes) const override;
+    size_t decode(const uint8_t* in, size_t inBytes, size_t& consumed,
+                  int16_t* out, size_t maxSamples) override;
+
+private:
+    bool    _blockHeader;
+    int32_t _predictor;
+    int     _stepIndex;
+    uint8_t _header[4];
+    uint8_t _headerBytes;    // 当前包已收到的包头字节，4 表示包头已处理
+    bool    _hasPending;     // 一个字节解出两个采样，输出空间只够一个时暂存第二个
+    int16_t _pending;
+
+    int16_t decodeNibble(uint8_t nibble);
+};
+
+/**
+ * @brief G.711 µ-law / A-law 查表解码器
+ */
+class G711Decoder : public AudioDecoder {
+public:
+    explicit G711Decoder(CodecType law = CodecType::MuLaw);
+
+    CodecType type() const override { return _law; }
+    size_t maxOutput(size_t inBytes) const override { return inBytes; }
+    size_t decode(const uint8_t* in, size_t inBytes, size_t& consumed,
+                  int16_t* out, size_t maxSamples) override;
+
+    // ITU-T G.711 参考算法，用于生成查找表和校验
+    static int16_t muLawToLinear(uint8_t code);
+    static int16_t aLawToLinear(uint8_t code);
+
+private:
+    CodecType      _law;
+    const int16_t* _table;
+};
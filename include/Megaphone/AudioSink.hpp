@@ -0,0 +1,24 @@
+#pragma once
+
+#include <Arduino.h>
+
+/**
+ * @brief Megaphone 的输出端接口
+ *
+ * 默认输出是 I2S；Megaphone::setSink() 设置后，后台任务混音得到的块改为交给 sink，
+ * 不再安装 I2S 驱动。sink 需要像 DMA 一样在缓冲满时阻塞 write()，否则播放时钟会失真。
+ * 所有方法都在 Megaphone 的后台任务(begin 除外)中调用。
+ */
+class AudioSink {
+public:
+    virtual ~AudioSink() {}
+
+    /**
+     * @param bufferFrames 对应的 DMA 容量(帧)，用来模拟 i2s_write 的阻塞
+     */
+    virtual bool   begin(uint32_t sampleRate, uint8_t channels, size_t bufferFrames) = 0;
+    // 交错的输出帧，缓冲满时阻塞，返回写入的采样数
+    virtual size_t write(const int16_t* pcm, size_t samples) = 0;
+    virtual void   clear() = 0;                              // flush: 丢弃还没播出的音频
+    virtual void   setSampleRate(uint32_t sampleRate) = 0;
+};
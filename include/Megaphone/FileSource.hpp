@@ -0,0 +1,88 @@
+#pragma once
+
+#include <Arduino.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/queue.h>
+#include <freertos/semphr.h>
+#include <freertos/task.h>
+
+#include "FS.h"
+#include "SPIFFS.h"
+#include "Megaphone/Megaphone.hpp"
+
+#define FileSource_READ_SAMPLES        1024  // 每次从 flash 读取的采样数
+#define FileSource_FIRST_READ_SAMPLES  256   // 第一次只读一小块，尽快开始出声
+#define FileSource_QUEUE_LEN           4     // 排队等待播放的文件数量
+#define FileSource_MAX_PATH            48
+#define FileSource_TASK_PRIORITY       2     // 高于播放任务，预读跟得上播放
+
+/**
+ * @brief WAV 文件的格式信息
+ */
+struct WavInfo {
+    uint32_t sampleRate;
+    uint16_t channels;
+    uint16_t bitsPerSample;
+    uint32_t dataOffset;   // PCM 数据在文件中的偏移
+    uint32_t dataBytes;    // PCM 数据长度(字节)
+};
+
+/**
+ * @brief 非阻塞的文件播放源：后台任务把 WAV/PCM 文件预读进 Megaphone 的一路附加流
+ *
+ * play() 只把请求放进队列，立即返回；预读任务打开文件后先读一小块，
+ * 写进附加流后就开始出声，之后按播放速度继续读取。
+ * 文件系统由调用者在启动时挂载一次，这里不会挂载/卸载。
+ */
+class FileSource {
+public:
+    FileSource(Megaphone& megaphone, fs::FS& fs = SPIFFS);
+    ~FileSource();
+
+    bool begin();   // 创建预读任务，需在 Megaphone::begin() 之后调用
+    void end();
+
+    /**
+     * @brief 排队播放一个文件(非阻塞)
+     * @param path     文件路径，.wav 按文件头解析(任意采样率/声道数的 16 位 PCM)，其他按输出格式的 PCM 处理
+     * @param priority 附加流优先级，默认压低正在播放的 TTS
+     * @param onDone   最后一个采样离开 DMA 时调用
+     * @return 队列已满或路径过长时返回 false
+     */
+    bool play(const char* path, uint8_t priority = Megaphone_PRIORITY_HIGH, float gain = 1.0f,
+              Megaphone::PlaybackCallback onDone = nullptr, void* context = nullptr);
+
+    void stop();    // 停止当前文件(包括已读完、还在播放的)并丢弃排队的请求
+    bool isBusy() const { return _busy || (_requests && uxQueueMessagesWaiting(_requests) > 0); }
+
+    /**
+     * @brief 解析 RIFF/WAVE 头，成功后文件位置停在 PCM 数据开头
+     */
+    static bool readWavInfo(File& file, WavInfo& info);
+
+private:
+    struct Request {
+        char     path[FileSource_MAX_PATH];   // 空路径表示退出任务
+        uint8_t  priority;
+        float    gain;
+        Megaphone::PlaybackCallback onDone;
+        void*    context;
+    };
+
+    Megaphone&        _megaphone;
+    fs::FS&           _fs;
+    int16_t*          _buffer;
+    QueueHandle_t     _requests;
+    SemaphoreHandle_t _doneSem;
+    TaskHandle_t      _taskHandle;
+    volatile int      _stream;          // 最近一个文件的流句柄
+    volatile bool     _busy;
+    volatile bool     _stopRequested;
+
+    void streamFile(const Request& req);
+
+    /**
+     * @brief 后台任务: 取请求 -> 打开文件 -> 预读写入附加流 -> 关闭流
+     */
+    static void prefetchTask(void* parameter);
+};
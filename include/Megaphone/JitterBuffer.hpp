@@ -0,0 +1,66 @@
+#pragma once
+
+#include <Arduino.h>
+
+#define JitterBuffer_MIN_DELAY_MS       40      // 最小起播缓冲
+#define JitterBuffer_MAX_DELAY_MS       1500    // 最大起播缓冲
+#define JitterBuffer_INITIAL_DELAY_MS   320     // 尚未测量时的起播缓冲(约等于原来的 5 块)
+#define JitterBuffer_COALESCE_US        2000    // 间隔小于此值的到达视为同一个网络包
+#define JitterBuffer_JITTER_MULT        4       // 目标延迟 = 包时长 + 4 * 平均迟到
+#define JitterBuffer_PEAK_DECAY         0.98f   // 迟到峰值每包的衰减系数
+#define JitterBuffer_UNDERRUN_STEP_MS   60      // 每次欠载后增加的额外缓冲
+#define JitterBuffer_BIAS_DECAY         0.995f  // 额外缓冲每包的衰减系数
+
+/**
+ * @brief 自适应抖动缓冲控制器：测量 websocket 音频的到达抖动，动态决定起播延迟
+ *
+ * 服务器是按需拉取的(发送 "ok" 才下发下一包)，到达往往比实时快，
+ * 只有"迟到"才会导致卡顿，所以这里只统计包间隔超过上一包媒体时长的部分：
+ * 网络好时起播延迟接近一个包长，网络差或发生欠载后自动加大。
+ * 数据本身仍然放在 Megaphone 的环形缓冲区里，这里只负责"什么时候开始播"。
+ */
+class JitterBuffer {
+public:
+    JitterBuffer();
+
+    void begin(uint32_t sampleRate);
+
+    /**
+     * @brief 新的一段音频开始(如一次新回复)，清除到达时间但保留已学习的网络状况
+     */
+    void restart();
+
+    /**
+     * @brief 记录一次数据到达
+     * @param samples 本次到达的采样数
+     * @param nowUs   到达时间(micros)
+     */
+    void onArrival(size_t samples, uint32_t nowUs);
+
+    void onUnderrun();   // 播放中缓冲区被取空
+    void onOverrun();    // 缓冲区已满，生产者的数据被拒绝
+
+    uint32_t getTargetDelayMs() const;
+    size_t   getTargetSamples() const;
+    uint32_t getJitterMs() const { return _lateEwmaUs / 1000; }
+    uint32_t getUnderruns() const { return _underruns; }
+    uint32_t getOverruns() const { return _overruns; }
+
+private:
+    uint32_t _sampleRate;
+
+    // 到达时间统计
+    bool     _hasArrival;
+    uint32_t _lastArrivalUs;    // 上一次到达时间(合并后的包)
+    uint32_t _packetSamples;    // 当前包累计的采样数
+    uint32_t _lastPacketUs;     // 上一个完整包的媒体时长
+
+    // 学习到的网络状况(跨回复保留)
+    float    _lateEwmaUs;       // 平均迟到
+    float    _latePeakUs;       // 迟到峰值(缓慢衰减)
+    float    _packetUs;         // 平均包媒体时长
+    float    _biasMs;           // 欠载后追加的缓冲
+
+    uint32_t _underruns;
+    uint32_t _overruns;
+};
@@ -1,14 +1,23 @@
 #pragma once
 
 #include <Arduino.h>
+#include <atomic>
 #include <freertos/FreeRTOS.h>
 #include <freertos/queue.h>
+#include <freertos/semphr.h>
 #include <freertos/task.h>
 
 #include "driver/i2s.h"
 #include "SPIFFS.h"
 #include "PINS.h"
 #include "AudioProcessor/AudioProcessor.hpp"
+#include "AudioMemory/AudioMemory.hpp"
+#include "Megaphone/PcmRingBuffer.hpp"
+#include "Megaphone/JitterBuffer.hpp"
+#include "Megaphone/UnderrunConcealer.hpp"
+#include "Megaphone/AudioCodec.hpp"
+#include "Megaphone/Resampler.hpp"
+#include "Megaphone/AudioSink.hpp"
 
 // ------------------- 默认参数定义 -------------------
 #define Megaphone_DEFAULT_I2S_NUM         I2S_NUM_1
@@ -16,14 +25,92 @@
 #define Megaphone_DEFAULT_BITS_PER_SAMPLE I2S_BITS_PER_SAMPLE_16BIT
 #define Megaphone_DEFAULT_CHANNEL_FORMAT  I2S_CHANNEL_FMT_ONLY_LEFT
 #define Megaphone_DEFAULT_COMM_FORMAT     I2S_COMM_FORMAT_STAND_I2S
-#define Megaphone_DEFAULT_DMA_BUF_COUNT   8
+// 低延迟配置: DMA 只缓冲 64ms(16kHz)，并在 begin() 时按实测调度抖动自动调整
+#ifdef Megaphone_LOW_LATENCY_PROFILE
+#define Megaphone_DEFAULT_DMA_BUF_COUNT   4
+#define Megaphone_DEFAULT_DMA_BUF_LEN     256
+#define Megaphone_DEFAULT_DMA_AUTO_TUNE   true
+#else
+#define Megaphone_DEFAULT_DMA_BUF_COUNT   8     // 8 x 1024 = 512ms(16kHz)，打断时全部要等它播完或清掉
 #define Megaphone_DEFAULT_DMA_BUF_LEN     1024
+#define Megaphone_DEFAULT_DMA_AUTO_TUNE   false
+#endif
+#ifndef Megaphone_QUEUE_LEN
+#define Megaphone_QUEUE_LEN               50    // 播放缓冲能容纳的块数，缓冲在 PSRAM 中，可以按需加大
+#endif
+#define Megaphone_CHUNK_SAMPLES           1024  // getBufferFree() 统计用的块大小(采样点)
+#define Megaphone_WRITE_BLOCK_SAMPLES     512   // 后台任务每次交给 I2S 的最大采样数(所有声道合计)
+#define Megaphone_MAX_END_MARKERS         8     // 同时等待播完的流结束标记数量(isLast / closeStream)
+#define Megaphone_MAX_STREAMS             4     // 同时混音的输入流数量(含 0 号主流)
+#define Megaphone_PRIMARY_STREAM          0     // 主流: queuePCM 写入的网络 TTS 流
+#define Megaphone_STREAM_RING_SAMPLES     16384 // 其他流(提示音等本地音频)的缓冲大小(采样点)
+#define Megaphone_PRIORITY_LOW            0
+#define Megaphone_PRIORITY_NORMAL         1     // 主流默认优先级
+#define Megaphone_PRIORITY_HIGH           2     // 提示音默认优先级
+#define Megaphone_MAX_OUT_CHANNELS        8     // 输出声道上限(TDM)，路由掩码每一位对应一个声道
+#define Megaphone_ROUTE_ALL               0xFF  // 路由掩码: 所有输出声道
+#define Megaphone_ROUTE_LEFT              0x01  // 声道 0: 立体声的左声道 / TDM 的第 1 个时隙
+#define Megaphone_ROUTE_RIGHT             0x02
+#define Megaphone_DEFAULT_DUCK_GAIN       0.25f // 有更高优先级的流在播放时，低优先级流保留的音量(约 -12dB)
+#define Megaphone_DEFAULT_DUCK_RAMP_MS    50    // 压低/恢复音量的过渡时间
+#define Megaphone_FLUSH_FADE_MS           10    // flush() 之后新音频的淡入时间
+#define Megaphone_UNDERRUN_GUARD_MS       20    // 主流取空时 DMA 剩余不到这个时长才算欠载(两次 10ms 等待的余量)
+#define Megaphone_SEGMENT_PREBUFFER_MS    120   // 片段流(句子)开始播放前至少缓冲的时长，已关闭的片段不必等满
+#define Megaphone_MAX_CROSSFADE_MS        100   // 相邻片段交叉淡化的上限
+#define Megaphone_VOLUME_MAX_STEPS        32    // 音量表的最大档数(含 0 档静音)
+#define Megaphone_DEFAULT_VOLUME_STEPS    16
+#define Megaphone_DEFAULT_VOLUME_MIN_DB   -40.0f  // 1 档
+#define Megaphone_DEFAULT_VOLUME_MAX_DB   0.0f    // 最高档，上限约 +6dB(Q15 增益 65535)
+#define Megaphone_CONVERT_CHUNK_SAMPLES   256   // 需要重采样时，解码输出的中转块大小
+#define Megaphone_GENERATION_MASK         0x7FFFFF  // 流句柄 = (代数 << 8) | 流编号
+#define Megaphone_WRITER_STACK_SIZE       8192  // 后台任务的静态栈(字节)，混音缓冲在栈上
+#define Megaphone_WRITER_PRIORITY         1
+#define Megaphone_WRITER_CORE             1
+#define Megaphone_COMMAND_QUEUE_LEN       8
+#define Megaphone_COMMAND_TIMEOUT_MS      100   // 等待后台任务接收/确认命令的最长时间
+#define Megaphone_TUNE_PROBE_MS           300   // DMA 自动调整时测量调度抖动的时长
+#define Megaphone_TUNE_DMA_BUF_LEN        256   // 自动调整只改变块数，块越小粒度越细
+#define Megaphone_TUNE_MIN_BUF_COUNT      3
+#define Megaphone_TUNE_MAX_BUF_COUNT      16
+#define Megaphone_TUNE_MARGIN_US          2000  // 混音和 i2s_write 本身的耗时
+#define Megaphone_DSP_BLOCKS              3     // 流水线中的块数，最多比直接写入多 2 块的延迟
+#define Megaphone_DSP_STACK_SIZE          4096
+#define Megaphone_DSP_PRIORITY            1
+#define Megaphone_DSP_CORE                0     // 和写入任务、网络轮询错开
 
-// 用于后台播放的音频数据包
-struct AudioChunk {
-    int16_t* data;   // 动态分配的采样数据指针，因为深度是16位，所以是int16_t
-    size_t   size;   // 采样点数量
-    bool     isLast; // 是否是最后一个数据块，用于触发回调
+/**
+ * @brief 播放状态
+ */
+enum class PlaybackState : uint8_t {
+    Idle,       // 没有待播放的数据，DMA 也已播完
+    Buffering,  // 正在积累起播缓冲(或欠载后重新缓冲)
+    Playing,    // 正在从缓冲区向 I2S 输出
+    Draining    // 缓冲区已空，DMA 中还有音频在播放
+};
+
+/**
+ * @brief 播放统计
+ */
+struct MegaphoneStats {
+    uint32_t underruns;        // 播放中缓冲区被取空(网络供不上)
+    uint32_t overruns;         // 缓冲区已满，queuePCM 被拒绝
+    uint32_t jitterMs;         // 平均到达迟到
+    uint32_t targetDelayMs;    // 当前自适应起播延迟
+    uint32_t concealEvents;    // 欠载补偿次数
+    uint32_t concealedMs;      // 补偿音频总时长
+    size_t   bufferedSamples;  // 待播放的采样点
+    uint32_t bufferedMs;       // 缓冲区 + DMA 中的音频时长
+    uint32_t outputLatencyMs;  // 新写入 DMA 的采样到达扬声器的延迟
+    uint64_t samplesPlayed;    // 已经从扬声器播放出去的采样
+    uint8_t  activeStreams;    // 最近一次混音中有数据的流数量
+    uint32_t flushes;          // flush() 次数
+    uint16_t dmaBufCount;      // 当前 DMA 几何(自动调整后的结果)
+    uint16_t dmaBufLen;
+    uint32_t dmaLatencyMs;     // DMA 填满时的输出延迟，即打断前最多还会播出的音频
+    uint32_t schedJitterUs;    // 自动调整时测到的后台任务最大调度延迟，没有测量时为 0
+    uint32_t dspBlocks;        // 效果流水线处理的块数
+    uint32_t dspMaxUs;         // 单块效果处理的最长耗时
+    uint32_t dspStalls;        // 效果处理跟不上的次数(块环满且超过一个块的时长没有处理好的块，每个块时长记一次)
 };
 
 /**
@@ -31,6 +118,9 @@ struct AudioChunk {
  */
 class Megaphone {
 public:
+    // 播放完成回调: 在后台任务中调用，不要在回调里阻塞
+    using PlaybackCallback = void (*)(void* context);
+
     // 构造 & 析构
     Megaphone(uint32_t sampleRate = Megaphone_DEFAULT_SAMPLE_RATE,
               i2s_bits_per_sample_t bitsPerSample = Megaphone_DEFAULT_BITS_PER_SAMPLE,
@@ -47,45 +137,218 @@ public:
 
     bool begin();
 
-    // 后台任务显式接口
+    /**
+     * @brief 后台任务控制
+     *
+     * 后台任务在 begin() 中创建一次(静态栈)，之后一直存在，只通过命令队列控制，
+     * 命令在两个块之间执行，不会打断正在进行的 i2s_write。
+     * startWriterTask() 开始播放并重新积累起播缓冲；stopWriterTask() 暂停并等待后台任务停在块边界，
+     * 缓冲区中的数据保留，resume() 从暂停处继续。
+     */
     bool startWriterTask();
     bool stopWriterTask();
+    bool pause() { return stopWriterTask(); }
+    bool resume();
+    bool isPaused() const { return _paused; }
 
     // ------------------- 原始播放(阻塞) -------------------
+    // 输出格式的 PCM，多声道时为交错的帧，sampleCount 是采样数(帧数 x 声道数)
     size_t playPCM(const int16_t* buffer, size_t sampleCount);
 
     // 带内部处理(阻塞)
     size_t playPCMProcessed(const int16_t* buffer, size_t sampleCount);
 
     // ------------------- 队列(非阻塞)播放接口 -------------------
+    // 拷贝进主流缓冲区，空间不足时整块拒绝并返回 0；isLast 等同于 closeStream(主流)
     size_t queuePCM(const int16_t* buffer, size_t sampleCount, bool isLast = false);
 
+    /**
+     * @brief 零拷贝写入：直接申请播放缓冲区里的一段连续空间
+     * @param[out] ptr 可写地址
+     * @param maxSamples 希望写入的采样数
+     * @return 可写入的采样数(回绕处可能小于 maxSamples，需要再次申请)；主流格式和输出不同时返回 0
+     */
+    size_t reservePCM(int16_t** ptr, size_t maxSamples);
+    void   commitPCM(size_t sampleCount, bool isLast = false);
+
+    /**
+     * @brief 写入一个压缩音频包，用 setDecoder() 设置的解码器直接解码进主流缓冲区
+     *
+     * 没有设置解码器时按 16 位 PCM 处理。空间不足时整包拒绝。
+     * @return 解码出的采样数
+     */
+    size_t queueEncoded(const uint8_t* data, size_t bytes, bool isLast = false);
+    void   setDecoder(AudioDecoder* decoder);   // nullptr 表示 PCM，解码器由调用者持有
+
+    // ------------------- 多路混音 -------------------
+    // 以下接口的 stream 参数都是流句柄：句柄里带有代数，flush()/releaseStream() 之后旧句柄失效，
+    // 用旧句柄写入、关闭都会被拒绝，晚到的旧回复数据因此被直接丢弃
+    /**
+     * @brief 打开一路附加输入流(提示音、本地语音等)，和主流一起混音输出
+     * @param priority 优先级，播放时会压低所有优先级更低的流
+     * @param gain 该流的增益
+     * @return 流句柄，没有空闲流时返回 -1
+     */
+    int    openStream(uint8_t priority = Megaphone_PRIORITY_HIGH, float gain = 1.0f);
+    /**
+     * @brief 打开一个片段流(例如一句 TTS)，接在之前打开的片段之后无缝播放
+     *
+     * 片段按打开顺序排队：后一段在前一段播放时就开始缓冲，前一段写完(closeStream)并播到
+     * 最后 crossfadeMs 时，后一段从同一个采样位置接上并交叉淡化，不会重新积累起播缓冲。
+     * crossfadeMs = 0 时首尾直接相接。其余用法(写入、关闭、释放、回调)和普通流相同。
+     * @return 流句柄，没有空闲流时返回 -1
+     */
+    int    openSegment(uint32_t crossfadeMs = 0, float gain = 1.0f);
+    int    primaryStream() const;       // 主流当前的句柄，flush() 之后会变化
+    bool   isStreamValid(int stream) const;  // 句柄未失效且流仍可写入
+    void   releaseStream(int stream);   // 立即停止并丢弃剩余数据，主流不能释放
+    /**
+     * @brief 结束一段流会话：已写入的数据照常播放，最后一个采样离开 DMA 时调用 onDone
+     *
+     * 附加流关闭后不再接受写入，播完自动释放；主流关闭后可以继续写入下一段会话。
+     * 主流的 onDone 为空时使用 setPlaybackCallback 设置的回调。
+     * @return 结束标记已满或流未打开时返回 false
+     */
+    bool   closeStream(int stream, PlaybackCallback onDone = nullptr, void* context = nullptr);
+    /**
+     * @brief 声明流的输入格式，写入时按需下混为单声道并重采样到输出采样率
+     *
+     * 之后 writeStream/queuePCM 的采样数都是交错的输入采样(帧数 x 声道数)，不足一帧的尾部不会被接收。
+     * @param sampleRate 输入采样率，0 表示与输出相同
+     */
+    bool   setStreamFormat(int stream, uint32_t sampleRate, uint8_t channels = 1);
+    // 非阻塞写入，空间不足时只写入能放下的部分(主流也一样)，返回实际写入的采样数，调用者负责重试剩余部分
+    size_t writeStream(int stream, const int16_t* buffer, size_t sampleCount);
+    size_t getStreamFree(int stream) const;   // 还能写入的输入采样数
+    /**
+     * @brief 零拷贝播放一段常驻内存的输出格式 PCM(提示音缓存)
+     *
+     * 打开一路附加流，直接从 pcm 读取，不经过流缓冲区，播完自动释放并调用 onDone。
+     * pcm 在播放结束前必须保持有效，释放前用 isBufferInUse() 确认。
+     * @return 流句柄(可用于 releaseStream 提前停止)，没有空闲流时返回 -1
+     */
+    int    playBuffer(const int16_t* pcm, size_t samples, uint8_t priority = Megaphone_PRIORITY_HIGH,
+                      float gain = 1.0f, PlaybackCallback onDone = nullptr, void* context = nullptr);
+    bool   isBufferInUse(const int16_t* pcm) const;
+    size_t getStreamBuffered(int stream) const;
+    void   setStreamGain(int stream, float gain);
+    void   setStreamPriority(int stream, uint8_t priority);
+    // duckGain = 0 时低优先级流被完全替代
+    void   setDucking(float duckGain, uint32_t rampMs = Megaphone_DEFAULT_DUCK_RAMP_MS);
+    /**
+     * @brief 声道路由: 流混入哪些输出声道(位 c 对应声道 c)，单声道输出时忽略
+     *
+     * 新打开的流按优先级取 setPriorityRouting() 设置的掩码，默认所有声道；
+     * 例如 TTS 走左声道、提示音(playBuffer/PromptCache 的高优先级流)走右声道。
+     */
+    void   setStreamRouting(int stream, uint8_t mask);
+    void   setPriorityRouting(uint8_t priority, uint8_t mask);
+
     // ------------------- 从文件读取并播放(阻塞) -------------------
+    // 非阻塞播放请用 FileSource
     void playFromFile(const char* filename);
 
     // ------------------- 设置参数函数 -------------------
-    void setSampleRate(uint32_t sampleRate);
+    void setSampleRate(uint32_t sampleRate);  // begin() 之后由后台任务在块边界切换
     void setBitsPerSample(i2s_bits_per_sample_t bitsPerSample);
     void setChannelFormat(i2s_channel_fmt_t channelFormat);
+    /**
+     * @brief 输出声道数，begin() 之前设置
+     *
+     * 1 为 ONLY_LEFT 单声道，2 为 RIGHT_LEFT 立体声，更多为 TDM(仅支持 TDM 的芯片，如 ESP32-S3)。
+     * 多声道时 playPCM 的输入是交错的帧，时钟和 DMA 长度都以帧为单位。
+     */
+    bool setOutputChannels(uint8_t channels);
+    uint8_t getOutputChannels() const { return _outChannels; }
     void setCommFormat(i2s_comm_format_t commFormat);
     void setPins(int bckPin, int wsPin, int dataOutPin);
-    void setVolume(float gain);
+    /**
+     * @brief 输出到 sink 而不是 I2S(例如 WavSink 录成文件)，begin() 之前设置
+     *
+     * 设置后不安装 I2S 驱动，DMA 自动调整不执行；sink 由调用者持有，需比 Megaphone 活得久。
+     */
+    void setSink(AudioSink* sink) { if (!_writerTaskHandle) _sink = sink; }
+    uint32_t getSampleRate() const { return _sampleRate; }
+    /**
+     * @brief 总音量
+     *
+     * 按档位调节时每档的 dB 间隔相同(听感均匀)：0 档静音，1 档为 minDb，最高档为 maxDb。
+     * 各档的 Q15 增益预先算好，后台任务混音时和各流增益合并成一次定点乘法，不再单独遍历每个块；
+     * 音量变化和静音在一个块内线性过渡，不会有爆音。
+     */
+    void setVolume(float gain);             // 线性倍数，上限约 2.0
+    void setVolumeDb(float db);
+    bool setVolumeCurve(float minDb = Megaphone_DEFAULT_VOLUME_MIN_DB, float maxDb = Megaphone_DEFAULT_VOLUME_MAX_DB,
+                        uint8_t steps = Megaphone_DEFAULT_VOLUME_STEPS);
+    void setVolumeStep(uint8_t step);
+    uint8_t getVolumeStep() const { return _volumeStep; }
+    uint8_t getVolumeSteps() const { return _volumeSteps; }
+    void volumeUp();
+    void volumeDown();
+    float getVolumeDb() const;              // 静音或 0 增益时返回 -INFINITY
+    void setMute(bool mute) { _muted = mute; }
+    bool isMuted() const { return _muted; }
+
+    /**
+     * @brief DMA 自动调整
+     *
+     * 在后台任务里测量 probeMs 的调度抖动，DMA 只保留覆盖 2 倍最大抖动所需的块数
+     * (块长 Megaphone_TUNE_DMA_BUF_LEN)，然后重新安装 I2S 驱动。
+     * setDmaAutoTune(true) 后 begin() 会自动执行；也可以在系统负载变化后(例如连上 WiFi)再调用一次，
+     * 此时 DMA 中正在播放的音频会被丢弃。
+     */
+    void setDmaAutoTune(bool enable) { _dmaAutoTune = enable; }
+    bool autoTuneDma(uint32_t probeMs = Megaphone_TUNE_PROBE_MS);
+    int  getDmaBufCount() const { return _dmaBufCount; }
+    int  getDmaBufLen() const { return _dmaBufLen; }
+    uint32_t getDmaLatencyMs() const;         // DMA 填满时的输出延迟
 
-    // 播放控制接口（结合_isPlaying标志）
-    bool isPlaying() const;
+    // ------------------- 播放时钟与状态 -------------------
+    bool isPlaying() const;                   // Playing 或 Draining
+    PlaybackState getPlaybackState() const;
+    uint32_t getBufferedMs() const;           // 缓冲区 + DMA 中尚未播放的音频时长
+    uint32_t getOutputLatencyMs() const;      // DMA 延迟：现在写入的采样多久后到达扬声器
+    uint64_t getSamplesWritten() const;       // 已写入 DMA 的采样总数
+    uint64_t getSamplesPlayed() const;        // 已播放出去的采样总数(估算)
+    size_t   getDmaQueuedSamples() const;     // DMA 中尚未播放的采样
 
     // 音频效果开关
     void enableEcho(bool enable, float delaySeconds = 0.3f, float decay = 0.5f);
     void enableReverb(bool enable, const float* ir = nullptr, size_t irLen = 0);
     void enableCompressor(bool enable, float threshold=0.1f, float ratio=2.0f, float attack=0.01f, float release=0.1f);
 
-    // 缓冲区控制
-    void clearBuffer();
-    size_t getBufferFree() const;
+    /**
+     * @brief 效果流水线，begin() 之前设置
+     *
+     * 开启后在 Megaphone_DSP_CORE 上创建效果任务：写入任务混音后把块交给效果任务，
+     * 自己只写处理好的块，压缩/回声/混响不会拖慢 core 1 上的 I2S 写入。
+     * 块之间通过无锁的块环传递，最多 Megaphone_DSP_BLOCKS 块，额外延迟有上限。
+     * 不开启时效果在写入任务中直接处理。
+     */
+    void setDspPipeline(bool enable) { _dspPipeline = enable; }
+    bool isDspPipelineActive() const { return _dspTaskHandle != nullptr; }
+
+    /**
+     * @brief 打断: 丢弃所有流中已排队的音频和 DMA 中的音频，旧句柄全部失效
+     *
+     * 调用后立即返回，后台任务在下一个块之前完成丢弃；flush() 之后写入主流的数据不受影响，
+     * 开头 Megaphone_FLUSH_FADE_MS 淡入。正在播放的音频在清空 DMA 时直接截断(旧驱动无法对其淡出)。
+     * 被丢弃的会话不会触发完成回调。
+     */
+    void flush();
+
+    // 缓冲区控制(主流)
+    void clearBuffer();                   // 等同于 flush()
+    size_t getBufferFree() const;         // 剩余空间(单位: Megaphone_CHUNK_SAMPLES 块)
+    size_t getBufferFreeSamples() const;  // 剩余空间(按主流的输入格式换算的采样点)
+    size_t getBufferedSamples() const;    // 待播放的采样点
+
+    // 统计
+    MegaphoneStats getStats() const;
+    void printStats() const;
 
     // 事件回调
-    using PlaybackCallback = void (*)(void* context);
-    void setPlaybackCallback(PlaybackCallback callback, void* context = nullptr);
+    void setPlaybackCallback(PlaybackCallback callback, void* context = nullptr);  // 主流 isLast 播完时调用
 
 private:
     // I2S配置
@@ -93,24 +356,129 @@ private:
     uint32_t              _sampleRate;
     i2s_bits_per_sample_t _bitsPerSample;
     i2s_channel_fmt_t     _channelFormat;
+    uint8_t               _outChannels;     // 每帧的声道数，由 _channelFormat 决定
     i2s_comm_format_t     _commFormat;
     int _bckPin, _wsPin, _dataOutPin;
-    int _dmaBufCount, _dmaBufLen;
+    volatile int _dmaBufCount, _dmaBufLen;
+    bool     _dmaAutoTune;
+    uint32_t _schedJitterUs;
+
+    // 音量: _volumeQ15 是目标增益，_masterQ15 是后台任务实际用到的增益(逐块过渡)
+    int32_t          _volumeTable[Megaphone_VOLUME_MAX_STEPS];
+    uint8_t          _volumeSteps;
+    uint8_t          _volumeStep;
+    volatile int32_t _volumeQ15;
+    volatile bool    _muted;
+    int32_t          _masterQ15;
 
     // 播放状态
-    float _ampGain;
-    bool  _isPlaying;
+    volatile PlaybackState _state;
+
+    // 播放时钟：i2s_write 在 DMA 满时阻塞，据此估算 DMA 中剩余的采样
+    uint64_t             _samplesWritten;   // 已写入 DMA 的采样总数
+    size_t               _dmaFillSamples;   // 最近一次写入后 DMA 中的采样
+    uint32_t             _lastWriteUs;      // 最近一次写入的时间
+    mutable portMUX_TYPE _clockLock;
 
     // 回调
     PlaybackCallback _callback;
     void*            _callbackContext;
 
-    // ============ 后台队列相关 ============
-    QueueHandle_t _audioQueue;       // 存储 AudioChunk 的队列
-    static const int QUEUE_LEN = 50;  // 队列最大长度(可根据需要调整)，最大只能五十个！ 
+    // ============ 输入流 ============
+    enum class StreamSlot : uint8_t {
+        Free,
+        Opening,    // openSlot 已占用，正在初始化
+        Open,
+        Closing,    // 不再接受写入，剩余数据播完后变回 Free
+        Releasing   // 等后台任务丢弃剩余数据后变回 Free
+    };
+
+    struct Stream {
+        PcmRingBuffer       ring;       // 生产者: queuePCM/writeStream，消费者: i2sWriterTask
+        volatile StreamSlot slot;
+        volatile uint8_t    priority;
+        volatile uint8_t    routing;    // 输出声道掩码
+        volatile float      gain;
+        float               duck;       // 当前压低系数，只由后台任务修改
+        volatile uint32_t   generation; // 打开、释放、flush 时加一，使旧句柄失效
+        uint32_t            sampleRate; // 输入格式，0 表示与输出相同
+        uint8_t             channels;
+        Resampler           resampler;  // 输入格式 -> 输出格式，只在生产者侧使用；缓冲区里总是输出格式
+        // 片段流: 以下字段在打开前写好，之后只由后台任务修改
+        uint32_t            segment;    // 片段序号，0 表示普通流
+        uint32_t            xfadeFrames;// 和上一段重叠的帧数(请求值)
+        bool                segStarted;
+        bool                fadeOut;    // 当前是淡出(前一段)还是淡入(后一段)
+        uint32_t            fadeLen;    // 交叉淡化的总帧数，0 表示没有在淡化
+        uint32_t            fadePos;
+        uint32_t            fadeDelay;  // 本块中淡出开始前还要按原增益混音的帧数
+    };
+
+    Stream  _streams[Megaphone_MAX_STREAMS];
+    float   _duckGain;
+    uint8_t _priorityRouting[Megaphone_PRIORITY_HIGH + 1];
+    uint32_t _segmentSeq;
+    float   _fadeGain;                // flush 之后的淡入系数，只由后台任务修改
+    uint32_t _duckRampMs;
+    volatile uint8_t _activeStreams;
+
+    // ============ 流结束标记 ============
+    enum class MarkerState : uint8_t {
+        Free,
+        Pending,    // 等后台任务读到 endPos
+        Draining    // 已写入 DMA，等播放时钟越过 outputPos
+    };
+
+    struct EndMarker {
+        volatile MarkerState state;
+        uint8_t          stream;
+        uint32_t         generation; // 流的代数变化(flush/释放)后标记作废，不触发回调
+        uint32_t         endPos;     // 流缓冲中的结束位置(totalWritten)
+        uint64_t         outputPos;  // 最后一个采样写入 DMA 后的 getSamplesWritten()
+        PlaybackCallback callback;
+        void*            context;
+    };
 
-    // 后台任务
-    TaskHandle_t _writerTaskHandle;
+    EndMarker    _endMarkers[Megaphone_MAX_END_MARKERS];
+    portMUX_TYPE _markerLock;
+    portMUX_TYPE _slotLock;           // 保护空闲槽位的查找和占用，openStream 可能在多个任务中调用
+
+    // ============ 主流的起播缓冲 ============
+    JitterBuffer  _jitter;            // 自适应起播延迟
+    volatile bool _prebuffering;      // 是否在积累起播缓冲
+    volatile uint32_t _lastEndPos;    // 主流最近一个已读到的结束位置
+    UnderrunConcealer _concealer;     // 欠载补偿
+    AudioDecoder* _decoder;           // 主流的解码器，只在 queueEncoded 的生产者侧使用
+    volatile uint32_t _flushPos;      // 主流中这个位置之前的数据要丢弃
+    std::atomic<bool> _producerReset; // flush() 之后由主流的生产者清除解码器和重采样器状态
+    volatile uint32_t _flushes;
+
+    // ============ 后台任务 ============
+    enum class WriterCommand : uint8_t {
+        Play,           // 开始播放，重新积累起播缓冲
+        Pause,          // 停在块边界，完成后给 _writerAck
+        Resume,
+        Flush,
+        Reconfigure,    // 切换采样率
+        Tune,           // DMA 自动调整，arg 为测量时长(ms)
+        Quit            // 析构时使用，完成后给 _writerAck
+    };
+    struct WriterRequest {
+        WriterCommand command;
+        uint32_t      arg;
+        bool          ack;      // 执行后给 _writerAck
+    };
+
+    TaskHandle_t      _writerTaskHandle;
+    QueueHandle_t     _commandQueue;
+    SemaphoreHandle_t _writerAck;
+    volatile bool     _paused;
+    // 任务栈、队列和信号量都是对象内的静态存储，反复暂停/恢复不会申请或释放堆
+    StaticTask_t      _writerTaskBuffer;
+    StackType_t       _writerStack[Megaphone_WRITER_STACK_SIZE];
+    StaticQueue_t     _commandQueueBuffer;
+    uint8_t           _commandQueueStorage[Megaphone_COMMAND_QUEUE_LEN * sizeof(WriterRequest)];
+    StaticSemaphore_t _writerAckBuffer;
 
     // ============ 音效相关标志及参数 ============
     bool   _echoEnabled;
@@ -127,16 +495,87 @@ private:
     float  _compressorAttack;
     float  _compressorRelease;
 
+    // ============ 效果流水线 ============
+    // 块环: 写入任务混音进 _dspMixed 指向的块，效果任务处理到 _dspDone，写入任务写出到 _dspWritten；
+    // 三个序号只增不减，各由一个任务推进，两两之间单生产者单消费者，不需要锁
+    struct DspBlock {
+        int16_t pcm[Megaphone_WRITE_BLOCK_SAMPLES];
+        size_t  samples;    // 交错的采样数
+        uint8_t channels;
+    };
+    bool                  _dspPipeline;
+    TaskHandle_t          _dspTaskHandle;
+    volatile bool         _dspQuit;
+    DspBlock              _dspBlocks[Megaphone_DSP_BLOCKS];
+    std::atomic<uint32_t> _dspMixed;
+    std::atomic<uint32_t> _dspDone;
+    uint32_t              _dspWritten;      // 只由写入任务修改
+    volatile size_t       _pipelineFrames;  // 已混音但还没写入 DMA 的帧
+    uint32_t              _dspProcessed;
+    uint32_t              _dspMaxUs;
+    uint32_t              _dspStalls;
+    StaticTask_t          _dspTaskBuffer;
+    StackType_t           _dspStack[Megaphone_DSP_STACK_SIZE];
+
+    AudioSink*            _sink;            // 非空时代替 I2S 输出
+
 
     bool initI2S();
+    static uint8_t channelsForFormat(i2s_channel_fmt_t format);
 
     /**
      * @brief 后台音频处理函数（增益、效果等）
      */
     void processAudioBuffer(int16_t* buffer, size_t sampleCount);
+    void processEffects(int16_t* buffer, size_t frames, uint8_t channels);   // 交错的帧，逐声道处理；不含音量，音量在混音时已经乘上
+    void applyEffects(int16_t* buffer, size_t sampleCount);     // 单声道的效果链
+    bool hasEffects() const;
+
+    bool createDspTask();
+    void drainPipeline();         // 写入任务: 把处理好的块写进 DMA
+    void discardPipeline();       // 写入任务: flush 时丢弃流水线中的块
+    static void dspTask(void* parameter);
+
+    void notifyWriter();          // 生产者写入后唤醒后台任务
+    bool createWriterTask();
+    bool sendCommand(WriterCommand command, uint32_t arg = 0, bool waitAck = false);
+    bool processCommands();       // 后台任务在块边界执行命令，收到 Quit 返回 false
+    void applySampleRate(uint32_t sampleRate);
+    bool   syncFormat(Stream& s);     // 输入或输出格式变化后重新配置重采样器
+    void   syncProducer();            // 主流写入前调用，执行 flush() 留下的状态清除
+    size_t inputFree(const Stream& s) const;
+    // 把 frames 帧输入转换后写进缓冲区，返回写入的输出采样数；调用前需确认空间足够
+    size_t appendConverted(Stream& s, const int16_t* in, size_t frames);
+    void applyDmaTune(uint32_t probeMs);
+    uint32_t measureSchedJitterUs(uint32_t probeMs);
+    bool reinstallI2S(int dmaBufCount, int dmaBufLen);
+    void advanceClock(size_t samples);  // 记录写入 DMA 的采样
+    void resetClock();                  // DMA 被清空
+    bool addEndMarker(int stream, PlaybackCallback callback, void* context);
+    bool hasPendingEnd(int stream) const;
+    void resetEndMarkers();       // 丢弃所有标记，不触发回调
+    void dispatchEndMarkers();    // 最后一个采样离开 DMA 时触发回调
+    bool isSlotOpen(int slot) const;
+    int  resolveStream(int stream) const;   // 句柄有效时返回流编号，否则 -1
+    int  makeHandle(int slot) const;
+    void applyFlush();            // 后台任务中执行 flush
+    void reapStreams();           // 后台任务中丢弃已释放流的剩余数据
+    // 把流中最多 count 个采样按增益(从 gainFrom 过渡到 gainTo)累加进 routing 选中的各声道，返回实际采样数
+    size_t mixStream(Stream& s, int32_t* accumulator, size_t count, int32_t gainFrom, int32_t gainTo, bool primary,
+                     uint8_t routing, size_t planeStride);
+    int    openSlot(uint8_t priority, float gain, uint32_t segment, uint32_t crossfadeFrames);
+    // 片段流: 最早的片段缓冲够了就开始；播到结尾时决定下一段在本块中的起点
+    int    segmentAt(int rank) const;   // rank 0 为最早的未结束片段，1 为下一段
+    bool   segmentReady(const Stream& s) const;
+    void   startSegments();
+    void   handoffSegment(size_t n, size_t* available, size_t* offsets);
+    // 和 mixStream 相同，另外从 offset 帧开始累加，并按交叉淡化调整增益
+    size_t mixSegment(Stream& s, int32_t* accumulator, size_t offset, size_t count, int32_t gainFrom, int32_t gainTo,
+                      uint8_t routing, size_t planeStride);
+    uint8_t effectiveRouting(uint8_t mask) const;  // 截到实际声道数，单声道输出时总是声道 0
 
     /**
-     * @brief 后台任务: 从队列取音频块 -> 在isPlaying为true时播放 -> 释放
+     * @brief 后台任务: 各流取切片 -> 按优先级压低后混音到各声道 -> 交错写 I2S -> 释放空间
      */ 
     static void i2sWriterTask(void* parameter);
 };
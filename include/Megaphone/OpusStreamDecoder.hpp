@@ -0,0 +1,120 @@
+#pragma once
+
+#include <Arduino.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/queue.h>
+#include <freertos/semphr.h>
+#include <freertos/task.h>
+#include "opus.h"
+
+#include "Megaphone/Megaphone.hpp"
+
+#define OpusStream_MAX_PACKET_BYTES  400    // 单个 Opus 包上限(24 kbit/s、20ms 约 60 字节)
+#define OpusStream_PACKET_SLOTS      16     // 预分配的包缓冲数量(约 320ms)
+#define OpusStream_MAX_FRAME_MS      120    // Opus 单帧最长 120ms
+#define OpusStream_DEFAULT_FRAME_MS  20
+#define OpusStream_MAX_PLC_FRAMES    5      // 一次丢包最多补偿的帧数，更长的空隙交给欠载处理
+#define OpusStream_TASK_STACK        24576  // libopus 解码需要较大的栈
+#define OpusStream_TASK_PRIORITY     3
+#define OpusStream_OUTPUT_TIMEOUT_MS 1000   // 主流一直没有空间(暂停、停止)时丢掉这一帧
+
+/**
+ * @brief Opus 解码统计
+ */
+struct OpusDecoderStats {
+    uint32_t framesDecoded;
+    uint32_t plcFrames;        // 丢包补偿生成的帧
+    uint32_t decodeErrors;
+    uint32_t packetsDropped;   // 包缓冲已满被丢弃
+    uint32_t framesDropped;    // 等不到主流空间或所属会话已被 flush() 丢弃的帧
+    uint32_t decodeUsLast;     // 最近一帧解码耗时
+    uint32_t decodeUsAvg;      // 平均每帧解码耗时
+    uint32_t decodeUsMax;
+    uint32_t frameUs;          // 最近一帧的音频时长
+    uint32_t cpuLoadPct;       // 平均解码耗时 / 帧时长
+};
+
+/**
+ * @brief 下行 TTS 的 Opus 解码任务
+ *
+ * pushPacket() 只把包拷贝进预分配的包缓冲，立即返回；解码任务按顺序解码并写进
+ * Megaphone 的主流。带序号推送时自动发现丢包，用 Opus PLC 补出丢失的帧。
+ * 解码器状态、包缓冲、PCM 缓冲都在 begin() 中一次性分配，运行中不再申请内存。
+ */
+class OpusStreamDecoder {
+public:
+    explicit OpusStreamDecoder(Megaphone& megaphone);
+    ~OpusStreamDecoder();
+
+    bool begin(uint32_t sampleRate = Megaphone_DEFAULT_SAMPLE_RATE);
+    void end();
+
+    /**
+     * @brief 推送一个 Opus 包(非阻塞)
+     * @param seq 包序号，-1 表示不检测丢包
+     * @return 包缓冲已满或包过大时返回 false
+     */
+    bool pushPacket(const uint8_t* data, size_t len, int32_t seq = -1);
+    bool pushLost(uint32_t frames = 1);   // 由调用者告知丢了几帧
+    /**
+     * @brief 本次回复结束：排在已推送的包之后关闭主流会话
+     */
+    bool endOfStream(Megaphone::PlaybackCallback onDone = nullptr, void* context = nullptr);
+    void reset();                         // 新的会话，清空排队的包和解码状态
+
+    OpusDecoderStats getStats() const;
+    void resetStats();
+    void printStats() const;
+
+private:
+    enum class JobKind : uint8_t {
+        Packet,
+        Lost,
+        End,
+        Reset,
+        Quit
+    };
+
+    struct Job {
+        JobKind  kind;
+        int8_t   slot;     // Packet: 包缓冲序号
+        uint16_t len;      // Packet: 字节数；Lost: 帧数
+        int      stream;   // 推送时的主流句柄，flush() 之后失效，旧会话的帧不会写进新会话
+        Megaphone::PlaybackCallback onDone;   // End
+        void*    context;
+    };
+
+    Megaphone&        _megaphone;
+    uint32_t          _sampleRate;
+    OpusDecoder*      _decoder;
+    uint8_t*          _packets;        // OpusStream_PACKET_SLOTS 个包缓冲
+    int16_t*          _pcm;            // 一帧 PCM
+    size_t            _maxFrameSamples;
+    int               _lastFrameSamples;
+    QueueHandle_t     _jobQueue;
+    QueueHandle_t     _freeSlots;
+    SemaphoreHandle_t _doneSem;
+    TaskHandle_t      _taskHandle;
+    int32_t           _expectedSeq;
+    int               _lastStream;     // 上一帧写入的主流句柄，换会话时清除解码器状态
+    volatile bool     _abort;          // reset()/end() 时置位，打断正在等待主流空间的帧
+
+    volatile uint32_t _framesDecoded;
+    volatile uint32_t _plcFrames;
+    volatile uint32_t _decodeErrors;
+    volatile uint32_t _packetsDropped;
+    volatile uint32_t _framesDropped;
+    volatile uint32_t _decodeUsLast;
+    volatile uint32_t _decodeUsMax;
+    float             _decodeUsAvg;
+
+    bool sendJob(JobKind kind, uint16_t len, Megaphone::PlaybackCallback onDone = nullptr, void* context = nullptr);
+    void releaseResources();
+    void decodeFrame(const uint8_t* data, size_t len, int stream);
+    void outputPCM(size_t samples, int stream);
+
+    /**
+     * @brief 后台任务: 取任务 -> 解码/PLC -> 写入 Megaphone 主流 -> 归还包缓冲
+     */
+    static void decoderTask(void* parameter);
+};
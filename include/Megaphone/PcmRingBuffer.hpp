@@ -0,0 +1,74 @@
+#pragma once
+
+#include <Arduino.h>
+#include <atomic>
+#include "AudioMemory/AudioMemory.hpp"
+
+/**
+ * @brief 单生产者/单消费者的连续采样环形缓冲区
+ *
+ * 生产者用 reserve()/commit() 直接写进播放内存，消费者用 peek()/consume()
+ * 直接把切片交给 I2S，中间没有 malloc 也没有额外拷贝。
+ * 物理容量取 2 的幂，逻辑容量(可缓冲的采样数)可以是任意值。
+ * 也可以临时挂接一段外部的线性缓冲区(常驻内存的提示音)，消费者直接从中读取。
+ */
+class PcmRingBuffer {
+public:
+    PcmRingBuffer();
+    ~PcmRingBuffer();
+
+    /**
+     * @brief 分配缓冲区
+     * @param capacitySamples 逻辑容量(采样点)
+     * @param pool            放置位置，默认 PSRAM
+     */
+    bool begin(size_t capacitySamples, AudioPool pool = AudioPool::Psram);
+    void end();
+
+    // ------------------- 生产者 -------------------
+    /**
+     * @brief 申请一段连续可写空间
+     * @param[out] ptr 可写起始地址
+     * @param wanted   希望写入的采样数
+     * @return 实际可连续写入的采样数(可能小于 wanted，回绕处会被截断)，0 表示已满
+     */
+    size_t reserve(int16_t** ptr, size_t wanted);
+    void   commit(size_t count);                      // 提交 reserve 后写入的数据
+    size_t write(const int16_t* data, size_t count);  // 拷贝写入(自动处理回绕)
+
+    /**
+     * @brief 零拷贝: 把一段外部数据整体作为已写入的内容交给消费者
+     *
+     * 只能在缓冲区为空时调用；挂接期间不能再写入，data 在读完或 discard() 之前必须保持有效。
+     * 读写位置照常递增，结束标记等按位置工作的逻辑不受影响。
+     */
+    bool   attach(const int16_t* data, size_t count);
+    void   detach();                                  // 缓冲区为空时恢复为普通环形缓冲
+    const int16_t* attached() const { return _external; }
+
+    // ------------------- 消费者 -------------------
+    /**
+     * @brief 获取一段连续可读数据
+     * @return 实际可连续读取的采样数
+     */
+    size_t peek(int16_t** ptr, size_t wanted);
+    void   consume(size_t count);
+    size_t read(int16_t* out, size_t count);          // 拷贝读取(自动处理回绕)
+    void   discard();                                 // 丢弃全部未读数据(消费者侧调用)
+
+    size_t available() const;
+    size_t freeSpace() const;
+    size_t capacity() const { return _limit; }
+    uint32_t totalWritten() const { return _head.load(std::memory_order_acquire); }
+    uint32_t totalRead() const { return _tail.load(std::memory_order_acquire); }
+
+private:
+    int16_t*              _buffer;
+    size_t                _size;    // 物理容量(2 的幂)
+    size_t                _mask;
+    size_t                _limit;   // 逻辑容量
+    std::atomic<uint32_t> _head;    // 已写入的采样总数
+    std::atomic<uint32_t> _tail;    // 已读取的采样总数
+    const int16_t*        _external;  // 挂接的外部数据，nullptr 表示使用自己的缓冲区
+    uint32_t              _externalBase;  // 挂接时的写入位置
+};
@@ -0,0 +1,99 @@
+#pragma once
+
+#include <Arduino.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/semphr.h>
+
+#include "FS.h"
+#include "SPIFFS.h"
+#include "AudioMemory/AudioMemory.hpp"
+#include "Megaphone/Megaphone.hpp"
+
+#define PromptCache_MAX_CLIPS           16
+#define PromptCache_MAX_PATH            48
+#define PromptCache_DEFAULT_BUDGET      (512 * 1024)  // PSRAM 预算(字节)，16kHz 下约 16 秒
+#define PromptCache_READ_SAMPLES        256           // 加载时每次从 flash 读取的采样数
+
+/**
+ * @brief 提示音清单中的一项
+ */
+struct PromptSpec {
+    uint16_t    id;
+    const char* path;     // .wav(任意采样率/声道数的 16 位 PCM)或输出格式的裸 PCM
+    bool        pinned;   // 常驻: 启动时加载，不会被淘汰；适合"嗯"、思考音等短提示
+};
+
+/**
+ * @brief 提示音缓存统计
+ */
+struct PromptCacheStats {
+    uint32_t hits;        // 播放时已在缓存中
+    uint32_t misses;      // 播放时需要从 flash 加载
+    uint32_t evictions;
+    uint32_t loadedClips;
+    size_t   usedBytes;
+};
+
+/**
+ * @brief 提示音缓存：按 ID 播放预先解码到 PSRAM 的提示音
+ *
+ * begin() 把清单中的常驻片段全部加载，其他片段在预算内尽量预加载；
+ * 播放时已经是输出格式，Megaphone::playBuffer() 直接从缓存读取，不经过 flash 也不拷贝。
+ * 预算不够时按最近最少使用淘汰非常驻片段，正在播放的片段不会被淘汰。
+ * 输出采样率变化后，片段在下一次播放时按新采样率重新加载。
+ */
+class PromptCache {
+public:
+    PromptCache(Megaphone& megaphone, fs::FS& fs = SPIFFS);
+    ~PromptCache();
+
+    /**
+     * @brief 设置清单并预加载，需在 Megaphone::begin() 和文件系统挂载之后调用
+     * @param manifest 清单，path 只在 begin() 中拷贝，之后不再引用
+     * @return 有常驻片段加载失败时返回 false(其余片段仍可使用)
+     */
+    bool begin(const PromptSpec* manifest, size_t count, size_t budgetBytes = PromptCache_DEFAULT_BUDGET);
+    void end();     // 释放所有片段，调用前需停止播放
+
+    /**
+     * @brief 播放一个片段，未加载时先同步加载(阻塞读 flash)
+     * @return 流句柄，ID 不存在、加载失败或没有空闲流时返回 -1
+     */
+    int  play(uint16_t id, uint8_t priority = Megaphone_PRIORITY_HIGH, float gain = 1.0f,
+              Megaphone::PlaybackCallback onDone = nullptr, void* context = nullptr);
+    bool preload(uint16_t id);          // 提前加载，必要时淘汰其他片段
+    bool isLoaded(uint16_t id) const;
+
+    PromptCacheStats getStats() const;
+    void printStats() const;
+
+private:
+    struct Entry {
+        uint16_t id;
+        bool     pinned;
+        char     path[PromptCache_MAX_PATH];
+        int16_t* pcm;           // 输出格式的单声道 PCM，nullptr 表示未加载
+        size_t   samples;
+        size_t   bytes;         // 占用的 PSRAM
+        uint32_t sampleRate;    // 加载时的输出采样率
+        uint32_t lastUsed;      // LRU 时间戳
+    };
+
+    Megaphone&        _megaphone;
+    fs::FS&           _fs;
+    Entry             _entries[PromptCache_MAX_CLIPS];
+    size_t            _count;
+    size_t            _budget;
+    size_t            _usedBytes;
+    uint32_t          _clock;
+    SemaphoreHandle_t _lock;
+
+    uint32_t _hits;
+    uint32_t _misses;
+    uint32_t _evictions;
+
+    Entry* find(uint16_t id);
+    bool   load(Entry& e, bool allowEvict);
+    bool   makeRoom(size_t bytes);
+    void   evict(Entry& e);
+};
@@ -0,0 +1,77 @@
+#pragma once
+
+#include <Arduino.h>
+#include "AudioMemory/AudioMemory.hpp"
+
+#define Resampler_TAPS              16      // 插值时每个相位的抽头数
+#define Resampler_DECIMATE_TAPS     24      // 抽取时每个相位按 ceil(M/L) 倍的这个数加长
+#define Resampler_MAX_TAPS          144     // 每个相位的抽头数上限(最多 6 倍抽取)
+#define Resampler_MAX_PHASES        640     // 插值倍数上限(11025 -> 16000 需要 640)
+#define Resampler_MAX_CHANNELS      8
+#define Resampler_CUTOFF            0.9f    // 截止频率相对于两边较低的奈奎斯特频率
+#define Resampler_INTERNAL_TABLE_BYTES 4096 // 系数表不超过这个大小时放在内部 RAM
+
+/**
+ * @brief 有状态的多相重采样 + 下混
+ *
+ * 输入是交错的多声道 int16，先对各声道取平均下混为单声道，再按 L/M 的有理数比例
+ * 用 Q15 多相 FIR 重采样。滤波历史和相位跨调用保存，可以按任意大小分块送入。
+ * 同采样率单声道时直接拷贝，不经过滤波器。
+ */
+class Resampler {
+public:
+    Resampler();
+    ~Resampler();
+
+    /**
+     * @brief 设置输入/输出格式并清空状态
+     * @return 比例超出 Resampler_MAX_PHASES/Resampler_MAX_TAPS、声道数不支持或系数表分配失败时返回 false
+     */
+    bool configure(uint32_t inRate, uint32_t outRate, uint8_t channels);
+    void reset();   // 清空滤波历史(新的一段音频)
+
+    uint32_t inputRate() const { return _inRate; }
+    uint32_t outputRate() const { return _outRate; }
+    uint8_t  channels() const { return _channels; }
+    bool     isPassthrough() const { return _L == 1 && _M == 1 && _channels == 1; }
+
+    /**
+     * @brief 送入 inFrames 帧后会产生的输出采样数(精确值，取决于当前相位)
+     */
+    size_t outputFor(size_t inFrames) const;
+
+    /**
+     * @brief 产生不超过 maxOut 个输出时最多能消耗的输入帧数
+     */
+    size_t inputFor(size_t maxOut) const;
+
+    /**
+     * @brief 重采样
+     * @param in       交错的输入
+     * @param inFrames 输入帧数(每帧 channels 个采样)
+     * @param out      单声道输出
+     * @param maxOut   输出缓冲大小
+     * @param[out] consumedFrames 实际消耗的输入帧数，不产生输出的输入也会被吸收进历史
+     * @return 输出采样数
+     */
+    size_t process(const int16_t* in, size_t inFrames, int16_t* out, size_t maxOut, size_t& consumedFrames);
+
+private:
+    uint32_t _inRate;
+    uint32_t _outRate;
+    uint8_t  _channels;
+    uint32_t _L;            // 插值倍数
+    uint32_t _M;            // 抽取倍数
+    uint32_t _taps;         // 每个相位的抽头数
+    int16_t* _coeffs;       // [相位][抽头]，Q15，每个相位的和为 1
+    uint32_t _phase;        // 下一个输出在两个输入之间的位置(0..L-1)
+    uint32_t _need;         // 产生下一个输出前还需要的输入帧数
+    size_t   _histPos;
+    int16_t  _hist[Resampler_MAX_TAPS * 2];  // 镜像存放，读取时不用处理回绕
+
+    void    releaseCoeffs();
+    bool    buildCoeffs();
+    int16_t downmix(const int16_t* frame) const;
+    void    push(int16_t sample);
+    int16_t filter() const;
+};
@@ -0,0 +1,68 @@
+#pragma once
+
+#include <Arduino.h>
+
+#define Concealer_HISTORY_MS        40      // 保存最近播放的音频时长(用于估计基音周期)
+#define Concealer_MIN_PITCH_HZ      70      // 基音搜索范围
+#define Concealer_MAX_PITCH_HZ      400
+#define Concealer_REPEAT_MS         60      // 短断流：按基音周期重复，并在这段时间内淡出到静音
+#define Concealer_BLOCK_MS          10      // 每次生成的补偿块时长
+#define Concealer_CROSSFADE_MS      5       // 数据恢复时的交叉淡化时长
+#define Concealer_MAX_SAMPLE_RATE   48000
+
+/**
+ * @brief 播放欠载补偿
+ *
+ * 断流时按最近音频的基音周期重复并逐渐淡出(短断流听起来只是拖音)，
+ * 淡出结束后交给 I2S 的 tx_desc_auto_clear 输出静音(长断流)，
+ * 数据恢复时从补偿信号交叉淡化到新数据，避免爆音。
+ */
+class UnderrunConcealer {
+public:
+    UnderrunConcealer();
+
+    void begin(uint32_t sampleRate);
+    void reset();   // 丢弃历史(新的一段音频、清空缓冲时调用)
+
+    /**
+     * @brief 记录已经写入 I2S 的音频
+     */
+    void observe(const int16_t* samples, size_t count);
+
+    /**
+     * @brief 生成一块补偿音频
+     * @return 生成的采样数，0 表示已经淡出到静音，不需要再写
+     */
+    size_t conceal(int16_t* out, size_t maxSamples);
+
+    /**
+     * @brief 数据恢复：对新数据开头做交叉淡化(原地修改)
+     */
+    void resume(int16_t* samples, size_t count);
+
+    bool     isConcealing() const { return _concealing; }
+    size_t   blockSamples() const { return _blockSamples; }
+    uint32_t getEvents() const { return _events; }
+    uint32_t getConcealedSamples() const { return _concealedSamples; }
+
+private:
+    static const size_t MAX_HISTORY = Concealer_MAX_SAMPLE_RATE * Concealer_HISTORY_MS / 1000;
+
+    uint32_t _sampleRate;
+    size_t   _historyLen;       // 历史缓冲长度(采样)
+    size_t   _historyFill;      // 已填充的历史采样
+    int16_t  _history[MAX_HISTORY];
+
+    bool     _concealing;
+    size_t   _period;           // 基音周期(采样)
+    size_t   _position;         // 在补偿信号中的位置
+    size_t   _repeatSamples;    // 重复+淡出的总长度
+    size_t   _blockSamples;
+    size_t   _crossfadeSamples;
+
+    uint32_t _events;
+    uint32_t _concealedSamples;
+
+    size_t  estimatePeriod() const;
+    int16_t concealSample(size_t position) const;
+};
@@ -0,0 +1,93 @@
+#pragma once
+
+#include <Arduino.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/semphr.h>
+
+#include "FS.h"
+#include "SPIFFS.h"
+#include "AudioMemory/AudioMemory.hpp"
+#include "MicRecorder/FlashRecorder.hpp"
+#include "Megaphone/AudioSink.hpp"
+
+#define WavSink_TRACE_ENTRIES      4096    // trace 的最大条数，放在 PSRAM 中
+#define WavSink_MAX_SILENCE_MS     1000    // 一次断流最多补进 WAV 的静音时长(空闲时不会写出无限长的静音)
+
+/**
+ * @brief 输出统计
+ */
+struct WavSinkStats {
+    uint32_t writes;
+    uint32_t clears;
+    uint64_t frames;        // 写入的音频帧
+    uint32_t gaps;          // 扬声器断流的次数(缓冲被播空后才有新数据)
+    uint64_t gapFrames;     // 断流的总帧数
+    uint32_t maxGapMs;
+    uint32_t maxQueuedMs;   // 观察到的最大缓冲延迟
+    uint32_t traceDropped;  // trace 满了之后没有记录的事件
+    uint32_t wavDropped;    // flash 跟不上而丢弃的采样
+};
+
+/**
+ * @brief 把 Megaphone 的输出录成 WAV 和 trace，不需要扬声器也能检查播放行为
+ *
+ * 按真实的 DMA 容量和采样率模拟 i2s_write 的阻塞，后台任务的节奏和接扬声器时一致；
+ * 缓冲被播空时按实际时长补静音，WAV 即扬声器实际播出的声音。
+ * 每次写入/清空记一条 trace(时间戳、帧数、写入前的缓冲量、断流帧数)，stop() 时写成 CSV。
+ * realtime = false 时不模拟时间，直接按顺序记录，用于离线渲染。
+ * 设备上录到 SPIFFS；主机上由 native 环境的 FreeRTOS/I2S 替身运行(pio test -e native，
+ * 用例在 test/test_playback_replay)，录下的 WAV/CSV 在 .pio/test_output。
+ *
+ * 用法: megaphone.setSink(&sink); megaphone.begin(); sink.start("/out.wav", "/out.csv"); ... sink.stop();
+ */
+class WavSink : public AudioSink {
+public:
+    WavSink(fs::FS& fs = SPIFFS, bool realtime = true);
+    ~WavSink();
+
+    // ------------------- 录制控制 -------------------
+    bool start(const char* wavPath, const char* tracePath = nullptr,
+               size_t maxBytes = FlashRecorder_DEFAULT_MAX_BYTES);
+    bool stop();            // 回填 WAV 头并写出 trace
+    bool isRecording() const { return _recording; }
+
+    WavSinkStats getStats() const { return _stats; }
+    void printStats() const;
+
+    // ------------------- AudioSink -------------------
+    bool   begin(uint32_t sampleRate, uint8_t channels, size_t bufferFrames) override;
+    size_t write(const int16_t* pcm, size_t samples) override;
+    void   clear() override;
+    void   setSampleRate(uint32_t sampleRate) override;
+
+private:
+    struct TraceEntry {
+        uint32_t us;            // 相对 start() 的时间
+        char     event;         // 'W' 写入，'C' 清空，'R' 切换采样率
+        uint32_t frames;
+        uint32_t queuedFrames;  // 写入前缓冲中还没播出的帧
+        uint32_t gapFrames;     // 写入前的断流帧数
+    };
+
+    fs::FS&           _fs;
+    FlashRecorder     _recorder;
+    bool              _realtime;
+    uint32_t          _sampleRate;
+    uint8_t           _channels;
+    size_t            _capacity;        // 模拟的 DMA 容量(帧)
+    size_t            _queued;          // 模拟的 DMA 中还没播出的帧
+    uint32_t          _lastUs;
+    bool              _started;         // 写入过数据，之后播空才算断流
+    uint32_t          _startUs;
+    volatile bool     _recording;
+    String            _tracePath;
+    TraceEntry*       _trace;
+    size_t            _traceCount;
+    SemaphoreHandle_t _lock;            // 保护 trace，write 和 stop 在不同任务
+    WavSinkStats      _stats;
+
+    size_t advance();       // 按经过的时间扣掉已播出的帧，返回断流的帧数
+    void   addTrace(char event, uint32_t frames, uint32_t queued, uint32_t gap);
+    void   recordSilence(uint32_t frames);
+    bool   writeTrace();
+};
@@ -0,0 +1,70 @@
+#pragma once
+
+#include <Arduino.h>
+#include <atomic>
+#include <freertos/FreeRTOS.h>
+#include <freertos/semphr.h>
+
+#define CaptureRing_MAX_CONSUMERS   4   // 最多同时挂载的消费者数量(STT、录音、校准等)
+
+/**
+ * @brief 采集环形缓冲区：单生产者(采集任务) / 多消费者广播
+ *
+ * 生产者永远不阻塞；消费者各自维护读指针，读得太慢会被覆盖，
+ * 此时记一次 overrun 并把读指针跳到仍然有效的位置。
+ */
+class CaptureRing {
+public:
+    CaptureRing();
+    ~CaptureRing();
+
+    /**
+     * @brief 分配缓冲区
+     * @param capacitySamples 容量(采样点)，会向上取整为 2 的幂
+     */
+    bool begin(size_t capacitySamples);
+    void end();     // 需在生产者退出之后调用
+
+    // ------------------- 生产者 -------------------
+    void write(const int16_t* samples, size_t count);
+    void stop();    // 生产者停止: 唤醒阻塞的消费者，缓冲读空后 read() 不再等待，begin() 恢复
+
+    // ------------------- 消费者 -------------------
+    /**
+     * @brief 注册一个消费者，从当前写位置开始读取
+     * @return 消费者 id，失败返回 -1
+     */
+    int  openConsumer();
+    void closeConsumer(int id);
+
+    /**
+     * @brief 读取数据，直到读满 maxSamples 或超时
+     * @return 实际读取到的采样数量
+     */
+    size_t read(int id, int16_t* out, size_t maxSamples, TickType_t timeout);
+    size_t available(int id) const;
+    void   skipToLatest(int id);   // 丢弃积压的数据，只读之后的新数据
+
+    uint32_t getOverruns(int id) const;
+    void     resetOverruns();
+    uint32_t getTotalWritten() const { return _writePos.load(); }
+    size_t   capacity() const { return _capacity; }
+
+private:
+    struct Consumer {
+        bool              active;
+        uint32_t          readPos;    // 单调递增的采样序号
+        uint32_t          overruns;   // 被生产者覆盖的次数
+        SemaphoreHandle_t dataReady;  // 生产者每写一块 give 一次
+    };
+
+    int16_t*              _buffer;
+    size_t                _capacity;
+    uint32_t              _mask;
+    std::atomic<uint32_t> _writePos;
+    volatile bool         _stopped;
+    Consumer              _consumers[CaptureRing_MAX_CONSUMERS];
+    mutable portMUX_TYPE  _lock;
+
+    bool isValid(int id) const;
+};
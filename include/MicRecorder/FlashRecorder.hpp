@@ -0,0 +1,94 @@
+#pragma once
+
+#include <Arduino.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/queue.h>
+#include <freertos/semphr.h>
+#include <freertos/task.h>
+
+#include "FS.h"
+#include "SPIFFS.h"
+#include "AudioProcessor/WavHeader.hpp"
+
+#define FlashRecorder_SECTOR_SIZE       4096            // 每次写入 flash 的块大小(与扇区对齐)
+#define FlashRecorder_DEFAULT_MAX_BYTES (512 * 1024)    // 默认单个录音文件上限
+#define FlashRecorder_TASK_PRIORITY     1               // 写 flash 的任务优先级(低于采集任务)
+
+/**
+ * @brief 录音到文件系统(SPIFFS/LittleFS)，用于现场排查 STT 识别失败
+ *
+ * push() 只做内存拷贝，不会阻塞，可以直接在采集任务里调用；
+ * 两个扇区大小的缓冲区轮流填充，写满的那个交给低优先级任务写入 flash。
+ * 两个缓冲区都在写入时新数据直接丢弃并计数，保证录音不会拖慢采集。
+ */
+class FlashRecorder {
+public:
+    FlashRecorder(fs::FS& fs = SPIFFS);
+    ~FlashRecorder();
+
+    /**
+     * @brief 开始录音
+     * @param path       文件路径，如 "/rec.wav"
+     * @param sampleRate 采样率，写入 WAV 头
+     * @param maxBytes   PCM 数据上限，达到后自动停止接收
+     * @param channels   声道数，写入 WAV 头(push 的数据为交错的帧)
+     */
+    bool start(const char* path, uint32_t sampleRate, size_t maxBytes = FlashRecorder_DEFAULT_MAX_BYTES,
+               uint16_t channels = 1);
+
+    /**
+     * @brief 追加音频数据(非阻塞)
+     * @return 实际接收的采样数量
+     */
+    size_t push(const int16_t* samples, size_t count);
+
+    /**
+     * @brief 停止录音：写完剩余数据并回填 WAV 头
+     */
+    bool stop();
+
+    bool     isActive() const { return _active; }
+    uint32_t getBytesWritten() const { return _bytesWritten; }
+    uint32_t getDroppedSamples() const { return _droppedSamples; }
+
+    /**
+     * @brief 供 MicRecorder::setCaptureCallback 使用的回调
+     */
+    static void captureTap(const int16_t* samples, size_t count, void* context);
+
+private:
+    struct WriteRequest {
+        int    index;   // 缓冲区序号，-1 表示结束
+        size_t bytes;
+    };
+
+    fs::FS&           _fs;
+    File              _file;
+    String            _path;
+    uint32_t          _sampleRate;
+    uint16_t          _channels;
+    size_t            _maxBytes;
+
+    uint8_t*          _buffers[2];
+    int               _fillIndex;       // 正在填充的缓冲区，-1 表示两个都在写入中
+    size_t            _fillBytes;
+    size_t            _acceptedBytes;   // 已接收(含未写入)的字节数
+
+    QueueHandle_t     _fullQueue;       // 待写入的缓冲区
+    QueueHandle_t     _freeQueue;       // 已写完可复用的缓冲区
+    SemaphoreHandle_t _lock;            // 保护填充状态，push 只 try-lock；与对象同生命周期
+    SemaphoreHandle_t _doneSem;         // 写任务结束信号；与对象同生命周期
+    TaskHandle_t      _writerTaskHandle;
+
+    volatile bool     _active;
+    volatile uint32_t _bytesWritten;
+    volatile uint32_t _droppedSamples;
+
+    void releaseResources();    // 释放本次录音的缓冲区和队列
+    bool finalizeHeader();
+
+    /**
+     * @brief 后台任务: 从 _fullQueue 取缓冲区 -> 写 flash -> 放回 _freeQueue
+     */
+    static void writerTask(void* parameter);
+};
@@ -10,6 +10,8 @@
 #include <math.h>
 #include "driver/i2s.h"
 #include "AudioProcessor/AudioProcessor.hpp"
+#include "MicRecorder/CaptureRing.hpp"
+#include "MicRecorder/NoiseFloorCalibrator.hpp"
 
 
 // 如果你有自己的 PINS.h，用于定义引脚，可保留此处
@@ -23,6 +25,32 @@
 #define MicRecorder_DEFAULT_COMM_FORMAT     I2S_COMM_FORMAT_STAND_I2S  // 标准 I2S 通信模式
 #define MicRecorder_DEFAULT_DMA_BUF_COUNT   16  // DMA 缓冲区数量
 #define MicRecorder_DEFAULT_DMA_BUF_LEN     64  // DMA 缓冲区长度
+#define MicRecorder_EVENT_QUEUE_LEN         8   // I2S 事件队列长度(用于统计 DMA 溢出)
+#define MicRecorder_CAPTURE_BLOCK_SAMPLES   256 // 采集任务每次从 DMA 读取的采样数
+#define MicRecorder_RING_SAMPLES            8192 // 采集环形缓冲区容量(8kHz 下约 1 秒)
+#define MicRecorder_HIST_BUCKETS            8   // 直方图桶: <0.5,<1,<2,<4,<8,<16,<32,>=32 ms
+#define MicRecorder_PEAK_HOLD_MS            500 // 峰值保持时间
+#define MicRecorder_PEAK_DECAY              0.8f // 保持结束后每块的峰值衰减系数
+#define MicRecorder_VAD_HANGOVER_BLOCKS     4   // 语音结束后 VAD 保持的块数，防止状态抖动
+
+
+/**
+ * @brief 采集健康统计，用于确定 DMA 缓冲区数量/长度，而不是拍脑袋
+ */
+struct MicRecorderStats {
+    uint32_t blocksRead;            // 成功读取的块数
+    uint32_t samplesRead;           // 成功读取的采样数
+    uint32_t dmaOverflows;          // I2S_EVENT_RX_Q_OVF：DMA 接收队列溢出，数据已丢失
+    uint32_t dmaErrors;             // I2S_EVENT_DMA_ERROR
+    uint32_t readErrors;            // i2s_read 返回错误
+    uint32_t shortReads;            // 读取数量少于请求数量
+    uint32_t readLatencyMaxUs;      // i2s_read 最长阻塞时间
+    uint64_t readLatencySumUs;      // i2s_read 阻塞时间总和(求平均用)
+    uint32_t readLatencyHist[MicRecorder_HIST_BUCKETS];
+    uint32_t jitterMaxUs;           // 相邻两块之间的间隔与理论周期的最大偏差
+    uint32_t jitterHist[MicRecorder_HIST_BUCKETS];
+    uint32_t consumerOverruns[CaptureRing_MAX_CONSUMERS];  // 每个环形缓冲区消费者被覆盖的次数
+};
 
 
 /**
@@ -68,9 +96,11 @@ public:
         // 音频数据读取
     size_t readPCMProcessed(int16_t* buffer, size_t maxSamples, bool autoGain = true);
     
-    // 音频监测
-    float getCurrentVolume();  // 获取当前音量
-    bool isVoiceDetected();   // 检测是否有声音输入 使用rms和zcr
+    // 音频监测：返回采集路径持续更新的缓存值，不会读取 DMA，也不会阻塞
+    // (需要 startRecording() 才能持续更新，否则为最近一次 readPCM 的结果)
+    float getCurrentVolume() const;  // 获取当前音量(最近一块的 RMS)
+    float getPeakLevel() const;      // 获取峰值(带保持和衰减)
+    bool isVoiceDetected() const;    // 检测是否有声音输入 使用rms和zcr
 
     // ------------------- 设置参数函数 -------------------
     void setSampleRate(uint32_t sampleRate);
@@ -80,7 +110,22 @@ public:
     void setPins(int bckPin, int wsPin, int dataInPin);
     // 设置参数
     void setGain(float gain);  // 设置增益
-    void setVoiceDetectionThreshold(float threshold);   
+    void setVoiceDetectionThreshold(float threshold);   // 设置固定阈值(会关闭自适应阈值)
+
+    // ------------------- 噪声基底自适应 -------------------
+    /**
+     * @brief 启动时测量环境噪声基底(需要先 startRecording，期间保持安静)
+     * @param durationMs 测量时长
+     */
+    bool calibrateNoiseFloor(uint32_t durationMs = 1000);
+    void setAdaptiveThreshold(bool enable);         // VAD/噪声门是否使用基底推导的阈值(默认开启)
+    float getVoiceThreshold() const;                // 当前生效的 VAD 阈值
+    NoiseFloorCalibrator& getCalibrator() { return _calibrator; }
+
+    // ------------------- 采集健康统计 -------------------
+    MicRecorderStats getStats() const;  // 获取统计快照
+    void resetStats();                  // 清零统计
+    void printStats() const;            // 打印统计及 DMA 配置建议
 
     // ------------------- 音频信号处理函数 -------------------
     /**
@@ -127,10 +172,21 @@ public:
         }
     }
 
-    // 优化的音频采集接口,待完善，还没有实现逻辑部分！ 
+    // ------------------- 后台采集接口 -------------------
+    // startRecording() 后由后台任务持续读取 DMA 写入环形缓冲区，
+    // readPCM() 改为从环形缓冲区读取，其他模块可以注册自己的消费者
     bool startRecording();  // 开始录音
     bool stopRecording();   // 停止录音
     bool isRecording() const; // 是否正在录音
+
+    int    openConsumer();                  // 注册一个环形缓冲区消费者，返回 id
+    void   closeConsumer(int id);
+    size_t readConsumer(int id, int16_t* buffer, size_t maxSamples, TickType_t timeout = portMAX_DELAY);
+    void   flushPCM();                      // 丢弃 readPCM() 积压的旧数据
+
+    // 采集回调：在采集任务中对每一块原始数据调用，回调内不能阻塞(如 FlashRecorder::captureTap)
+    using CaptureCallback = void (*)(const int16_t* samples, size_t sampleCount, void* context);
+    void setCaptureCallback(CaptureCallback callback, void* context = nullptr);
     
 private:
     // I2S 配置相关
@@ -148,12 +204,44 @@ private:
     int                    _dataInPin;     // DATA IN 引脚
 
     // 成员变量
-    bool _isRecording;  // 是否正在录音
+    volatile bool _isRecording;  // 是否正在录音
     float _gain;        // 增益 
-    float _voiceThreshold;  // 语音检测阈值
+    float _voiceThreshold;  // 语音检测阈值(固定模式)
+    bool  _adaptiveThreshold;   // 是否使用噪声基底推导的阈值
+    NoiseFloorCalibrator _calibrator;
+
+    // 后台采集
+    QueueHandle_t _i2sEventQueue;       // I2S 驱动事件队列
+    TaskHandle_t  _captureTaskHandle;   // 采集任务句柄
+    SemaphoreHandle_t _captureDone;     // 采集任务退出时 give
+    CaptureRing   _ring;                // 采集环形缓冲区
+    int           _defaultConsumer;     // readPCM() 使用的消费者
+    CaptureCallback _captureCallback;
+    void*           _captureContext;
+
+    // 缓存的音频指标，由采集路径更新
+    volatile float    _currentRms;
+    volatile float    _peakLevel;
+    volatile bool     _voiceActive;
+    uint32_t          _peakHoldUntilMs;
+    int               _vadHangover;
+
+    // 统计
+    MicRecorderStats     _stats;
+    uint32_t             _lastBlockUs;  // 上一块读取完成的时间
+    mutable portMUX_TYPE _statsLock;
 
     // 私有工具方法
     bool initI2S();
     void processAudioBuffer(int16_t* buffer, size_t sampleCount);
+    size_t readFromI2S(int16_t* buffer, size_t maxSamples);   // 直接读 DMA 并记录统计
+    void pollI2SEvents();                                     // 处理 I2S 事件队列
+    void updateMetrics(const int16_t* buffer, size_t sampleCount);  // 更新音量/峰值/VAD 缓存
+    static int histBucket(uint32_t us);
+
+    /**
+     * @brief 后台任务: 循环读取 DMA -> 写入环形缓冲区
+     */
+    static void captureTask(void* parameter);
 };
 
@@ -0,0 +1,60 @@
+#pragma once
+
+#include <Arduino.h>
+
+// 默认值与原先的固定阈值保持一致：VAD 50，结束说话 30
+#define NoiseFloor_DEFAULT_FLOOR    20.0f   // 未校准时的噪声基底(RMS)
+#define NoiseFloor_MIN_FLOOR        5.0f    // 噪声基底下限，避免安静房间阈值过低
+#define NoiseFloor_MAX_FLOOR        2000.0f // 噪声基底上限
+#define NoiseFloor_VAD_RATIO        2.5f    // VAD 阈值 = 基底 * 2.5 (约 +8dB)
+#define NoiseFloor_GATE_RATIO       2.0f    // 噪声门阈值 = 基底 * 2.0
+#define NoiseFloor_EOS_RATIO        1.5f    // 结束说话阈值 = 基底 * 1.5
+#define NoiseFloor_AGC_NOISE_CEIL   100.0f  // AGC 放大后噪声不应超过的 RMS
+#define NoiseFloor_AGC_MAX_GAIN     8.0f
+#define NoiseFloor_FALL_RATE        0.3f    // 比基底安静时快速下降
+#define NoiseFloor_RISE_RATE        0.02f   // 非语音块缓慢上升
+#define NoiseFloor_LOUD_RISE        1.002f  // 持续嘈杂时每块的爬升倍率(约 8 秒翻倍)
+#define NoiseFloor_CALIB_MAX_BLOCKS 64      // 启动校准最多统计的块数
+
+/**
+ * @brief 环境噪声基底校准：启动时测量一次，之后在空闲时段持续跟踪，
+ *        由基底推导 VAD、噪声门和 AGC 使用的阈值
+ *
+ * 跟踪采用最小值统计的思路：比基底安静就快速下降，非语音块缓慢上升，
+ * 语音块只允许极慢地爬升，以适应房间整体变吵的情况。
+ */
+class NoiseFloorCalibrator {
+public:
+    NoiseFloorCalibrator();
+
+    void reset(float initialFloor = NoiseFloor_DEFAULT_FLOOR);
+
+    /**
+     * @brief 用一组块 RMS 做初始校准，取 25% 分位数作为基底(排除偶发的说话和敲击)
+     */
+    void calibrate(const float* blockRms, size_t count);
+
+    /**
+     * @brief 持续跟踪，采集路径每读一块调用一次
+     */
+    void update(float blockRms);
+
+    // 对话进行中冻结跟踪，避免把用户说话和扬声器回声算进基底
+    void setTrackingEnabled(bool enabled) { _tracking = enabled; }
+    bool isTrackingEnabled() const { return _tracking; }
+    bool isCalibrated() const { return _calibrated; }
+
+    // ------------------- 派生阈值 -------------------
+    float getNoiseFloor() const { return _floor; }
+    float getVadThreshold() const { return _floor * NoiseFloor_VAD_RATIO; }
+    float getNoiseGateThreshold() const { return _floor * NoiseFloor_GATE_RATIO; }
+    float getEndOfSpeechThreshold() const { return _floor * NoiseFloor_EOS_RATIO; }
+    float getAgcMaxGain() const;   // 放大后噪声不超过 NoiseFloor_AGC_NOISE_CEIL 的最大增益
+
+private:
+    volatile float _floor;
+    volatile bool  _tracking;
+    bool           _calibrated;
+
+    static float clampFloor(float floor);
+};
@@ -0,0 +1,151 @@
+#pragma once
+
+#include <Arduino.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/semphr.h>
+#include <freertos/task.h>
+
+#include "FS.h"
+#include "SPIFFS.h"
+#include "AudioMemory/AudioMemory.hpp"
+#include "Megaphone/Megaphone.hpp"
+
+#define TtsCache_MAX_ENTRIES        32
+#define TtsCache_DEFAULT_BUDGET     (512 * 1024)   // flash 上缓存的总字节数上限
+#define TtsCache_MAX_ENTRY_BYTES    (256 * 1024)   // 单条回复上限，16kHz 下约 8 秒，超过的回复不缓存
+#define TtsCache_WRITE_CHUNK        4096           // 每次写入 flash 的字节数(与扇区对齐)
+#define TtsCache_TASK_PRIORITY      1              // 写 flash 的任务优先级(低于播放和网络)
+#define TtsCache_MAX_DIR            16
+#define TtsCache_MAGIC              0x48435454     // "TTCH"
+#define TtsCache_VERSION            1
+
+/**
+ * @brief 回复缓存统计
+ */
+struct TtsCacheStats {
+    uint32_t lookups;
+    uint32_t hits;          // 命中并开始本地播放
+    uint32_t misses;
+    uint32_t corrupt;       // 校验失败被删除的条目
+    uint32_t evictions;
+    uint32_t stored;        // 写入的新条目
+    uint32_t skipped;       // 过长或缓存忙而没有缓存的回复
+    uint32_t entries;
+    size_t   usedBytes;
+    uint32_t bytesSaved;    // 命中时省下的下行音频字节数
+    uint8_t  hitRatioPct;
+};
+
+/**
+ * @brief 大模型语音回复的本地缓存
+ *
+ * 以请求文本和音色参数的哈希为键，把一次完整回复的下行 PCM 存在 flash 上；
+ * 同样的问题再次出现时直接从 flash 读入 PSRAM，校验 CRC 后零拷贝播放，不经过网络。
+ * 录制时只做内存拷贝，回复结束后由低优先级任务写入 flash；总大小超出预算时按最近最少使用淘汰。
+ * 每个条目的文件头带有魔数、版本、键和 PCM 数据的 CRC32；启动扫描时读出整个文件校验一次，
+ * 播放前从 flash 读入时再校验一次，损坏的条目直接删除。
+ */
+class TtsCache {
+public:
+    TtsCache(Megaphone& megaphone, fs::FS& fs = SPIFFS);
+    ~TtsCache();
+
+    /**
+     * @brief 扫描缓存目录并创建写入任务，需在文件系统挂载之后调用
+     */
+    bool begin(size_t budgetBytes = TtsCache_DEFAULT_BUDGET, const char* dir = "/tts");
+    void end();
+
+    /**
+     * @brief 计算键: 64 位 FNV-1a(音色参数 + 文本)
+     */
+    static uint64_t makeKey(const String& text, const String& voice = "");
+
+    bool contains(uint64_t key) const;
+
+    /**
+     * @brief 命中时播放缓存的回复
+     * @return 流句柄；未命中、校验失败或上一条缓存回复还在播放时返回 -1，调用者应改走网络
+     */
+    int  play(uint64_t key, uint8_t priority = Megaphone_PRIORITY_NORMAL,
+              Megaphone::PlaybackCallback onDone = nullptr, void* context = nullptr);
+
+    // ------------------- 录制一次回复 -------------------
+    bool beginRecord(uint64_t key, uint32_t sampleRate);   // 上一条还在写 flash 时返回 false
+    void record(const int16_t* pcm, size_t samples);       // 只做内存拷贝，可在网络回调里调用；只传实际播放的数据
+    void commitRecord();    // 回复完整结束: 交给后台任务写入 flash
+    void abortRecord();     // 被打断或不完整: 丢弃
+    bool isRecording() const { return _recordState == RecordState::Recording; }
+
+    TtsCacheStats getStats() const;
+    void printStats() const;
+
+private:
+    struct FileHeader {
+        uint32_t magic;
+        uint16_t version;
+        uint16_t headerBytes;
+        uint64_t key;
+        uint32_t sampleRate;
+        uint32_t dataBytes;
+        uint32_t crc;           // PCM 数据的 CRC32
+        uint32_t lastUsed;      // LRU 时间戳，命中时原地更新
+    };
+
+    struct Entry {
+        uint64_t key;
+        uint32_t bytes;         // 文件总大小(含文件头)
+        uint32_t lastUsed;
+    };
+
+    enum class RecordState : uint8_t {
+        Idle,
+        Recording,
+        Overflow,   // 超过单条上限，结束时丢弃
+        Writing     // 后台任务正在写 flash
+    };
+
+    Megaphone&        _megaphone;
+    fs::FS&           _fs;
+    char              _dir[TtsCache_MAX_DIR];
+    size_t            _budget;
+    Entry             _entries[TtsCache_MAX_ENTRIES];
+    size_t            _count;
+    size_t            _usedBytes;
+    uint32_t          _clock;
+    SemaphoreHandle_t _lock;            // 保护索引和播放缓冲
+    TaskHandle_t      _writerTaskHandle;
+
+    // 录制
+    uint8_t*             _staging;      // PSRAM 中的录制缓冲
+    size_t               _stagingBytes;
+    uint64_t             _recordKey;
+    uint32_t             _recordRate;
+    uint32_t             _recordCrc;
+    volatile RecordState _recordState;
+
+    // 播放: 最近一条命中的回复留在 PSRAM，连续命中同一条时不再读 flash
+    int16_t* _playPcm;
+    size_t   _playSamples;
+    uint64_t _playKey;
+
+    uint32_t _lookups;
+    uint32_t _hits;
+    uint32_t _misses;
+    uint32_t _corrupt;
+    uint32_t _evictions;
+    uint32_t _stored;
+    uint32_t _skipped;
+    uint32_t _bytesSaved;
+
+    void   makePath(uint64_t key, char* path, size_t size) const;
+    void   scan();
+    bool   checkData(File& file, const FileHeader& header);   // 读出 PCM 数据校验 CRC
+    Entry* find(uint64_t key);
+    void   removeEntry(Entry* e);
+    bool   loadEntry(const Entry& e);
+    void   touch(const Entry& e);
+    bool   store();
+
+    static void writerTask(void* parameter);
+};
@@ -0,0 +1,37 @@
+#include "Arduino.h"
+
+#include <stdarg.h>
+
+// ====================== 实现部分 ======================
+
+HardwareSerial Serial;
+
+size_t HardwareSerial::printf(const char* format, ...)
+{
+    va_list args;
+    va_start(args, format);
+    int len = vprintf(format, args);
+    va_end(args);
+    return len > 0 ? (size_t)len : 0;
+}
+
+unsigned long millis()
+{
+    return (unsigned long)(esp_timer_get_time() / 1000);
+}
+
+unsigned long micros()
+{
+    // 和 ESP32 一样是 32 位，约 71 分钟回绕一次
+    return (unsigned long)(uint32_t)esp_timer_get_time();
+}
+
+void delay(unsigned long ms)
+{
+    vTaskDelay(pdMS_TO_TICKS(ms));
+}
+
+bool psramFound()
+{
+    return true;
+}
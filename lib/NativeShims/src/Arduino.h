@@ -0,0 +1,74 @@
+#pragma once
+
+// 主机端 Arduino 替身: 只提供播放引擎和测试用到的部分，Serial 输出到 stdout
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <stdio.h>
+#include <algorithm>
+#include <cmath>
+#include <string>
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/queue.h"
+#include "freertos/semphr.h"
+#include "esp_err.h"
+#include "esp_timer.h"
+
+#ifndef PI
+#define PI 3.1415926535897932384626433832795
+#endif
+#define IRAM_ATTR
+#define DRAM_ATTR
+#define EXT_RAM_ATTR
+
+using std::abs;
+using std::max;
+using std::min;
+
+class String {
+public:
+    String() {}
+    String(const char* s) : _s(s ? s : "") {}
+    String(const std::string& s) : _s(s) {}
+    String(int v) : _s(std::to_string(v)) {}
+    String(unsigned v) : _s(std::to_string(v)) {}
+    String(long v) : _s(std::to_string(v)) {}
+    String(unsigned long v) : _s(std::to_string(v)) {}
+
+    const char* c_str() const { return _s.c_str(); }
+    size_t length() const { return _s.size(); }
+    bool isEmpty() const { return _s.empty(); }
+
+    String& operator+=(const String& rhs) { _s += rhs._s; return *this; }
+    String operator+(const String& rhs) const { return String(_s + rhs._s); }
+    bool operator==(const String& rhs) const { return _s == rhs._s; }
+    bool operator!=(const String& rhs) const { return _s != rhs._s; }
+
+private:
+    std::string _s;
+};
+
+inline String operator+(const char* lhs, const String& rhs) { return String(lhs) + rhs; }
+
+class HardwareSerial {
+public:
+    void   begin(unsigned long baud) { (void)baud; }
+    size_t print(const char* s) { return fputs(s, stdout) >= 0 ? strlen(s) : 0; }
+    size_t print(const String& s) { return print(s.c_str()); }
+    size_t println() { return print("\n"); }
+    size_t println(const char* s) { return print(s) + println(); }
+    size_t println(const String& s) { return println(s.c_str()); }
+    size_t printf(const char* format, ...) __attribute__((format(printf, 2, 3)));
+};
+
+extern HardwareSerial Serial;
+
+unsigned long millis();
+unsigned long micros();
+void delay(unsigned long ms);
+bool psramFound();
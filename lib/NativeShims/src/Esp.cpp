@@ -0,0 +1,31 @@
+#include "esp_timer.h"
+#include "esp_heap_caps.h"
+
+#include <stdlib.h>
+#include <chrono>
+
+// ====================== 实现部分 ======================
+
+static const std::chrono::steady_clock::time_point s_boot = std::chrono::steady_clock::now();
+
+int64_t esp_timer_get_time()
+{
+    return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - s_boot).count();
+}
+
+void *heap_caps_malloc(size_t size, uint32_t caps)
+{
+    (void)caps;
+    return malloc(size);
+}
+
+void heap_caps_free(void *ptr)
+{
+    free(ptr);
+}
+
+size_t heap_caps_get_free_size(uint32_t caps)
+{
+    // 和 ESP32-S3 + 8MB PSRAM 的量级相当，只用于统计打印
+    return (caps & MALLOC_CAP_SPIRAM) ? 8 * 1024 * 1024 : 320 * 1024;
+}
@@ -0,0 +1,114 @@
+#include "FS.h"
+#include "SPIFFS.h"
+
+#include <errno.h>
+#include <sys/stat.h>
+
+// ====================== 实现部分 ======================
+
+fs::SPIFFSFS SPIFFS;
+
+namespace fs {
+
+File::File(FILE *fp, const char *path)
+    : _fp(fp, fclose),
+      _path(path)
+{
+}
+
+size_t File::write(const uint8_t *buf, size_t size)
+{
+    return _fp ? fwrite(buf, 1, size, _fp.get()) : 0;
+}
+
+size_t File::read(uint8_t *buf, size_t size)
+{
+    return _fp ? fread(buf, 1, size, _fp.get()) : 0;
+}
+
+int File::read()
+{
+    uint8_t c;
+    return read(&c, 1) == 1 ? c : -1;
+}
+
+bool File::seek(uint32_t pos, SeekMode mode)
+{
+    return _fp && fseek(_fp.get(), (long)pos, mode == SeekSet ? SEEK_SET : (mode == SeekCur ? SEEK_CUR : SEEK_END)) == 0;
+}
+
+size_t File::position() const
+{
+    long pos = _fp ? ftell(_fp.get()) : -1;
+    return pos < 0 ? 0 : (size_t)pos;
+}
+
+size_t File::size() const
+{
+    if (!_fp)
+        return 0;
+    fflush(_fp.get());
+    struct stat st;
+    return fstat(fileno(_fp.get()), &st) == 0 ? (size_t)st.st_size : 0;
+}
+
+void File::flush()
+{
+    if (_fp)
+        fflush(_fp.get());
+}
+
+// ------------ FS ------------
+FS::FS(const char *root)
+    : _root(root ? root : ".")
+{
+}
+
+std::string FS::hostPath(const char *path) const
+{
+    std::string p = path ? path : "";
+    if (p.empty() || p[0] != '/')
+        p = "/" + p;
+    return _root + p;
+}
+
+// 逐级创建 path 所在的目录
+static void makeParents(const std::string &path)
+{
+    for (size_t i = 1; i < path.size(); i++)
+    {
+        if (path[i] == '/')
+            mkdir(path.substr(0, i).c_str(), 0755);
+    }
+}
+
+File FS::open(const char *path, const char *mode, bool create)
+{
+    (void)create;
+    std::string full = hostPath(path);
+    // Arduino 的 "r+"/"w"/"a" 都按二进制打开
+    std::string m = mode ? mode : FILE_READ;
+    if (m != FILE_READ)
+        makeParents(full);
+    m += "b";
+    FILE *fp = fopen(full.c_str(), m.c_str());
+    return fp ? File(fp, path) : File();
+}
+
+bool FS::exists(const char *path)
+{
+    struct stat st;
+    return stat(hostPath(path).c_str(), &st) == 0;
+}
+
+bool FS::remove(const char *path)
+{
+    return ::remove(hostPath(path).c_str()) == 0;
+}
+
+bool FS::rename(const char *from, const char *to)
+{
+    return ::rename(hostPath(from).c_str(), hostPath(to).c_str()) == 0;
+}
+
+} // namespace fs
@@ -0,0 +1,67 @@
+#pragma once
+
+// 主机端文件系统替身: fs::FS 把 "/xxx" 映射到本机目录 root 下的文件
+
+#include <Arduino.h>
+#include <memory>
+
+#define FILE_READ   "r"
+#define FILE_WRITE  "w"
+#define FILE_APPEND "a"
+
+namespace fs {
+
+enum SeekMode {
+    SeekSet = 0,
+    SeekCur = 1,
+    SeekEnd = 2
+};
+
+class File {
+public:
+    File() {}
+    File(FILE* fp, const char* path);
+
+    size_t write(const uint8_t* buf, size_t size);
+    size_t write(uint8_t c) { return write(&c, 1); }
+    size_t read(uint8_t* buf, size_t size);
+    int    read();
+    bool   seek(uint32_t pos, SeekMode mode = SeekSet);
+    size_t position() const;
+    size_t size() const;
+    int    available() { return (int)(size() - position()); }
+    void   flush();
+    void   close() { _fp.reset(); }
+    const char* path() const { return _path.c_str(); }
+    operator bool() const { return (bool)_fp; }
+
+private:
+    std::shared_ptr<FILE> _fp;   // 拷贝的 File 共用同一个打开的文件，和 Arduino 一样
+    std::string           _path;
+};
+
+class FS {
+public:
+    explicit FS(const char* root);   // 主机端特有: root 是本机目录，不存在时写入会自动创建
+
+    File open(const char* path, const char* mode = FILE_READ, bool create = false);
+    File open(const String& path, const char* mode = FILE_READ, bool create = false)
+    {
+        return open(path.c_str(), mode, create);
+    }
+    bool exists(const char* path);
+    bool exists(const String& path) { return exists(path.c_str()); }
+    bool remove(const char* path);
+    bool remove(const String& path) { return remove(path.c_str()); }
+    bool rename(const char* from, const char* to);
+
+    std::string hostPath(const char* path) const;
+
+private:
+    std::string _root;
+};
+
+} // namespace fs
+
+using fs::File;
+using fs::FS;
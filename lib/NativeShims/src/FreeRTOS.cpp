@@ -0,0 +1,369 @@
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/queue.h"
+#include "freertos/semphr.h"
+#include "esp_timer.h"
+
+#include <pthread.h>
+#include <string.h>
+#include <time.h>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// ====================== 实现部分 ======================
+
+namespace {
+
+std::recursive_mutex s_critical;
+
+struct HostTask {
+    TaskFunction_t          fn;
+    void*                   arg;
+    std::string             name;
+    std::mutex              lock;
+    std::condition_variable cv;
+    uint32_t                notify;
+    bool                    suspended;
+    bool                    deleted;
+};
+
+// 不是由 xTaskCreate 创建的线程(主线程)在第一次用到时补一个控制块
+thread_local HostTask* t_current = nullptr;
+
+HostTask* currentTask()
+{
+    if (!t_current)
+    {
+        t_current = new HostTask();
+        t_current->name = "main";
+    }
+    return t_current;
+}
+
+// 被 vTaskDelete() 删除的任务不会再被唤醒；控制块不释放，线程可能还阻塞在上面
+void parkIfDeleted(HostTask* task, std::unique_lock<std::mutex>& guard)
+{
+    while (task->deleted)
+        task->cv.wait(guard);
+}
+
+// 等待 cond 成立，ticks 为 portMAX_DELAY 时一直等
+template <typename Lock, typename Pred>
+bool waitTicks(std::condition_variable& cv, Lock& guard, TickType_t ticks, Pred cond)
+{
+    if (ticks == portMAX_DELAY)
+    {
+        cv.wait(guard, cond);
+        return true;
+    }
+    return cv.wait_for(guard, std::chrono::milliseconds(ticks), cond);
+}
+
+void* taskEntry(void* parameter)
+{
+    HostTask* task = static_cast<HostTask*>(parameter);
+    t_current = task;
+    task->fn(task->arg);
+    // FreeRTOS 的任务函数不能返回；这里按 vTaskDelete(NULL) 处理
+    return nullptr;
+}
+
+TaskHandle_t startTask(TaskFunction_t fn, const char* name, void* arg)
+{
+    HostTask* task = new HostTask();
+    task->fn = fn;
+    task->arg = arg;
+    task->name = name ? name : "";
+    task->notify = 0;
+    task->suspended = false;
+    task->deleted = false;
+
+    pthread_t thread;
+    if (pthread_create(&thread, nullptr, taskEntry, task) != 0)
+    {
+        delete task;
+        return nullptr;
+    }
+    pthread_detach(thread);
+    return task;
+}
+
+struct HostQueue {
+    std::mutex              lock;
+    std::condition_variable changed;
+    size_t                  itemSize;
+    size_t                  length;
+    std::deque<std::vector<uint8_t>> items;
+};
+
+BaseType_t queueSend(QueueHandle_t handle, const void* item, TickType_t ticks, bool front)
+{
+    HostQueue* q = static_cast<HostQueue*>(handle);
+    if (!q)
+        return pdFALSE;
+    std::unique_lock<std::mutex> guard(q->lock);
+    if (!waitTicks(q->changed, guard, ticks, [q] { return q->items.size() < q->length; }))
+        return pdFALSE;
+    std::vector<uint8_t> data(q->itemSize);
+    if (q->itemSize && item)
+        memcpy(data.data(), item, q->itemSize);
+    if (front)
+        q->items.push_front(std::move(data));
+    else
+        q->items.push_back(std::move(data));
+    q->changed.notify_all();
+    return pdTRUE;
+}
+
+} // namespace
+
+// ------------ 临界区 ------------
+void vPortEnterCritical(portMUX_TYPE* mux)
+{
+    s_critical.lock();
+    if (mux)
+        mux->count++;
+}
+
+void vPortExitCritical(portMUX_TYPE* mux)
+{
+    if (mux)
+        mux->count--;
+    s_critical.unlock();
+}
+
+// ------------ 任务 ------------
+BaseType_t xTaskCreatePinnedToCore(TaskFunction_t fn, const char* name, uint32_t stackDepth, void* arg,
+                                   UBaseType_t priority, TaskHandle_t* handle, BaseType_t core)
+{
+    (void)stackDepth;
+    (void)priority;
+    (void)core;
+    TaskHandle_t task = startTask(fn, name, arg);
+    if (handle)
+        *handle = task;
+    return task ? pdPASS : pdFAIL;
+}
+
+BaseType_t xTaskCreate(TaskFunction_t fn, const char* name, uint32_t stackDepth, void* arg,
+                       UBaseType_t priority, TaskHandle_t* handle)
+{
+    return xTaskCreatePinnedToCore(fn, name, stackDepth, arg, priority, handle, tskNO_AFFINITY);
+}
+
+TaskHandle_t xTaskCreateStaticPinnedToCore(TaskFunction_t fn, const char* name, uint32_t stackDepth, void* arg,
+                                           UBaseType_t priority, StackType_t* stack, StaticTask_t* tcb,
+                                           BaseType_t core)
+{
+    (void)stackDepth;
+    (void)priority;
+    (void)stack;
+    (void)tcb;
+    (void)core;
+    return startTask(fn, name, arg);
+}
+
+void vTaskDelete(TaskHandle_t handle)
+{
+    HostTask* task = handle ? static_cast<HostTask*>(handle) : currentTask();
+    if (task == currentTask())
+    {
+        t_current = nullptr;
+        pthread_exit(nullptr);
+    }
+    std::lock_guard<std::mutex> guard(task->lock);
+    task->deleted = true;
+}
+
+void vTaskSuspend(TaskHandle_t handle)
+{
+    HostTask* task = currentTask();
+    if (handle && handle != task)
+        return;     // 主机端不能从外部暂停线程
+    std::unique_lock<std::mutex> guard(task->lock);
+    task->suspended = true;
+    while (task->suspended || task->deleted)
+        task->cv.wait(guard);
+}
+
+void vTaskResume(TaskHandle_t handle)
+{
+    HostTask* task = static_cast<HostTask*>(handle);
+    if (!task)
+        return;
+    std::lock_guard<std::mutex> guard(task->lock);
+    task->suspended = false;
+    task->cv.notify_all();
+}
+
+eTaskState eTaskGetState(TaskHandle_t handle)
+{
+    HostTask* task = static_cast<HostTask*>(handle);
+    if (!task)
+        return eDeleted;
+    std::lock_guard<std::mutex> guard(task->lock);
+    if (task->deleted)
+        return eDeleted;
+    if (task->suspended)
+        return eSuspended;
+    return task == t_current ? eRunning : eReady;
+}
+
+TaskHandle_t xTaskGetCurrentTaskHandle()
+{
+    return currentTask();
+}
+
+void vTaskDelay(TickType_t ticks)
+{
+    struct timespec ts;
+    ts.tv_sec = ticks / 1000;
+    ts.tv_nsec = (long)(ticks % 1000) * 1000000L;
+    while (nanosleep(&ts, &ts) != 0)
+    {
+    }
+}
+
+TickType_t xTaskGetTickCount()
+{
+    return (TickType_t)(esp_timer_get_time() / 1000);
+}
+
+// ------------ 任务通知 ------------
+BaseType_t xTaskNotifyGive(TaskHandle_t handle)
+{
+    HostTask* task = static_cast<HostTask*>(handle);
+    if (!task)
+        return pdFAIL;
+    std::lock_guard<std::mutex> guard(task->lock);
+    task->notify++;
+    task->cv.notify_all();
+    return pdPASS;
+}
+
+uint32_t ulTaskNotifyTake(BaseType_t clearOnExit, TickType_t ticks)
+{
+    HostTask* task = currentTask();
+    std::unique_lock<std::mutex> guard(task->lock);
+    waitTicks(task->cv, guard, ticks, [task] { return task->notify > 0 && !task->deleted; });
+    parkIfDeleted(task, guard);
+    uint32_t value = task->notify;
+    if (value > 0)
+        task->notify = clearOnExit ? 0 : value - 1;
+    return value;
+}
+
+// ------------ 队列 ------------
+QueueHandle_t xQueueCreate(UBaseType_t length, UBaseType_t itemSize)
+{
+    if (length == 0)
+        return nullptr;
+    HostQueue* q = new HostQueue();
+    q->itemSize = itemSize;
+    q->length = length;
+    return q;
+}
+
+QueueHandle_t xQueueCreateStatic(UBaseType_t length, UBaseType_t itemSize, uint8_t* storage, StaticQueue_t* buffer)
+{
+    (void)storage;
+    (void)buffer;
+    return xQueueCreate(length, itemSize);
+}
+
+void vQueueDelete(QueueHandle_t handle)
+{
+    delete static_cast<HostQueue*>(handle);
+}
+
+BaseType_t xQueueSend(QueueHandle_t queue, const void* item, TickType_t ticks)
+{
+    return queueSend(queue, item, ticks, false);
+}
+
+BaseType_t xQueueSendToBack(QueueHandle_t queue, const void* item, TickType_t ticks)
+{
+    return queueSend(queue, item, ticks, false);
+}
+
+BaseType_t xQueueSendToFront(QueueHandle_t queue, const void* item, TickType_t ticks)
+{
+    return queueSend(queue, item, ticks, true);
+}
+
+BaseType_t xQueueReceive(QueueHandle_t handle, void* item, TickType_t ticks)
+{
+    HostQueue* q = static_cast<HostQueue*>(handle);
+    if (!q)
+        return pdFALSE;
+    std::unique_lock<std::mutex> guard(q->lock);
+    if (!waitTicks(q->changed, guard, ticks, [q] { return !q->items.empty(); }))
+        return pdFALSE;
+    if (q->itemSize && item)
+        memcpy(item, q->items.front().data(), q->itemSize);
+    q->items.pop_front();
+    q->changed.notify_all();
+    return pdTRUE;
+}
+
+BaseType_t xQueueReset(QueueHandle_t handle)
+{
+    HostQueue* q = static_cast<HostQueue*>(handle);
+    if (!q)
+        return pdFAIL;
+    std::lock_guard<std::mutex> guard(q->lock);
+    q->items.clear();
+    q->changed.notify_all();
+    return pdPASS;
+}
+
+UBaseType_t uxQueueMessagesWaiting(QueueHandle_t handle)
+{
+    HostQueue* q = static_cast<HostQueue*>(handle);
+    if (!q)
+        return 0;
+    std::lock_guard<std::mutex> guard(q->lock);
+    return (UBaseType_t)q->items.size();
+}
+
+UBaseType_t uxQueueSpacesAvailable(QueueHandle_t handle)
+{
+    HostQueue* q = static_cast<HostQueue*>(handle);
+    if (!q)
+        return 0;
+    std::lock_guard<std::mutex> guard(q->lock);
+    return (UBaseType_t)(q->length - q->items.size());
+}
+
+// ------------ 信号量 ------------
+SemaphoreHandle_t xSemaphoreCreateBinary()
+{
+    return xQueueCreate(1, 0);
+}
+
+SemaphoreHandle_t xSemaphoreCreateBinaryStatic(StaticSemaphore_t* buffer)
+{
+    (void)buffer;
+    return xSemaphoreCreateBinary();
+}
+
+SemaphoreHandle_t xSemaphoreCreateMutex()
+{
+    // 互斥锁创建后处于可获取状态；没有优先级继承
+    SemaphoreHandle_t sem = xQueueCreate(1, 0);
+    if (sem)
+        xQueueSend(sem, nullptr, 0);
+    return sem;
+}
+
+SemaphoreHandle_t xSemaphoreCreateCounting(UBaseType_t maxCount, UBaseType_t initialCount)
+{
+    SemaphoreHandle_t sem = xQueueCreate(maxCount, 0);
+    for (UBaseType_t i = 0; sem && i < initialCount; i++)
+        xQueueSend(sem, nullptr, 0);
+    return sem;
+}
@@ -0,0 +1,61 @@
+#include "driver/i2s.h"
+
+// ====================== 实现部分 ======================
+
+esp_err_t i2s_driver_install(i2s_port_t port, const i2s_config_t *config, int queueSize, QueueHandle_t *queue)
+{
+    (void)port;
+    (void)config;
+    (void)queueSize;
+    if (queue)
+        *queue = nullptr;
+    return ESP_ERR_NOT_SUPPORTED;
+}
+
+esp_err_t i2s_driver_uninstall(i2s_port_t port)
+{
+    (void)port;
+    return ESP_ERR_NOT_SUPPORTED;
+}
+
+esp_err_t i2s_set_pin(i2s_port_t port, const i2s_pin_config_t *pins)
+{
+    (void)port;
+    (void)pins;
+    return ESP_ERR_NOT_SUPPORTED;
+}
+
+esp_err_t i2s_set_sample_rates(i2s_port_t port, uint32_t rate)
+{
+    (void)port;
+    (void)rate;
+    return ESP_ERR_NOT_SUPPORTED;
+}
+
+esp_err_t i2s_zero_dma_buffer(i2s_port_t port)
+{
+    (void)port;
+    return ESP_ERR_NOT_SUPPORTED;
+}
+
+esp_err_t i2s_write(i2s_port_t port, const void *src, size_t size, size_t *bytesWritten, TickType_t ticks)
+{
+    (void)port;
+    (void)src;
+    (void)size;
+    (void)ticks;
+    if (bytesWritten)
+        *bytesWritten = 0;
+    return ESP_ERR_NOT_SUPPORTED;
+}
+
+esp_err_t i2s_read(i2s_port_t port, void *dest, size_t size, size_t *bytesRead, TickType_t ticks)
+{
+    (void)port;
+    (void)dest;
+    (void)size;
+    (void)ticks;
+    if (bytesRead)
+        *bytesRead = 0;
+    return ESP_ERR_NOT_SUPPORTED;
+}
@@ -0,0 +1,29 @@
+#pragma once
+
+#include "FS.h"
+
+// 默认对应工程的 data/ 目录，即 uploadfs 上传到设备的内容
+#ifndef NativeShims_SPIFFS_ROOT
+#define NativeShims_SPIFFS_ROOT "data"
+#endif
+
+namespace fs {
+
+class SPIFFSFS : public FS {
+public:
+    SPIFFSFS() : FS(NativeShims_SPIFFS_ROOT) {}
+    bool begin(bool formatOnFail = false, const char* basePath = "/spiffs", uint8_t maxOpenFiles = 10,
+               const char* partitionLabel = nullptr)
+    {
+        (void)formatOnFail;
+        (void)basePath;
+        (void)maxOpenFiles;
+        (void)partitionLabel;
+        return true;
+    }
+    void end() {}
+};
+
+} // namespace fs
+
+extern fs::SPIFFSFS SPIFFS;
@@ -0,0 +1,88 @@
+#pragma once
+
+// 主机端没有 I2S 外设: 类型和常量照抄旧版驱动，函数都返回 ESP_ERR_NOT_SUPPORTED。
+// 主机上播放需要先用 Megaphone::setSink() 换成 WavSink 之类的输出端
+
+#include <stdint.h>
+#include <stddef.h>
+#include "esp_err.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/queue.h"
+
+#define SOC_I2S_SUPPORTS_TDM 1
+#define I2S_PIN_NO_CHANGE    (-1)
+
+typedef enum {
+    I2S_NUM_0 = 0,
+    I2S_NUM_1 = 1,
+    I2S_NUM_MAX
+} i2s_port_t;
+
+typedef enum {
+    I2S_BITS_PER_SAMPLE_8BIT  = 8,
+    I2S_BITS_PER_SAMPLE_16BIT = 16,
+    I2S_BITS_PER_SAMPLE_24BIT = 24,
+    I2S_BITS_PER_SAMPLE_32BIT = 32
+} i2s_bits_per_sample_t;
+
+typedef enum {
+    I2S_CHANNEL_FMT_RIGHT_LEFT,
+    I2S_CHANNEL_FMT_ALL_RIGHT,
+    I2S_CHANNEL_FMT_ALL_LEFT,
+    I2S_CHANNEL_FMT_ONLY_RIGHT,
+    I2S_CHANNEL_FMT_ONLY_LEFT,
+    I2S_CHANNEL_FMT_MULTIPLE
+} i2s_channel_fmt_t;
+
+typedef enum {
+    I2S_COMM_FORMAT_STAND_I2S = 0x01,
+    I2S_COMM_FORMAT_STAND_MSB = 0x02
+} i2s_comm_format_t;
+
+typedef enum {
+    I2S_MODE_MASTER = 1,
+    I2S_MODE_SLAVE  = 2,
+    I2S_MODE_TX     = 4,
+    I2S_MODE_RX     = 8
+} i2s_mode_t;
+
+typedef enum {
+    I2S_CHANNEL_MONO    = 1,
+    I2S_CHANNEL_STEREO  = 2,
+    I2S_TDM_ACTIVE_CH0  = (1 << 16),
+    I2S_TDM_ACTIVE_CH1  = (1 << 17)
+} i2s_channel_t;
+
+typedef struct {
+    i2s_mode_t            mode;
+    uint32_t              sample_rate;
+    i2s_bits_per_sample_t bits_per_sample;
+    i2s_channel_fmt_t     channel_format;
+    i2s_comm_format_t     communication_format;
+    int                   intr_alloc_flags;
+    int                   dma_buf_count;
+    int                   dma_buf_len;
+    bool                  use_apll;
+    bool                  tx_desc_auto_clear;
+    int                   fixed_mclk;
+    int                   mclk_multiple;
+    int                   bits_per_chan;
+    i2s_channel_t         chan_mask;
+    uint32_t              total_chan;
+} i2s_config_t;
+
+typedef struct {
+    int mck_io_num;
+    int bck_io_num;
+    int ws_io_num;
+    int data_out_num;
+    int data_in_num;
+} i2s_pin_config_t;
+
+esp_err_t i2s_driver_install(i2s_port_t port, const i2s_config_t* config, int queueSize, QueueHandle_t* queue);
+esp_err_t i2s_driver_uninstall(i2s_port_t port);
+esp_err_t i2s_set_pin(i2s_port_t port, const i2s_pin_config_t* pins);
+esp_err_t i2s_set_sample_rates(i2s_port_t port, uint32_t rate);
+esp_err_t i2s_zero_dma_buffer(i2s_port_t port);
+esp_err_t i2s_write(i2s_port_t port, const void* src, size_t size, size_t* bytesWritten, TickType_t ticks);
+esp_err_t i2s_read(i2s_port_t port, void* dest, size_t size, size_t* bytesRead, TickType_t ticks);
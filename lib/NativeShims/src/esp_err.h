@@ -0,0 +1,8 @@
+#pragma once
+
+typedef int esp_err_t;
+
+#define ESP_OK                  0
+#define ESP_FAIL                -1
+#define ESP_ERR_NOT_SUPPORTED   0x106
+#define ESP_INTR_FLAG_LEVEL1    (1 << 1)
@@ -0,0 +1,5 @@
+#pragma once
+
+#include <stdint.h>
+
+int64_t esp_timer_get_time();   // 启动后经过的微秒数(单调时钟)
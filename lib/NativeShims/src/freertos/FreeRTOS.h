@@ -0,0 +1,37 @@
+#pragma once
+
+// 主机端 FreeRTOS 替身: 任务是 pthread，1 tick = 1ms，只实现播放引擎用到的接口
+
+#include <stdint.h>
+#include <stddef.h>
+
+typedef uint32_t TickType_t;
+typedef int      BaseType_t;
+typedef unsigned UBaseType_t;
+typedef uint8_t  StackType_t;
+
+#define configTICK_RATE_HZ   1000
+#define portTICK_PERIOD_MS   1
+#define portMAX_DELAY        0xffffffffUL
+#define pdMS_TO_TICKS(ms)    ((TickType_t)(ms))
+#define pdTRUE               1
+#define pdFALSE              0
+#define pdPASS               1
+#define pdFAIL               0
+#define tskNO_AFFINITY       0x7fffffff
+
+// 静态创建时由调用者提供的控制块，主机端不使用
+typedef struct { void* unused; } StaticTask_t;
+typedef struct { void* unused; } StaticQueue_t;
+typedef StaticQueue_t StaticSemaphore_t;
+
+// 临界区: 所有 portMUX 共用一把递归锁，相当于单核关中断
+typedef struct { uint32_t owner; uint32_t count; } portMUX_TYPE;
+#define portMUX_INITIALIZER_UNLOCKED {0, 0}
+
+void vPortEnterCritical(portMUX_TYPE* mux);
+void vPortExitCritical(portMUX_TYPE* mux);
+#define portENTER_CRITICAL(mux)     vPortEnterCritical(mux)
+#define portEXIT_CRITICAL(mux)      vPortExitCritical(mux)
+#define portENTER_CRITICAL_ISR(mux) vPortEnterCritical(mux)
+#define portEXIT_CRITICAL_ISR(mux)  vPortExitCritical(mux)
@@ -0,0 +1,17 @@
+#pragma once
+
+#include "freertos/FreeRTOS.h"
+
+typedef void* QueueHandle_t;
+
+QueueHandle_t xQueueCreate(UBaseType_t length, UBaseType_t itemSize);
+QueueHandle_t xQueueCreateStatic(UBaseType_t length, UBaseType_t itemSize, uint8_t* storage, StaticQueue_t* buffer);
+void          vQueueDelete(QueueHandle_t queue);
+
+BaseType_t    xQueueSend(QueueHandle_t queue, const void* item, TickType_t ticks);
+BaseType_t    xQueueSendToBack(QueueHandle_t queue, const void* item, TickType_t ticks);
+BaseType_t    xQueueSendToFront(QueueHandle_t queue, const void* item, TickType_t ticks);
+BaseType_t    xQueueReceive(QueueHandle_t queue, void* item, TickType_t ticks);
+BaseType_t    xQueueReset(QueueHandle_t queue);
+UBaseType_t   uxQueueMessagesWaiting(QueueHandle_t queue);
+UBaseType_t   uxQueueSpacesAvailable(QueueHandle_t queue);
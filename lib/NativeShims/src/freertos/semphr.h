@@ -0,0 +1,15 @@
+#pragma once
+
+#include "freertos/queue.h"
+
+// 信号量是条目长度为 0 的队列，和 FreeRTOS 的实现一样
+typedef QueueHandle_t SemaphoreHandle_t;
+
+SemaphoreHandle_t xSemaphoreCreateBinary();
+SemaphoreHandle_t xSemaphoreCreateBinaryStatic(StaticSemaphore_t* buffer);
+SemaphoreHandle_t xSemaphoreCreateMutex();
+SemaphoreHandle_t xSemaphoreCreateCounting(UBaseType_t maxCount, UBaseType_t initialCount);
+
+#define xSemaphoreTake(sem, ticks)  xQueueReceive((sem), NULL, (ticks))
+#define xSemaphoreGive(sem)         xQueueSend((sem), NULL, 0)
+#define vSemaphoreDelete(sem)       vQueueDelete(sem)
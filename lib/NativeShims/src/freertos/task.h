@@ -0,0 +1,40 @@
+#pragma once
+
+#include "freertos/FreeRTOS.h"
+
+typedef void* TaskHandle_t;
+typedef void (*TaskFunction_t)(void*);
+
+typedef enum {
+    eRunning = 0,
+    eReady,
+    eBlocked,
+    eSuspended,
+    eDeleted
+} eTaskState;
+
+// 优先级、核心和栈大小只用于兼容，主机端由系统调度
+BaseType_t   xTaskCreatePinnedToCore(TaskFunction_t fn, const char* name, uint32_t stackDepth, void* arg,
+                                     UBaseType_t priority, TaskHandle_t* handle, BaseType_t core);
+BaseType_t   xTaskCreate(TaskFunction_t fn, const char* name, uint32_t stackDepth, void* arg,
+                         UBaseType_t priority, TaskHandle_t* handle);
+TaskHandle_t xTaskCreateStaticPinnedToCore(TaskFunction_t fn, const char* name, uint32_t stackDepth, void* arg,
+                                           UBaseType_t priority, StackType_t* stack, StaticTask_t* tcb,
+                                           BaseType_t core);
+/**
+ * @brief 删除任务
+ *
+ * NULL 表示当前任务，线程直接退出。pthread 不能从外部终止，删除其他任务时
+ * 只支持已经挂起(vTaskSuspend(NULL))或阻塞在本模块接口里的任务，它们不会再被唤醒。
+ */
+void         vTaskDelete(TaskHandle_t task);
+void         vTaskSuspend(TaskHandle_t task);   // 只支持挂起当前任务(NULL)
+void         vTaskResume(TaskHandle_t task);
+eTaskState   eTaskGetState(TaskHandle_t task);
+TaskHandle_t xTaskGetCurrentTaskHandle();
+
+void         vTaskDelay(TickType_t ticks);
+TickType_t   xTaskGetTickCount();
+
+BaseType_t   xTaskNotifyGive(TaskHandle_t task);
+uint32_t     ulTaskNotifyTake(BaseType_t clearOnExit, TickType_t ticks);
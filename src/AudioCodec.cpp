@@ -0,0 +1,188 @@
+#include "Megaphone/AudioCodec.hpp"
+
+// ====================== 实现部分 ======================
+
+// ------------ IMA-ADPCM ------------
+static const int16_t kImaStepTable[89] = {
+    7, 8, 9, 10, 11, 12, 13, 14, 16, 17,
+    19, 21, 23, 25, 28, 31, 34, 37, 41, 45,
+    50, 55, 60, 66, 73, 80, 88, 97, 107, 118,
+    130, 143, 157, 173, 190, 209, 230, 253, 279, 307,
+    337, 371, 408, 449, 494, 544, 598, 658, 724, 796,
+    876, 963, 1060, 1166, 1282, 1411, 1552, 1707, 1878, 2066,
+    2272, 2499, 2749, 3024, 3327, 3660, 4026, 4428, 4871, 5358,
+    5894, 6484, 7132, 7845, 8630, 9493, 10442, 11487, 12635, 13899,
+    15289, 16818, 18500, 20350, 22385, 24623, 27086, 29794, 32767};
+
+static const int8_t kImaIndexTable[16] = {
+    -1, -1, -1, -1, 2, 4, 6, 8,
+    -1, -1, -1, -1, 2, 4, 6, 8};
+
+ImaAdpcmDecoder::ImaAdpcmDecoder(bool blockHeader)
+    : _blockHeader(blockHeader)
+{
+    reset();
+}
+
+void ImaAdpcmDecoder::reset()
+{
+    _predictor = 0;
+    _stepIndex = 0;
+    _headerBytes = _blockHeader ? 0 : 4;
+    _hasPending = false;
+    _pending = 0;
+}
+
+void ImaAdpcmDecoder::startPacket()
+{
+    // 没有包头时状态跨包延续
+    if (_blockHeader)
+    {
+        _headerBytes = 0;
+        _hasPending = false;
+    }
+}
+
+size_t ImaAdpcmDecoder::maxOutput(size_t inBytes) const
+{
+    size_t samples = (_hasPending ? 1 : 0);
+    if (_blockHeader && _headerBytes < 4)
+    {
+        size_t header = 4 - _headerBytes;
+        if (inBytes < header)
+            return samples;
+        return samples + 1 + (inBytes - header) * 2;
+    }
+    return samples + inBytes * 2;
+}
+
+int16_t ImaAdpcmDecoder::decodeNibble(uint8_t nibble)
+{
+    int32_t step = kImaStepTable[_stepIndex];
+    int32_t diff = step >> 3;
+    if (nibble & 4) diff += step;
+    if (nibble & 2) diff += step >> 1;
+    if (nibble & 1) diff += step >> 2;
+
+    int32_t predictor = (nibble & 8) ? _predictor - diff : _predictor + diff;
+    if (predictor > 32767) predictor = 32767;
+    if (predictor < -32768) predictor = -32768;
+    _predictor = predictor;
+
+    int index = _stepIndex + kImaIndexTable[nibble];
+    if (index < 0) index = 0;
+    if (index > 88) index = 88;
+    _stepIndex = index;
+    return (int16_t)predictor;
+}
+
+size_t ImaAdpcmDecoder::decode(const uint8_t *in, size_t inBytes, size_t &consumed,
+                               int16_t *out, size_t maxSamples)
+{
+    consumed = 0;
+    size_t produced = 0;
+    if (!out || maxSamples == 0)
+        return 0;
+
+    if (_hasPending)
+    {
+        out[produced++] = _pending;
+        _hasPending = false;
+    }
+
+    // 包头可能被拆在两次调用之间
+    while (_headerBytes < 4 && consumed < inBytes)
+    {
+        _header[_headerBytes++] = in[consumed++];
+        if (_headerBytes == 4)
+        {
+            _predictor = (int16_t)(_header[0] | (_header[1] << 8));
+            _stepIndex = _header[2] > 88 ? 88 : _header[2];
+            if (produced < maxSamples)
+            {
+                out[produced++] = (int16_t)_predictor;
+            }
+            else
+            {
+                _pending = (int16_t)_predictor;
+                _hasPending = true;
+                return produced;
+            }
+        }
+    }
+
+    while (consumed < inBytes && produced < maxSamples)
+    {
+        uint8_t byte = in[consumed++];
+        out[produced++] = decodeNibble(byte & 0x0F);
+        int16_t second = decodeNibble(byte >> 4);
+        if (produced < maxSamples)
+        {
+            out[produced++] = second;
+        }
+        else
+        {
+            _pending = second;
+            _hasPending = true;
+        }
+    }
+    return produced;
+}
+
+// ------------ G.711 ------------
+static int16_t s_muLawTable[256];
+static int16_t s_aLawTable[256];
+static bool s_g711TablesReady = false;
+
+int16_t G711Decoder::muLawToLinear(uint8_t code)
+{
+    code = ~code;
+    int32_t t = ((code & 0x0F) << 3) + 0x84;
+    t <<= (code & 0x70) >> 4;
+    return (int16_t)((code & 0x80) ? (0x84 - t) : (t - 0x84));
+}
+
+int16_t G711Decoder::aLawToLinear(uint8_t code)
+{
+    code ^= 0x55;
+    int32_t t = (code & 0x0F) << 4;
+    int seg = (code & 0x70) >> 4;
+    if (seg == 0)
+    {
+        t += 8;
+    }
+    else
+    {
+        t += 0x108;
+        t <<= seg - 1;
+    }
+    return (int16_t)((code & 0x80) ? t : -t);
+}
+
+G711Decoder::G711Decoder(CodecType law)
+    : _law(law == CodecType::ALaw ? CodecType::ALaw : CodecType::MuLaw)
+{
+    // 512 字节的表在第一次构造时生成，之后每个采样只查一次表
+    if (!s_g711TablesReady)
+    {
+        for (int i = 0; i < 256; i++)
+        {
+            s_muLawTable[i] = muLawToLinear((uint8_t)i);
+            s_aLawTable[i] = aLawToLinear((uint8_t)i);
+        }
+        s_g711TablesReady = true;
+    }
+    _table = (_law == CodecType::ALaw) ? s_aLawTable : s_muLawTable;
+}
+
+size_t G711Decoder::decode(const uint8_t *in, size_t inBytes, size_t &consumed,
+                           int16_t *out, size_t maxSamples)
+{
+    size_t n = inBytes < maxSamples ? inBytes : maxSamples;
+    for (size_t i = 0; i < n; i++)
+    {
+        out[i] = _table[in[i]];
+    }
+    consumed = n;
+    return n;
+}
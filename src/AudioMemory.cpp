@@ -0,0 +1,116 @@
+#include "AudioMemory/AudioMemory.hpp"
+
+// ====================== 实现部分 ======================
+
+AudioPoolStats AudioMemory::s_stats[(int)AudioPool::Count] = {};
+portMUX_TYPE   AudioMemory::s_lock = portMUX_INITIALIZER_UNLOCKED;
+
+uint32_t AudioMemory::capsFor(AudioPool pool)
+{
+    switch (pool)
+    {
+    case AudioPool::Dma:
+        return MALLOC_CAP_DMA | MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT;
+    case AudioPool::Psram:
+        return MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT;
+    case AudioPool::Internal:
+    default:
+        return MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT;
+    }
+}
+
+bool AudioMemory::hasPsram()
+{
+    return psramFound();
+}
+
+void *AudioMemory::alloc(size_t bytes, AudioPool pool)
+{
+    if (bytes == 0)
+        return nullptr;
+
+    AudioPool placed = pool;
+    bool fallback = false;
+    if (pool == AudioPool::Psram && !hasPsram())
+    {
+        placed = AudioPool::Internal;
+        fallback = true;
+    }
+
+    BlockHeader *header = (BlockHeader *)heap_caps_malloc(sizeof(BlockHeader) + bytes, capsFor(placed));
+    if (!header && placed == AudioPool::Psram)
+    {
+        // PSRAM 不够时退回内部 RAM，总比直接失败好
+        placed = AudioPool::Internal;
+        fallback = true;
+        header = (BlockHeader *)heap_caps_malloc(sizeof(BlockHeader) + bytes, capsFor(placed));
+    }
+
+    portENTER_CRITICAL(&s_lock);
+    if (!header)
+    {
+        s_stats[(int)pool].failures++;
+        portEXIT_CRITICAL(&s_lock);
+        Serial.printf("AudioMemory: Failed to allocate %u bytes\n", (unsigned)bytes);
+        return nullptr;
+    }
+    AudioPoolStats &st = s_stats[(int)placed];
+    st.allocs++;
+    st.inUse += bytes;
+    if (st.inUse > st.peak)
+        st.peak = st.inUse;
+    if (fallback)
+        s_stats[(int)pool].fallbacks++;
+    portEXIT_CRITICAL(&s_lock);
+
+    header->size = bytes;
+    header->pool = (uint8_t)placed;
+    return header + 1;
+}
+
+void *AudioMemory::calloc(size_t bytes, AudioPool pool)
+{
+    void *ptr = alloc(bytes, pool);
+    if (ptr)
+        memset(ptr, 0, bytes);
+    return ptr;
+}
+
+void AudioMemory::free(void *ptr)
+{
+    if (!ptr)
+        return;
+
+    BlockHeader *header = (BlockHeader *)ptr - 1;
+    portENTER_CRITICAL(&s_lock);
+    AudioPoolStats &st = s_stats[header->pool];
+    st.frees++;
+    st.inUse -= header->size;
+    portEXIT_CRITICAL(&s_lock);
+
+    heap_caps_free(header);
+}
+
+AudioPoolStats AudioMemory::getStats(AudioPool pool)
+{
+    AudioPoolStats snapshot;
+    portENTER_CRITICAL(&s_lock);
+    snapshot = s_stats[(int)pool];
+    portEXIT_CRITICAL(&s_lock);
+    return snapshot;
+}
+
+void AudioMemory::printStats()
+{
+    static const char *names[(int)AudioPool::Count] = {"internal", "dma", "psram"};
+    for (int i = 0; i < (int)AudioPool::Count; i++)
+    {
+        AudioPoolStats st = getStats((AudioPool)i);
+        Serial.printf("AudioMemory: %-8s inUse=%u peak=%u allocs=%u frees=%u failures=%u fallbacks=%u\n",
+                      names[i], (unsigned)st.inUse, (unsigned)st.peak, st.allocs, st.frees,
+                      st.failures, st.fallbacks);
+    }
+    Serial.printf("AudioMemory: heap free internal=%u psram=%u\n",
+                  (unsigned)heap_caps_get_free_size(MALLOC_CAP_INTERNAL),
+                  (unsigned)heap_caps_get_free_size(MALLOC_CAP_SPIRAM));
+}
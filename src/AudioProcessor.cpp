@@ -64,6 +64,97 @@ void AudioProcessor::convertFloatToInt16(const float* input, int16_t* output, si
     }
 }
 
+// ======================== 混音 ========================
+void AudioProcessor::mixAccumulate(int32_t* accumulator, const int16_t* samples, size_t sampleCount,
+                                   int32_t gainFromQ15, int32_t gainToQ15) {
+    if (!accumulator || !samples || sampleCount == 0) return;
+    if (gainFromQ15 == gainToQ15) {
+        if (gainToQ15 == 0) return;
+        // 32 位累加，最后统一饱和一次；两点一组减少循环开销
+        size_t i = 0;
+        for (; i + 1 < sampleCount; i += 2) {
+            accumulator[i]     += (samples[i]     * gainToQ15) >> 15;
+            accumulator[i + 1] += (samples[i + 1] * gainToQ15) >> 15;
+        }
+        if (i < sampleCount) {
+            accumulator[i] += (samples[i] * gainToQ15) >> 15;
+        }
+        return;
+    }
+    // 增益变化时逐点插值，避免块边界上的台阶噪声(增益放大 256 倍保留小数)
+    int32_t gain = gainFromQ15 << 8;
+    int32_t step = ((gainToQ15 - gainFromQ15) << 8) / (int32_t)sampleCount;
+    for (size_t i = 0; i < sampleCount; i++) {
+        accumulator[i] += (samples[i] * (gain >> 8)) >> 15;
+        gain += step;
+    }
+}
+
+void AudioProcessor::saturateToInt16(const int32_t* accumulator, int16_t* output, size_t sampleCount) {
+    if (!accumulator || !output || sampleCount == 0) return;
+    for (size_t i = 0; i < sampleCount; i++) {
+        int32_t v = accumulator[i];
+        if (v > 32767)  v = 32767;
+        if (v < -32768) v = -32768;
+        output[i] = static_cast<int16_t>(v);
+    }
+}
+
+void AudioProcessor::saturateInterleave(const int32_t* accumulator, size_t planeStride, uint8_t channels,
+                                        int16_t* output, size_t frames) {
+    if (!accumulator || !output || frames == 0 || channels == 0) return;
+    if (channels == 1) {
+        saturateToInt16(accumulator, output, frames);
+        return;
+    }
+    if (channels == 2 && ((uintptr_t)output & 3) == 0) {
+        // 立体声: 左右两个采样拼成一个 32 位字写出，每帧一次存储
+        const int32_t* left = accumulator;
+        const int32_t* right = accumulator + planeStride;
+        uint32_t* out = reinterpret_cast<uint32_t*>(output);
+        for (size_t i = 0; i < frames; i++) {
+            int32_t l = left[i];
+            int32_t r = right[i];
+            l = l > 32767 ? 32767 : (l < -32768 ? -32768 : l);
+            r = r > 32767 ? 32767 : (r < -32768 ? -32768 : r);
+            out[i] = (uint32_t)(uint16_t)l | ((uint32_t)(uint16_t)r << 16);
+        }
+        return;
+    }
+    // TDM: 按声道顺序写每一帧
+    for (size_t i = 0; i < frames; i++) {
+        const int32_t* in = accumulator + i;
+        for (uint8_t c = 0; c < channels; c++) {
+            int32_t v = in[c * planeStride];
+            if (v > 32767)  v = 32767;
+            if (v < -32768) v = -32768;
+            *output++ = static_cast<int16_t>(v);
+        }
+    }
+}
+
+int32_t AudioProcessor::gainToQ15(float gain) {
+    if (gain <= 0.0f) return 0;
+    float q = gain * 32768.0f + 0.5f;
+    if (q > 65535.0f) q = 65535.0f;   // int16 * 65535 仍在 int32 范围内
+    return static_cast<int32_t>(q);
+}
+
+int32_t AudioProcessor::mulQ15(int32_t a, int32_t b) {
+    int64_t q = ((int64_t)a * b) >> 15;
+    return q > 65535 ? 65535 : (q < 0 ? 0 : (int32_t)q);
+}
+
+void AudioProcessor::applyGainQ15(int16_t* samples, size_t sampleCount, int32_t gainQ15) {
+    if (!samples || sampleCount == 0 || gainQ15 == 32768) return;
+    for (size_t i = 0; i < sampleCount; i++) {
+        int32_t v = (samples[i] * gainQ15) >> 15;
+        if (v > 32767)  v = 32767;
+        if (v < -32768) v = -32768;
+        samples[i] = static_cast<int16_t>(v);
+    }
+}
+
 // ======================== 声音效果处理 ========================
 void AudioProcessor::applyEcho(int16_t* samples, size_t sampleCount, float delay, float decay) {    // delay: 延迟时间(秒), decay: 衰减系数(0~1)
     if (!samples || sampleCount == 0) return;
@@ -0,0 +1,260 @@
+#include "MicRecorder/CaptureRing.hpp"
+#include "AudioMemory/AudioMemory.hpp"
+
+// ====================== 实现部分 ======================
+
+CaptureRing::CaptureRing()
+    : _buffer(nullptr),
+      _capacity(0),
+      _mask(0),
+      _writePos(0),
+      _stopped(false),
+      _lock(portMUX_INITIALIZER_UNLOCKED)
+{
+    for (int i = 0; i < CaptureRing_MAX_CONSUMERS; i++)
+    {
+        _consumers[i].active = false;
+        _consumers[i].readPos = 0;
+        _consumers[i].overruns = 0;
+        _consumers[i].dataReady = nullptr;
+    }
+}
+
+CaptureRing::~CaptureRing()
+{
+    end();
+}
+
+bool CaptureRing::begin(size_t capacitySamples)
+{
+    _stopped = false;
+    if (_buffer)
+        return true;
+
+    // 容量取 2 的幂，读写位置可以直接用掩码回绕
+    size_t cap = 1;
+    while (cap < capacitySamples)
+        cap <<= 1;
+
+    // 采集环对延迟不敏感，放在 PSRAM 里
+    _buffer = (int16_t *)AudioMemory::alloc(cap * sizeof(int16_t), AudioPool::Psram);
+    if (!_buffer)
+    {
+        Serial.println("CaptureRing: Malloc failed!");
+        return false;
+    }
+    memset(_buffer, 0, cap * sizeof(int16_t));
+    _capacity = cap;
+    _mask = cap - 1;
+    _writePos.store(0);
+    return true;
+}
+
+void CaptureRing::end()
+{
+    // 调用前生产者必须已经退出，信号量只在这里删除
+    for (int i = 0; i < CaptureRing_MAX_CONSUMERS; i++)
+    {
+        closeConsumer(i);
+        if (_consumers[i].dataReady)
+        {
+            vSemaphoreDelete(_consumers[i].dataReady);
+            _consumers[i].dataReady = nullptr;
+        }
+    }
+    if (_buffer)
+    {
+        AudioMemory::free(_buffer);
+        _buffer = nullptr;
+    }
+    _capacity = 0;
+    _mask = 0;
+}
+
+void CaptureRing::stop()
+{
+    // 生产者不再写入: 唤醒所有阻塞的消费者，读完剩余数据后 read() 直接返回
+    _stopped = true;
+    for (int i = 0; i < CaptureRing_MAX_CONSUMERS; i++)
+    {
+        if (_consumers[i].dataReady)
+        {
+            xSemaphoreGive(_consumers[i].dataReady);
+        }
+    }
+}
+
+bool CaptureRing::isValid(int id) const
+{
+    return id >= 0 && id < CaptureRing_MAX_CONSUMERS && _consumers[id].active;
+}
+
+// ------------ 生产者 ------------
+void CaptureRing::write(const int16_t *samples, size_t count)
+{
+    if (!_buffer || !samples || count == 0)
+        return;
+
+    // 单次写入超过容量时只保留最后 capacity 个点
+    if (count > _capacity)
+    {
+        samples += count - _capacity;
+        count = _capacity;
+    }
+
+    uint32_t pos = _writePos.load(std::memory_order_relaxed);
+    size_t offset = pos & _mask;
+    size_t first = _capacity - offset;
+    if (first > count)
+        first = count;
+    memcpy(_buffer + offset, samples, first * sizeof(int16_t));
+    if (count > first)
+    {
+        memcpy(_buffer, samples + first, (count - first) * sizeof(int16_t));
+    }
+    _writePos.store(pos + count, std::memory_order_release);
+
+    for (int i = 0; i < CaptureRing_MAX_CONSUMERS; i++)
+    {
+        if (_consumers[i].active && _consumers[i].dataReady)
+        {
+            xSemaphoreGive(_consumers[i].dataReady);
+        }
+    }
+}
+
+// ------------ 消费者 ------------
+int CaptureRing::openConsumer()
+{
+    if (!_buffer)
+        return -1;
+
+    for (int i = 0; i < CaptureRing_MAX_CONSUMERS; i++)
+    {
+        if (_consumers[i].active)
+            continue;
+
+        if (!_consumers[i].dataReady)
+        {
+            _consumers[i].dataReady = xSemaphoreCreateBinary();
+            if (!_consumers[i].dataReady)
+                return -1;
+        }
+        portENTER_CRITICAL(&_lock);
+        _consumers[i].readPos = _writePos.load();
+        _consumers[i].overruns = 0;
+        _consumers[i].active = true;
+        portEXIT_CRITICAL(&_lock);
+        // 清掉上一个使用者留下的通知
+        xSemaphoreTake(_consumers[i].dataReady, 0);
+        return i;
+    }
+    Serial.println("CaptureRing: No free consumer slot!");
+    return -1;
+}
+
+void CaptureRing::closeConsumer(int id)
+{
+    if (id < 0 || id >= CaptureRing_MAX_CONSUMERS)
+        return;
+
+    portENTER_CRITICAL(&_lock);
+    _consumers[id].active = false;
+    portEXIT_CRITICAL(&_lock);
+
+    // 生产者可能正在 give 这个信号量，不在这里删除(留给下次 openConsumer 复用，end() 时删除)；
+    // give 一次唤醒还阻塞在 read() 里的消费者
+    if (_consumers[id].dataReady)
+    {
+        xSemaphoreGive(_consumers[id].dataReady);
+    }
+}
+
+size_t CaptureRing::available(int id) const
+{
+    if (!isValid(id))
+        return 0;
+    uint32_t pending = _writePos.load(std::memory_order_acquire) - _consumers[id].readPos;
+    return pending > _capacity ? _capacity : pending;
+}
+
+void CaptureRing::skipToLatest(int id)
+{
+    if (!isValid(id))
+        return;
+    _consumers[id].readPos = _writePos.load(std::memory_order_acquire);
+}
+
+size_t CaptureRing::read(int id, int16_t *out, size_t maxSamples, TickType_t timeout)
+{
+    if (!isValid(id) || !out || maxSamples == 0)
+        return 0;
+
+    Consumer &c = _consumers[id];
+    TickType_t start = xTaskGetTickCount();
+    size_t total = 0;
+
+    while (total < maxSamples)
+    {
+        uint32_t writePos = _writePos.load(std::memory_order_acquire);
+        uint32_t pending = writePos - c.readPos;
+
+        // 被生产者追上：跳过已被覆盖的数据，留出 1/4 余量避免马上再次被覆盖
+        if (pending > _capacity)
+        {
+            c.overruns++;
+            c.readPos = writePos - (_capacity - _capacity / 4);
+            pending = writePos - c.readPos;
+        }
+
+        if (pending == 0)
+        {
+            if (_stopped || !c.active)
+                break;
+            TickType_t waited = xTaskGetTickCount() - start;
+            if (timeout != portMAX_DELAY && waited >= timeout)
+                break;
+            TickType_t wait = (timeout == portMAX_DELAY) ? portMAX_DELAY : timeout - waited;
+            if (xSemaphoreTake(c.dataReady, wait) != pdTRUE)
+                break;
+            continue;
+        }
+
+        size_t n = maxSamples - total;
+        if (n > pending)
+            n = pending;
+        size_t offset = c.readPos & _mask;
+        size_t first = _capacity - offset;
+        if (first > n)
+            first = n;
+        memcpy(out + total, _buffer + offset, first * sizeof(int16_t));
+        if (n > first)
+        {
+            memcpy(out + total + first, _buffer, (n - first) * sizeof(int16_t));
+        }
+
+        // 拷贝过程中又被覆盖，数据已经不完整
+        if (_writePos.load(std::memory_order_acquire) - c.readPos > _capacity)
+        {
+            c.overruns++;
+        }
+        c.readPos += n;
+        total += n;
+    }
+    return total;
+}
+
+uint32_t CaptureRing::getOverruns(int id) const
+{
+    if (id < 0 || id >= CaptureRing_MAX_CONSUMERS)
+        return 0;
+    return _consumers[id].overruns;
+}
+
+void CaptureRing::resetOverruns()
+{
+    for (int i = 0; i < CaptureRing_MAX_CONSUMERS; i++)
+    {
+        _consumers[i].overruns = 0;
+    }
+}
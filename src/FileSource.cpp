@@ -0,0 +1,245 @@
+#include "Megaphone/FileSource.hpp"
+#include "AudioMemory/AudioMemory.hpp"
+
+// ====================== 实现部分 ======================
+
+FileSource::FileSource(Megaphone &megaphone, fs::FS &fs)
+    : _megaphone(megaphone),
+      _fs(fs),
+      _buffer(nullptr),
+      _requests(nullptr),
+      _doneSem(nullptr),
+      _taskHandle(nullptr),
+      _stream(-1),
+      _busy(false),
+      _stopRequested(false)
+{
+}
+
+FileSource::~FileSource()
+{
+    end();
+}
+
+bool FileSource::begin()
+{
+    if (_taskHandle)
+        return true;
+
+    // 读 flash 的缓冲放在内部 RAM，避免和 PSRAM 上的播放缓冲争总线
+    _buffer = (int16_t *)AudioMemory::alloc(FileSource_READ_SAMPLES * sizeof(int16_t), AudioPool::Internal);
+    _requests = xQueueCreate(FileSource_QUEUE_LEN, sizeof(Request));
+    _doneSem = xSemaphoreCreateBinary();
+    if (!_buffer || !_requests || !_doneSem)
+    {
+        Serial.println("FileSource: Failed to allocate buffers!");
+        end();
+        return false;
+    }
+
+    if (xTaskCreatePinnedToCore(prefetchTask, "fileSourceTask", 4096, this,
+                                FileSource_TASK_PRIORITY, &_taskHandle, 0) != pdPASS)
+    {
+        Serial.println("FileSource: Failed to create prefetch task!");
+        _taskHandle = nullptr;
+        end();
+        return false;
+    }
+    return true;
+}
+
+void FileSource::end()
+{
+    if (_taskHandle)
+    {
+        // 停掉当前文件，再发一个空请求让任务退出
+        stop();
+        Request quit = {};
+        xQueueSend(_requests, &quit, portMAX_DELAY);
+        xSemaphoreTake(_doneSem, portMAX_DELAY);
+        _taskHandle = nullptr;
+    }
+    if (_buffer)
+    {
+        AudioMemory::free(_buffer);
+        _buffer = nullptr;
+    }
+    if (_requests)
+    {
+        vQueueDelete(_requests);
+        _requests = nullptr;
+    }
+    if (_doneSem)
+    {
+        vSemaphoreDelete(_doneSem);
+        _doneSem = nullptr;
+    }
+}
+
+bool FileSource::play(const char *path, uint8_t priority, float gain,
+                      Megaphone::PlaybackCallback onDone, void *context)
+{
+    if (!_taskHandle || !path || path[0] == '\0' || strlen(path) >= FileSource_MAX_PATH)
+        return false;
+
+    Request req;
+    strncpy(req.path, path, FileSource_MAX_PATH);
+    req.priority = priority;
+    req.gain = gain;
+    req.onDone = onDone;
+    req.context = context;
+    if (xQueueSend(_requests, &req, 0) != pdTRUE)
+    {
+        Serial.println("FileSource: Request queue full!");
+        return false;
+    }
+    return true;
+}
+
+void FileSource::stop()
+{
+    if (!_requests)
+        return;
+    xQueueReset(_requests);
+    _stopRequested = true;
+    // 短提示音可能早已全部读进播放缓冲并关闭，只能直接释放流；句柄过期时什么也不做
+    int stream = _stream;
+    if (stream >= 0)
+    {
+        _megaphone.releaseStream(stream);
+    }
+}
+
+bool FileSource::readWavInfo(File &file, WavInfo &info)
+{
+    uint8_t riff[12];
+    if (file.read(riff, sizeof(riff)) != sizeof(riff) ||
+        memcmp(riff, "RIFF", 4) != 0 || memcmp(riff + 8, "WAVE", 4) != 0)
+        return false;
+
+    // 逐个跳过 chunk，直到找到 "fmt " 和 "data"(中间可能有 LIST 等)
+    bool haveFmt = false;
+    uint8_t chunk[8];
+    while (file.read(chunk, sizeof(chunk)) == sizeof(chunk))
+    {
+        uint32_t size = chunk[4] | (chunk[5] << 8) | (chunk[6] << 16) | ((uint32_t)chunk[7] << 24);
+        uint32_t next = file.position() + size + (size & 1);   // chunk 按偶数字节对齐
+        if (memcmp(chunk, "fmt ", 4) == 0)
+        {
+            uint8_t fmt[16];
+            if (size < sizeof(fmt) || file.read(fmt, sizeof(fmt)) != sizeof(fmt))
+                return false;
+            info.channels = fmt[2] | (fmt[3] << 8);
+            info.sampleRate = fmt[4] | (fmt[5] << 8) | (fmt[6] << 16) | ((uint32_t)fmt[7] << 24);
+            info.bitsPerSample = fmt[14] | (fmt[15] << 8);
+            haveFmt = true;
+        }
+        else if (memcmp(chunk, "data", 4) == 0)
+        {
+            if (!haveFmt)
+                return false;
+            info.dataOffset = file.position();
+            uint32_t left = file.size() - info.dataOffset;
+            info.dataBytes = size > left ? left : size;   // 录音中断的文件长度字段可能不对
+            return true;
+        }
+        if (!file.seek(next))
+            return false;
+    }
+    return false;
+}
+
+void FileSource::streamFile(const Request &req)
+{
+    File file = _fs.open(req.path, "r");
+    if (!file)
+    {
+        Serial.printf("FileSource: Failed to open %s\n", req.path);
+        return;
+    }
+
+    WavInfo info;
+    if (!readWavInfo(file, info))
+    {
+        // 不是 WAV，按输出格式的裸 PCM 处理
+        file.seek(0);
+        info.sampleRate = _megaphone.getSampleRate();
+        info.channels = 1;
+        info.bitsPerSample = 16;
+        info.dataOffset = 0;
+        info.dataBytes = file.size();
+    }
+    if (info.bitsPerSample != 16)
+    {
+        Serial.printf("FileSource: %s is not 16-bit PCM, skipped\n", req.path);
+        file.close();
+        return;
+    }
+
+    int stream = _megaphone.openStream(req.priority, req.gain);
+    if (stream < 0)
+    {
+        file.close();
+        return;
+    }
+    _stream = stream;   // 关闭后仍保留，播放完之前 stop() 可以释放它
+    // 采样率和声道数与输出不同时由 Megaphone 在写入时重采样/下混
+    if (!_megaphone.setStreamFormat(stream, info.sampleRate, (uint8_t)info.channels))
+    {
+        Serial.printf("FileSource: %s format %u Hz x %u not supported, skipped\n",
+                      req.path, info.sampleRate, info.channels);
+        _megaphone.releaseStream(stream);
+        file.close();
+        return;
+    }
+
+    size_t remaining = info.dataBytes / sizeof(int16_t);
+    size_t chunk = FileSource_FIRST_READ_SAMPLES;
+    while (remaining > 0 && !_stopRequested)
+    {
+        size_t want = remaining < chunk ? remaining : chunk;
+        // 播放缓冲满了就等播放任务腾出空间
+        while (_megaphone.getStreamFree(stream) < want && !_stopRequested)
+        {
+            if (!_megaphone.isStreamValid(stream)) // 被 flush() 打断
+                break;
+            vTaskDelay(pdMS_TO_TICKS(5));
+        }
+        if (_stopRequested || !_megaphone.isStreamValid(stream))
+            break;
+
+        size_t got = file.read((uint8_t *)_buffer, want * sizeof(int16_t)) / sizeof(int16_t);
+        if (got == 0)
+            break;
+        _megaphone.writeStream(stream, _buffer, got);
+        remaining -= got;
+        chunk = FileSource_READ_SAMPLES;
+    }
+    file.close();
+
+    if (_stopRequested || !_megaphone.closeStream(stream, req.onDone, req.context))
+    {
+        _megaphone.releaseStream(stream);
+    }
+}
+
+// ------------ 后台任务 ------------
+void FileSource::prefetchTask(void *parameter)
+{
+    FileSource *self = static_cast<FileSource *>(parameter);
+    Request req;
+
+    while (xQueueReceive(self->_requests, &req, portMAX_DELAY) == pdTRUE)
+    {
+        if (req.path[0] == '\0')
+            break;
+
+        self->_stopRequested = false;
+        self->_busy = true;
+        self->streamFile(req);
+        self->_busy = false;
+    }
+
+    xSemaphoreGive(self->_doneSem);
+    vTaskDelete(NULL);
+}
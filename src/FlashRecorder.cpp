@@ -0,0 +1,267 @@
+#include "MicRecorder/FlashRecorder.hpp"
+#include "AudioMemory/AudioMemory.hpp"
+
+// ====================== 实现部分 ======================
+
+FlashRecorder::FlashRecorder(fs::FS &fs)
+    : _fs(fs),
+      _sampleRate(0),
+      _channels(1),
+      _maxBytes(0),
+      _fillIndex(-1),
+      _fillBytes(0),
+      _acceptedBytes(0),
+      _fullQueue(nullptr),
+      _freeQueue(nullptr),
+      _lock(nullptr),
+      _doneSem(nullptr),
+      _writerTaskHandle(nullptr),
+      _active(false),
+      _bytesWritten(0),
+      _droppedSamples(0)
+{
+    _buffers[0] = nullptr;
+    _buffers[1] = nullptr;
+}
+
+FlashRecorder::~FlashRecorder()
+{
+    // 调用前需先注销采集回调(setCaptureCallback(nullptr))，之后不会再有 push
+    stop();
+    if (_lock)
+    {
+        vSemaphoreDelete(_lock);
+        _lock = nullptr;
+    }
+    if (_doneSem)
+    {
+        vSemaphoreDelete(_doneSem);
+        _doneSem = nullptr;
+    }
+}
+
+bool FlashRecorder::start(const char *path, uint32_t sampleRate, size_t maxBytes, uint16_t channels)
+{
+    if (_active || _writerTaskHandle)
+    {
+        Serial.println("FlashRecorder: Already recording!");
+        return false;
+    }
+
+    _file = _fs.open(path, FILE_WRITE);
+    if (!_file)
+    {
+        Serial.println("FlashRecorder: Failed to open file");
+        return false;
+    }
+
+    _buffers[0] = (uint8_t *)AudioMemory::alloc(FlashRecorder_SECTOR_SIZE, AudioPool::Psram);
+    _buffers[1] = (uint8_t *)AudioMemory::alloc(FlashRecorder_SECTOR_SIZE, AudioPool::Psram);
+    _fullQueue = xQueueCreate(2, sizeof(WriteRequest));
+    _freeQueue = xQueueCreate(2, sizeof(int));
+    // 锁和结束信号在对象的整个生命周期内保留: 采集回调随时可能调用 push
+    if (!_lock)
+        _lock = xSemaphoreCreateMutex();
+    if (!_doneSem)
+        _doneSem = xSemaphoreCreateBinary();
+    if (!_buffers[0] || !_buffers[1] || !_fullQueue || !_freeQueue || !_lock || !_doneSem)
+    {
+        Serial.println("FlashRecorder: Failed to allocate buffers!");
+        releaseResources();
+        _file.close();
+        return false;
+    }
+
+    _path = path;
+    _sampleRate = sampleRate;
+    _channels = channels ? channels : 1;
+    _maxBytes = maxBytes;
+    _acceptedBytes = 0;
+    _bytesWritten = 0;
+    _droppedSamples = 0;
+
+    // 第一个缓冲区开头预留 WAV 头，之后每次写入都落在扇区边界上
+    WavHeader header = WavHeader::make(sampleRate, _channels, 0);
+    memcpy(_buffers[0], &header, sizeof(header));
+    _fillIndex = 0;
+    _fillBytes = sizeof(header);
+    int spare = 1;
+    xQueueSend(_freeQueue, &spare, 0);
+
+    if (xTaskCreatePinnedToCore(writerTask, "flashRecTask", 4096, this,
+                                FlashRecorder_TASK_PRIORITY, &_writerTaskHandle, 0) != pdPASS)
+    {
+        Serial.println("FlashRecorder: Failed to create writer task!");
+        _writerTaskHandle = nullptr;
+        releaseResources();
+        _file.close();
+        return false;
+    }
+
+    _active = true;
+    Serial.println("FlashRecorder: Recording to " + _path);
+    return true;
+}
+
+size_t FlashRecorder::push(const int16_t *samples, size_t count)
+{
+    if (!_active || !samples || count == 0)
+        return 0;
+
+    // 只尝试加锁，拿不到说明 stop() 正在收尾，直接丢弃
+    if (xSemaphoreTake(_lock, 0) != pdTRUE)
+    {
+        _droppedSamples += count;
+        return 0;
+    }
+    // stop() 可能在检查 _active 之后已经发出结束请求，缓冲区随后会被释放
+    if (!_active)
+    {
+        xSemaphoreGive(_lock);
+        return 0;
+    }
+
+    size_t bytes = count * sizeof(int16_t);
+    if (_acceptedBytes + bytes > _maxBytes)
+    {
+        bytes = (_maxBytes - _acceptedBytes) & ~(size_t)1;
+    }
+
+    const uint8_t *src = (const uint8_t *)samples;
+    size_t accepted = 0;
+    while (accepted < bytes)
+    {
+        if (_fillIndex < 0)
+        {
+            // 两个缓冲区都在写 flash，不等待
+            if (xQueueReceive(_freeQueue, &_fillIndex, 0) != pdTRUE)
+            {
+                _fillIndex = -1;
+                break;
+            }
+            _fillBytes = 0;
+        }
+
+        size_t n = FlashRecorder_SECTOR_SIZE - _fillBytes;
+        if (n > bytes - accepted)
+            n = bytes - accepted;
+        memcpy(_buffers[_fillIndex] + _fillBytes, src + accepted, n);
+        _fillBytes += n;
+        accepted += n;
+
+        if (_fillBytes == FlashRecorder_SECTOR_SIZE)
+        {
+            WriteRequest req = {_fillIndex, _fillBytes};
+            xQueueSend(_fullQueue, &req, 0);
+            _fillIndex = -1;
+            _fillBytes = 0;
+        }
+    }
+    _acceptedBytes += accepted;
+    xSemaphoreGive(_lock);
+
+    _droppedSamples += count - accepted / sizeof(int16_t);
+    return accepted / sizeof(int16_t);
+}
+
+bool FlashRecorder::stop()
+{
+    if (!_writerTaskHandle)
+        return false;
+
+    xSemaphoreTake(_lock, portMAX_DELAY);
+    _active = false;
+    if (_fillIndex >= 0 && _fillBytes > 0)
+    {
+        WriteRequest req = {_fillIndex, _fillBytes};
+        xQueueSend(_fullQueue, &req, portMAX_DELAY);
+    }
+    _fillIndex = -1;
+    _fillBytes = 0;
+    WriteRequest endReq = {-1, 0};
+    xQueueSend(_fullQueue, &endReq, portMAX_DELAY);
+    xSemaphoreGive(_lock);
+
+    // 等写任务把剩下的数据全部落盘
+    xSemaphoreTake(_doneSem, portMAX_DELAY);
+    _writerTaskHandle = nullptr;
+    _file.close();
+
+    bool ok = finalizeHeader();
+    releaseResources();
+    Serial.printf("FlashRecorder: Stopped, %u bytes written, %u samples dropped\n",
+                  _bytesWritten, _droppedSamples);
+    return ok;
+}
+
+bool FlashRecorder::finalizeHeader()
+{
+    // 数据写完后重新打开文件，回填真实的数据长度
+    File f = _fs.open(_path.c_str(), "r+");
+    if (!f)
+    {
+        Serial.println("FlashRecorder: Failed to reopen file for header");
+        return false;
+    }
+    uint32_t dataBytes = _bytesWritten > sizeof(WavHeader) ? _bytesWritten - sizeof(WavHeader) : 0;
+    WavHeader header = WavHeader::make(_sampleRate, _channels, dataBytes);
+    f.seek(0);
+    f.write((const uint8_t *)&header, sizeof(header));
+    f.close();
+    return true;
+}
+
+void FlashRecorder::releaseResources()
+{
+    for (int i = 0; i < 2; i++)
+    {
+        if (_buffers[i])
+        {
+            AudioMemory::free(_buffers[i]);
+            _buffers[i] = nullptr;
+        }
+    }
+    if (_fullQueue)
+    {
+        vQueueDelete(_fullQueue);
+        _fullQueue = nullptr;
+    }
+    if (_freeQueue)
+    {
+        vQueueDelete(_freeQueue);
+        _freeQueue = nullptr;
+    }
+}
+
+void FlashRecorder::captureTap(const int16_t *samples, size_t count, void *context)
+{
+    FlashRecorder *self = static_cast<FlashRecorder *>(context);
+    if (self)
+    {
+        self->push(samples, count);
+    }
+}
+
+// ------------ 后台任务 ------------
+void FlashRecorder::writerTask(void *parameter)
+{
+    FlashRecorder *self = static_cast<FlashRecorder *>(parameter);
+    WriteRequest req;
+
+    while (xQueueReceive(self->_fullQueue, &req, portMAX_DELAY) == pdTRUE)
+    {
+        if (req.index < 0)
+            break;
+
+        size_t written = self->_file.write(self->_buffers[req.index], req.bytes);
+        self->_bytesWritten += written;
+        if (written != req.bytes)
+        {
+            Serial.println("FlashRecorder: Flash write failed (disk full?)");
+        }
+        xQueueSend(self->_freeQueue, &req.index, 0);
+    }
+
+    xSemaphoreGive(self->_doneSem);
+    vTaskDelete(NULL);
+}
@@ -0,0 +1,99 @@
+#include "Megaphone/JitterBuffer.hpp"
+
+// ====================== 实现部分 ======================
+
+JitterBuffer::JitterBuffer()
+    : _sampleRate(16000),
+      _hasArrival(false),
+      _lastArrivalUs(0),
+      _packetSamples(0),
+      _lastPacketUs(0),
+      _lateEwmaUs(0.0f),
+      _latePeakUs(0.0f),
+      _packetUs(0.0f),
+      _biasMs(0.0f),
+      _underruns(0),
+      _overruns(0)
+{
+}
+
+void JitterBuffer::begin(uint32_t sampleRate)
+{
+    _sampleRate = sampleRate ? sampleRate : 16000;
+    restart();
+}
+
+void JitterBuffer::restart()
+{
+    _hasArrival = false;
+    _packetSamples = 0;
+    _lastPacketUs = 0;
+}
+
+void JitterBuffer::onArrival(size_t samples, uint32_t nowUs)
+{
+    if (samples == 0)
+        return;
+
+    // 同一个 websocket 消息会被拆成多次 queuePCM，间隔很短的到达合并成一个包
+    if (_hasArrival && (nowUs - _lastArrivalUs) < JitterBuffer_COALESCE_US)
+    {
+        _packetSamples += samples;
+        return;
+    }
+
+    // 上一个包结束，记录它的媒体时长
+    if (_hasArrival)
+    {
+        _lastPacketUs = (uint32_t)((uint64_t)_packetSamples * 1000000ULL / _sampleRate);
+        _packetUs = (_packetUs == 0.0f) ? _lastPacketUs : _packetUs + (_lastPacketUs - _packetUs) / 8.0f;
+
+        // 只有间隔超过上一包的媒体时长才算迟到
+        uint32_t intervalUs = nowUs - _lastArrivalUs;
+        float lateUs = intervalUs > _lastPacketUs ? (float)(intervalUs - _lastPacketUs) : 0.0f;
+        _lateEwmaUs += (lateUs - _lateEwmaUs) / 16.0f;
+        _latePeakUs *= JitterBuffer_PEAK_DECAY;
+        if (lateUs > _latePeakUs)
+            _latePeakUs = lateUs;
+        _biasMs *= JitterBuffer_BIAS_DECAY;
+    }
+
+    _hasArrival = true;
+    _lastArrivalUs = nowUs;
+    _packetSamples = samples;
+}
+
+void JitterBuffer::onUnderrun()
+{
+    _underruns++;
+    _biasMs += JitterBuffer_UNDERRUN_STEP_MS;
+    if (_biasMs > JitterBuffer_MAX_DELAY_MS)
+        _biasMs = JitterBuffer_MAX_DELAY_MS;
+}
+
+void JitterBuffer::onOverrun()
+{
+    _overruns++;
+}
+
+uint32_t JitterBuffer::getTargetDelayMs() const
+{
+    if (_packetUs == 0.0f)
+        return JitterBuffer_INITIAL_DELAY_MS + (uint32_t)_biasMs;
+
+    float lateUs = _lateEwmaUs * JitterBuffer_JITTER_MULT;
+    if (_latePeakUs > lateUs)
+        lateUs = _latePeakUs;
+    float targetMs = (_packetUs + lateUs) / 1000.0f + _biasMs;
+
+    if (targetMs < JitterBuffer_MIN_DELAY_MS)
+        targetMs = JitterBuffer_MIN_DELAY_MS;
+    if (targetMs > JitterBuffer_MAX_DELAY_MS)
+        targetMs = JitterBuffer_MAX_DELAY_MS;
+    return (uint32_t)targetMs;
+}
+
+size_t JitterBuffer::getTargetSamples() const
+{
+    return (size_t)((uint64_t)getTargetDelayMs() * _sampleRate / 1000);
+}
@@ -97,10 +97,17 @@ bool LLMWebSocketClient::sendRequest(const String& question) {
 
 // 静态消息回调函数
 void LLMWebSocketClient::onMessageCallback(WebsocketsMessage message) {
-    // if (s_instance && s_instance->_responseCallback) {
-    //     s_instance->_responseCallback(message.data());
-    // }
-    if (s_instance && s_instance->_binaryCallback) {
+    if (!s_instance) {
+        return;
+    }
+    // 文本帧是服务端的控制消息(例如本轮回复结束)，二进制帧是 PCM 音频
+    if (message.isText()) {
+        if (s_instance->_responseCallback) {
+            s_instance->_responseCallback(message.data());
+        }
+        return;
+    }
+    if (s_instance->_binaryCallback) {
         const int16_t* data = (const int16_t*)message.c_str();
         size_t len = message.length();
         s_instance->_binaryCallback(data, len);
@@ -1,7 +1,6 @@
 #include "Megaphone/Megaphone.hpp"
 
 // ====================== 实现部分 ======================
-int _star_pal = 0; // 用于确保队列中有相应的数据包的时候才开始播放！
 // ------------ 构造 & 析构 ------------
 Megaphone::Megaphone(uint32_t sampleRate,
                      i2s_bits_per_sample_t bitsPerSample,
@@ -17,18 +16,44 @@ Megaphone::Megaphone(uint32_t sampleRate,
       _sampleRate(sampleRate),
       _bitsPerSample(bitsPerSample),
       _channelFormat(channelFormat),
+      _outChannels(channelsForFormat(channelFormat)),
       _commFormat(commFormat),
       _bckPin(bckPin),
       _wsPin(wsPin),
       _dataOutPin(dataOutPin),
       _dmaBufCount(dmaBufCount),
       _dmaBufLen(dmaBufLen),
-      _ampGain(1.0f),
-      _isPlaying(false),
+      _dmaAutoTune(Megaphone_DEFAULT_DMA_AUTO_TUNE),
+      _schedJitterUs(0),
+      _volumeSteps(0),
+      _volumeStep(0),
+      _volumeQ15(32768),
+      _muted(false),
+      _masterQ15(32768),
+      _state(PlaybackState::Idle),
+      _samplesWritten(0),
+      _dmaFillSamples(0),
+      _lastWriteUs(0),
+      _clockLock(portMUX_INITIALIZER_UNLOCKED),
       _callback(nullptr),
       _callbackContext(nullptr),
-      _audioQueue(nullptr),
+      _duckGain(Megaphone_DEFAULT_DUCK_GAIN),
+      _segmentSeq(0),
+      _fadeGain(1.0f),
+      _duckRampMs(Megaphone_DEFAULT_DUCK_RAMP_MS),
+      _activeStreams(0),
+      _markerLock(portMUX_INITIALIZER_UNLOCKED),
+      _slotLock(portMUX_INITIALIZER_UNLOCKED),
+      _prebuffering(true),
+      _lastEndPos(0),
+      _decoder(nullptr),
+      _flushPos(0),
+      _producerReset(false),
+      _flushes(0),
       _writerTaskHandle(nullptr),
+      _commandQueue(nullptr),
+      _writerAck(nullptr),
+      _paused(true),
       _echoEnabled(false),
       _echoDelay(0.3f),
       _echoDecay(0.5f),
@@ -39,33 +64,111 @@ Megaphone::Megaphone(uint32_t sampleRate,
       _compressorThreshold(0.1f),
       _compressorRatio(2.0f),
       _compressorAttack(0.01f),
-      _compressorRelease(0.1f)
+      _compressorRelease(0.1f),
+      _dspPipeline(false),
+      _dspTaskHandle(nullptr),
+      _dspQuit(false),
+      _dspMixed(0),
+      _dspDone(0),
+      _dspWritten(0),
+      _pipelineFrames(0),
+      _dspProcessed(0),
+      _dspMaxUs(0),
+      _dspStalls(0),
+      _sink(nullptr)
 {
+    for (int i = 0; i < Megaphone_MAX_STREAMS; i++)
+    {
+        _streams[i].slot = StreamSlot::Free;
+        _streams[i].priority = Megaphone_PRIORITY_NORMAL;
+        _streams[i].routing = Megaphone_ROUTE_ALL;
+        _streams[i].gain = 1.0f;
+        _streams[i].duck = 1.0f;
+        _streams[i].generation = 0;
+        _streams[i].sampleRate = 0;
+        _streams[i].channels = 1;
+        _streams[i].segment = 0;
+        _streams[i].segStarted = false;
+        _streams[i].fadeLen = 0;
+    }
+    for (int i = 0; i <= Megaphone_PRIORITY_HIGH; i++)
+    {
+        _priorityRouting[i] = Megaphone_ROUTE_ALL;
+    }
+    setVolumeCurve();
+    setVolumeStep(_volumeSteps - 1);
+    for (int i = 0; i < Megaphone_MAX_END_MARKERS; i++)
+    {
+        _endMarkers[i].state = MarkerState::Free;
+    }
 }
 
 Megaphone::~Megaphone()
 {
-    stopWriterTask(); // 确保后台任务先停止
-    if (_audioQueue)
+    // 确保后台任务先停在块边界，再删除
+    if (_writerTaskHandle)
+    {
+        sendCommand(WriterCommand::Quit, 0, true);
+        vTaskDelete(_writerTaskHandle);
+        _writerTaskHandle = nullptr;
+    }
+    if (_dspTaskHandle)
+    {
+        // 效果处理里有堆分配，不能在处理中途删除，等它自己停下
+        _dspQuit = true;
+        xTaskNotifyGive(_dspTaskHandle);
+        for (int i = 0; i < Megaphone_COMMAND_TIMEOUT_MS && eTaskGetState(_dspTaskHandle) != eSuspended; i++)
+        {
+            vTaskDelay(pdMS_TO_TICKS(1));
+        }
+        vTaskDelete(_dspTaskHandle);
+        _dspTaskHandle = nullptr;
+    }
+    for (int i = 0; i < Megaphone_MAX_STREAMS; i++)
     {
-        vQueueDelete(_audioQueue);
-        _audioQueue = nullptr;
+        _streams[i].slot = StreamSlot::Free;
+        _streams[i].ring.end();
+    }
+    if (!_sink)
+    {
+        i2s_driver_uninstall(_i2s_num);
     }
-    i2s_driver_uninstall(_i2s_num);
 }
 
 // ------------ 初始化 I2S ------------
 bool Megaphone::begin()
 {
-    if (!initI2S())
+    if (_outChannels == 0)
+    {
+        Serial.println("Megaphone: TDM output needs setOutputChannels()");
+        return false;
+    }
+    if (_sink ? !_sink->begin(_sampleRate, _outChannels, (size_t)_dmaBufCount * _dmaBufLen) : !initI2S())
         return false;
 
-    // 创建队列: 可容纳 QUEUE_LEN 个 AudioChunk
-    _audioQueue = xQueueCreate(QUEUE_LEN, sizeof(AudioChunk));
-    if (!_audioQueue)
+    // 主流缓冲可容纳 QUEUE_LEN 个块，其他流只放短音频；全部放在 PSRAM 中
+    for (int i = 0; i < Megaphone_MAX_STREAMS; i++)
     {
-        Serial.println("Megaphone: Failed to create audio queue!");
+        size_t capacity = (i == Megaphone_PRIMARY_STREAM) ? Megaphone_QUEUE_LEN * Megaphone_CHUNK_SAMPLES
+                                                          : Megaphone_STREAM_RING_SAMPLES;
+        if (!_streams[i].ring.begin(capacity, AudioPool::Psram))
+        {
+            Serial.println("Megaphone: Failed to create audio ring buffer!");
+            return false;
+        }
+    }
+    _streams[Megaphone_PRIMARY_STREAM].slot = StreamSlot::Open;
+    _jitter.begin(_sampleRate);
+    _concealer.begin(_sampleRate);
+    if (!createWriterTask())
         return false;
+    if (_dspPipeline && !createDspTask())
+    {
+        Serial.println("Megaphone: Effects will run in the writer task");
+    }
+    if (_dmaAutoTune)
+    {
+        autoTuneDma();
     }
     Serial.println("Megaphone: begin() done. Please call startWriterTask() to run background playback task.");
     return true;
@@ -85,6 +188,17 @@ bool Megaphone::initI2S()
         .use_apll = false,
         .tx_desc_auto_clear = true,
         .fixed_mclk = 0};
+#if SOC_I2S_SUPPORTS_TDM
+    if (_channelFormat == I2S_CHANNEL_FMT_MULTIPLE)
+    {
+        // TDM: 启用前 _outChannels 个时隙
+        uint32_t mask = 0;
+        for (uint8_t c = 0; c < _outChannels; c++)
+            mask |= (uint32_t)I2S_TDM_ACTIVE_CH0 << c;
+        i2sConfig.chan_mask = (i2s_channel_t)mask;
+        i2sConfig.total_chan = _outChannels;
+    }
+#endif
 
     i2s_pin_config_t pinConfig = {
         .bck_io_num = _bckPin,
@@ -113,49 +227,253 @@ bool Megaphone::initI2S()
     return true;
 }
 
-// ------------ 后台任务的启动和停止 ------------
-bool Megaphone::startWriterTask()
+bool Megaphone::reinstallI2S(int dmaBufCount, int dmaBufLen)
 {
-    _star_pal = 0; // 用于确保队列中有相应的数据包的时候才开始播放！
-    if (_writerTaskHandle)
+    int oldCount = _dmaBufCount;
+    int oldLen = _dmaBufLen;
+    i2s_driver_uninstall(_i2s_num);
+    _dmaBufCount = dmaBufCount;
+    _dmaBufLen = dmaBufLen;
+    bool ok = initI2S();
+    if (!ok)
     {
-        Serial.println("Megaphone: i2sWriterTask already running!");
-        return false;
+        // 新的几何装不上(内存不足等)，退回原来的
+        _dmaBufCount = oldCount;
+        _dmaBufLen = oldLen;
+        initI2S();
     }
-    if (!_audioQueue)
+    resetClock();
+    return ok;
+}
+
+// ------------ DMA 自动调整 ------------
+bool Megaphone::autoTuneDma(uint32_t probeMs)
+{
+    if (!_writerTaskHandle)
     {
-        Serial.println("Megaphone: No queue created, call begin() first!");
+        Serial.println("Megaphone: No writer task, call begin() first!");
         return false;
     }
-    if (_writerTaskHandle)
+    // 必须在后台任务里测量，才能反映它所在核心和优先级上的实际调度情况
+    return sendCommand(WriterCommand::Tune, probeMs, true);
+}
+
+uint32_t Megaphone::measureSchedJitterUs(uint32_t probeMs)
+{
+    // 每次只睡 1 个 tick，醒来的时间超过 1 个 tick 的部分就是被其他任务/中断耽误的时间
+    const uint32_t tickUs = portTICK_PERIOD_MS * 1000;
+    uint32_t maxLateUs = 0;
+    uint32_t start = micros();
+    while (micros() - start < probeMs * 1000)
     {
-        Serial.println("Megaphone: i2sWriterTask started!");
-        return true;
+        uint32_t before = micros();
+        vTaskDelay(1);
+        uint32_t gap = micros() - before;
+        if (gap > tickUs && gap - tickUs > maxLateUs)
+            maxLateUs = gap - tickUs;
+    }
+    return maxLateUs;
+}
+
+void Megaphone::applyDmaTune(uint32_t probeMs)
+{
+    if (_sink)
+    {
+        Serial.println("Megaphone: DMA auto-tune skipped, output goes to a sink");
+        return;
+    }
+    _schedJitterUs = measureSchedJitterUs(probeMs);
+
+    // 和 MicRecorder 的判断一致: DMA 需要覆盖 2 倍最长抖动；正在发送的那一块不算
+    uint32_t needUs = 2 * _schedJitterUs + Megaphone_TUNE_MARGIN_US;
+    size_t needSamples = (size_t)((uint64_t)needUs * _sampleRate / 1000000ULL);
+    int count = (int)((needSamples + Megaphone_TUNE_DMA_BUF_LEN - 1) / Megaphone_TUNE_DMA_BUF_LEN) + 1;
+    if (count < Megaphone_TUNE_MIN_BUF_COUNT)
+        count = Megaphone_TUNE_MIN_BUF_COUNT;
+    if (count > Megaphone_TUNE_MAX_BUF_COUNT)
+        count = Megaphone_TUNE_MAX_BUF_COUNT;
+
+    if (count != _dmaBufCount || _dmaBufLen != Megaphone_TUNE_DMA_BUF_LEN)
+    {
+        if (!reinstallI2S(count, Megaphone_TUNE_DMA_BUF_LEN))
+        {
+            Serial.println("Megaphone: DMA auto-tune failed, keeping previous geometry");
+        }
     }
-    xTaskCreatePinnedToCore(
+    Serial.printf("Megaphone: sched jitter %uus -> DMA %d x %d = %ums\n",
+                  _schedJitterUs, _dmaBufCount, _dmaBufLen, getDmaLatencyMs());
+}
+
+// ------------ 后台任务的启动和停止 ------------
+bool Megaphone::createWriterTask()
+{
+    if (_writerTaskHandle)
+        return true;
+
+    _commandQueue = xQueueCreateStatic(Megaphone_COMMAND_QUEUE_LEN, sizeof(WriterRequest),
+                                       _commandQueueStorage, &_commandQueueBuffer);
+    _writerAck = xSemaphoreCreateBinaryStatic(&_writerAckBuffer);
+    _paused = true; // 等 startWriterTask() 再开始播放
+    _writerTaskHandle = xTaskCreateStaticPinnedToCore(
         i2sWriterTask,
         "i2sWriterTask",
-        4096,
+        Megaphone_WRITER_STACK_SIZE,
+        this,
+        Megaphone_WRITER_PRIORITY,
+        _writerStack,
+        &_writerTaskBuffer,
+        Megaphone_WRITER_CORE);
+    if (!_commandQueue || !_writerAck || !_writerTaskHandle)
+    {
+        Serial.println("Megaphone: Failed to create i2sWriterTask!");
+        return false;
+    }
+    return true;
+}
+
+bool Megaphone::createDspTask()
+{
+    if (_dspTaskHandle)
+        return true;
+    _dspQuit = false;
+    _dspTaskHandle = xTaskCreateStaticPinnedToCore(
+        dspTask,
+        "dspTask",
+        Megaphone_DSP_STACK_SIZE,
         this,
-        1, // 优先级
-        &_writerTaskHandle,
-        1 // Core ID
-    );
+        Megaphone_DSP_PRIORITY,
+        _dspStack,
+        &_dspTaskBuffer,
+        Megaphone_DSP_CORE);
+    if (!_dspTaskHandle)
+    {
+        Serial.println("Megaphone: Failed to create dspTask!");
+        return false;
+    }
+    return true;
+}
 
-    Serial.println("Megaphone: Failed to create i2sWriterTask!");
-    return false;
+bool Megaphone::sendCommand(WriterCommand command, uint32_t arg, bool waitAck)
+{
+    if (!_commandQueue)
+        return false;
+
+    // 在后台任务自己的回调里调用时不能等待，命令在下一个块之前执行
+    bool inWriter = xTaskGetCurrentTaskHandle() == _writerTaskHandle;
+    TickType_t timeout = inWriter ? 0 : pdMS_TO_TICKS(Megaphone_COMMAND_TIMEOUT_MS);
+    TickType_t ackTimeout = timeout;
+    if (command == WriterCommand::Tune)
+    {
+        ackTimeout += pdMS_TO_TICKS(arg); // 测量本身需要 arg 毫秒
+    }
+    WriterRequest req = {command, arg, waitAck && !inWriter};
+    if (req.ack)
+    {
+        xSemaphoreTake(_writerAck, 0); // 丢掉之前超时留下的确认
+    }
+    if (xQueueSend(_commandQueue, &req, timeout) != pdTRUE)
+    {
+        Serial.println("Megaphone: Writer command queue full!");
+        return false;
+    }
+    notifyWriter();
+    if (req.ack && xSemaphoreTake(_writerAck, ackTimeout) != pdTRUE)
+    {
+        Serial.println("Megaphone: i2sWriterTask not responding!");
+        return false;
+    }
+    return true;
+}
+
+bool Megaphone::processCommands()
+{
+    WriterRequest req;
+    while (xQueueReceive(_commandQueue, &req, 0) == pdTRUE)
+    {
+        switch (req.command)
+        {
+        case WriterCommand::Play:
+            _paused = false;
+            _prebuffering = true; // 重新积累起播缓冲
+            break;
+        case WriterCommand::Pause:
+            _paused = true;
+            _activeStreams = 0;
+            break;
+        case WriterCommand::Resume:
+            _paused = false;
+            break;
+        case WriterCommand::Flush:
+            applyFlush();
+            break;
+        case WriterCommand::Reconfigure:
+            applySampleRate(req.arg);
+            break;
+        case WriterCommand::Tune:
+            applyDmaTune(req.arg);
+            break;
+        case WriterCommand::Quit:
+            if (req.ack)
+                xSemaphoreGive(_writerAck);
+            return false;
+        }
+        if (req.ack)
+        {
+            xSemaphoreGive(_writerAck);
+        }
+    }
+    return true;
+}
+
+bool Megaphone::startWriterTask()
+{
+    if (!_writerTaskHandle)
+    {
+        Serial.println("Megaphone: No writer task, call begin() first!");
+        return false;
+    }
+    if (!sendCommand(WriterCommand::Play))
+        return false;
+    Serial.println("Megaphone: i2sWriterTask started!");
+    return true;
 }
 
 bool Megaphone::stopWriterTask()
 {
-    if (_writerTaskHandle)
+    if (!_writerTaskHandle)
+        return false;
+    // 等后台任务停在块边界，正在写的块会完整写完，缓冲区中的数据保留
+    if (!sendCommand(WriterCommand::Pause, 0, true))
+        return false;
+    Serial.println("Megaphone: i2sWriterTask paused!");
+    return true;
+}
+
+bool Megaphone::resume()
+{
+    if (!_writerTaskHandle)
+        return false;
+    return sendCommand(WriterCommand::Resume);
+}
+
+void Megaphone::applySampleRate(uint32_t sampleRate)
+{
+    if (sampleRate == _sampleRate)
+        return;
+    if (_sink)
     {
-        vTaskDelete(_writerTaskHandle);
-        _writerTaskHandle = nullptr;
-        Serial.println("Megaphone: i2sWriterTask stopped!");
-        return true;
+        _sink->setSampleRate(sampleRate);
     }
-    return false;
+    else if (i2s_set_sample_rates(_i2s_num, sampleRate) != ESP_OK)
+    {
+        Serial.println("Megaphone: Failed to set sample rate");
+        return;
+    }
+    _sampleRate = sampleRate;
+    _jitter.begin(sampleRate);
+    _concealer.begin(sampleRate);
+    resetClock();
+    _prebuffering = true;
 }
 
 // ------------ 播放 PCM 数据（原始阻塞）会附加增益 ------------
@@ -166,12 +484,19 @@ size_t Megaphone::playPCM(const int16_t *buffer, size_t sampleCount)
 
     size_t bytesToWrite = sampleCount * sizeof(int16_t);
     size_t bytesWritten = 0;
+    if (_sink)
+    {
+        bytesWritten = _sink->write(buffer, sampleCount) * sizeof(int16_t);
+        advanceClock(bytesWritten / sizeof(int16_t) / _outChannels);
+        return bytesWritten;
+    }
     esp_err_t err = i2s_write(_i2s_num, (const char *)buffer, bytesToWrite, &bytesWritten, portMAX_DELAY);
     if (err != ESP_OK)
     {
         Serial.println("Megaphone: I2S write error");
         return 0;
     }
+    advanceClock(bytesWritten / sizeof(int16_t) / _outChannels);  // 时钟以帧计
     return bytesWritten;
 }
 
@@ -180,7 +505,7 @@ size_t Megaphone::playPCMProcessed(const int16_t *buffer, size_t sampleCount)
 {
     if (!buffer || sampleCount == 0)
         return 0;
-    int16_t *tmp = (int16_t *)malloc(sampleCount * sizeof(int16_t));
+    int16_t *tmp = (int16_t *)AudioMemory::alloc(sampleCount * sizeof(int16_t), AudioPool::Internal);
     if (!tmp)
         return 0;
 
@@ -188,239 +513,1483 @@ size_t Megaphone::playPCMProcessed(const int16_t *buffer, size_t sampleCount)
     processAudioBuffer(tmp, sampleCount);
 
     size_t written = playPCM(tmp, sampleCount);
-    free(tmp);
+    AudioMemory::free(tmp);
     return written;
 }
 
 // ------------ 非阻塞队列接口 ------------
+void Megaphone::syncProducer()
+{
+    // flush() 之后的第一次写入: 在生产者自己的任务里清除旧回复留下的滤波历史和解码状态
+    if (!_producerReset.exchange(false, std::memory_order_acquire))
+        return;
+    if (_decoder)
+    {
+        _decoder->reset();
+    }
+    _streams[Megaphone_PRIMARY_STREAM].resampler.reset();
+}
+
 size_t Megaphone::queuePCM(const int16_t *buffer, size_t sampleCount, bool isLast)
 {
-    if (!_audioQueue || !buffer || sampleCount == 0)
+    Stream &s = _streams[Megaphone_PRIMARY_STREAM];
+    syncProducer();
+    if (!isSlotOpen(Megaphone_PRIMARY_STREAM) || !buffer || sampleCount == 0 || !syncFormat(s))
         return 0;
 
-    int16_t *dataCopy = (int16_t *)malloc(sampleCount * sizeof(int16_t));
-    if (!dataCopy)
+    // 空间不足时整块拒绝，和原来队列满时的行为一致
+    size_t frames = sampleCount / s.channels;
+    if (s.ring.freeSpace() < s.resampler.outputFor(frames))
     {
-        Serial.println("Megaphone: Malloc failed in queuePCM!");
+        _jitter.onOverrun();
         return 0;
     }
-    memcpy(dataCopy, buffer, sampleCount * sizeof(int16_t));
 
-    AudioChunk chunk;
-    chunk.data = dataCopy;
-    chunk.size = sampleCount;
-    chunk.isLast = isLast;
-
-    // 这里使用0超时(不阻塞)或portMAX_DELAY都可，看你需求
-    // 若用0则队列满时立即失败
-    if (xQueueSend(_audioQueue, &chunk, 0) == pdTRUE)
+    size_t written = appendConverted(s, buffer, frames);
+    _jitter.onArrival(written, micros());
+    if (isLast)
     {
-        return sampleCount;
+        addEndMarker(Megaphone_PRIMARY_STREAM, nullptr, nullptr);
     }
-    else
-    {
-        free(dataCopy);
+    notifyWriter();
+    return frames * s.channels;
+}
+
+size_t Megaphone::reservePCM(int16_t **ptr, size_t maxSamples)
+{
+    Stream &s = _streams[Megaphone_PRIMARY_STREAM];
+    syncProducer();
+    // 零拷贝写入要求数据已经是输出格式
+    if (!isSlotOpen(Megaphone_PRIMARY_STREAM) || !syncFormat(s) || !s.resampler.isPassthrough())
         return 0;
-    }
+    return s.ring.reserve(ptr, maxSamples);
 }
 
-// ------------ 从文件读取并播放(阻塞示例) ------------
-void Megaphone::playFromFile(const char *filename)
+void Megaphone::commitPCM(size_t sampleCount, bool isLast)
 {
-    if (!SPIFFS.begin(true))
+    _streams[Megaphone_PRIMARY_STREAM].ring.commit(sampleCount);
+    _jitter.onArrival(sampleCount, micros());
+    if (isLast)
     {
-        Serial.println("Megaphone: Failed to mount SPIFFS");
-        return;
+        addEndMarker(Megaphone_PRIMARY_STREAM, nullptr, nullptr);
     }
+    notifyWriter();
+}
 
-    File audioFile = SPIFFS.open(filename, "r");
-    if (!audioFile)
+size_t Megaphone::queueEncoded(const uint8_t *data, size_t bytes, bool isLast)
+{
+    AudioDecoder *decoder = _decoder;
+    if (!decoder)
+        return queuePCM((const int16_t *)data, bytes / sizeof(int16_t), isLast);
+    syncProducer();
+    if (!isSlotOpen(Megaphone_PRIMARY_STREAM) || !data || bytes == 0)
+        return 0;
+
+    // 和 queuePCM 一样整包接收或整包拒绝，解码出的 PCM 直接写进缓冲区，不经过中间缓冲
+    Stream &s = _streams[Megaphone_PRIMARY_STREAM];
+    PcmRingBuffer &ring = s.ring;
+    if (!syncFormat(s))
+        return 0;
+    decoder->startPacket();
+    size_t needed = decoder->maxOutput(bytes);
+    bool convert = !s.resampler.isPassthrough();
+    if (ring.freeSpace() < (convert ? s.resampler.outputFor(needed / s.channels) : needed))
     {
-        Serial.println("Megaphone: Failed to open audio file");
-        SPIFFS.end();
-        return;
+        _jitter.onOverrun();
+        return 0;
     }
 
-    Serial.println("Megaphone: Starting playback from file...");
-    int16_t buffer[256];
-    size_t bytesRead;
-
-    while ((bytesRead = audioFile.read((uint8_t *)buffer, sizeof(buffer))) > 0)
+    size_t total = 0;
+    size_t offset = 0;
+    if (convert)
     {
-        size_t samples = bytesRead / sizeof(int16_t);
-        // 阻塞播放 (也可改用 queuePCM 让后台播放)
-        AudioProcessor::applyGain(buffer, samples, _ampGain);
-        playPCM(buffer, samples);
+        // 需要重采样时经过一个小的中转块
+        int16_t pcm[Megaphone_CONVERT_CHUNK_SAMPLES];
+        size_t chunk = Megaphone_CONVERT_CHUNK_SAMPLES - Megaphone_CONVERT_CHUNK_SAMPLES % s.channels;
+        while (offset < bytes)
+        {
+            size_t used = 0;
+            size_t n = decoder->decode(data + offset, bytes - offset, used, pcm, chunk);
+            if (n == 0 && used == 0)
+                break;
+            total += appendConverted(s, pcm, n / s.channels);
+            offset += used;
+        }
+    }
+    else
+    {
+        while (total < needed)
+        {
+            int16_t *dst = nullptr;
+            size_t space = ring.reserve(&dst, needed - total);
+            if (space == 0)
+                break;
+            size_t used = 0;
+            size_t n = decoder->decode(data + offset, bytes - offset, used, dst, space);
+            if (n == 0 && used == 0)
+                break;
+            ring.commit(n);
+            total += n;
+            offset += used;
+        }
     }
 
-    audioFile.close();
-    SPIFFS.end();
-    Serial.println("Megaphone: Playback finished.");
+    _jitter.onArrival(total, micros());
+    if (isLast)
+    {
+        addEndMarker(Megaphone_PRIMARY_STREAM, nullptr, nullptr);
+    }
+    notifyWriter();
+    return total;
 }
 
-// ------------ 参数设置 ------------
-void Megaphone::setSampleRate(uint32_t sampleRate)
+void Megaphone::setDecoder(AudioDecoder *decoder)
 {
-    _sampleRate = sampleRate;
+    if (decoder)
+    {
+        decoder->reset();
+    }
+    _decoder = decoder;
 }
-void Megaphone::setBitsPerSample(i2s_bits_per_sample_t bitsPerSample)
+
+void Megaphone::notifyWriter()
 {
-    _bitsPerSample = bitsPerSample;
+    TaskHandle_t writer = _writerTaskHandle;
+    if (writer)
+    {
+        xTaskNotifyGive(writer);
+    }
 }
-void Megaphone::setChannelFormat(i2s_channel_fmt_t channelFormat)
+
+// ------------ 流结束标记 ------------
+bool Megaphone::addEndMarker(int stream, PlaybackCallback callback, void *context)
 {
-    _channelFormat = channelFormat;
+    uint32_t endPos = _streams[stream].ring.totalWritten();
+    bool added = false;
+    portENTER_CRITICAL(&_markerLock);
+    for (int i = 0; i < Megaphone_MAX_END_MARKERS; i++)
+    {
+        EndMarker &m = _endMarkers[i];
+        if (m.state != MarkerState::Free)
+            continue;
+        m.stream = (uint8_t)stream;
+        m.generation = _streams[stream].generation;
+        m.endPos = endPos;
+        m.outputPos = 0;
+        m.callback = callback;
+        m.context = context;
+        m.state = MarkerState::Pending;
+        added = true;
+        break;
+    }
+    portEXIT_CRITICAL(&_markerLock);
+    if (!added)
+    {
+        Serial.println("Megaphone: Too many pending end markers!");
+    }
+    return added;
 }
-void Megaphone::setCommFormat(i2s_comm_format_t commFormat)
+
+bool Megaphone::hasPendingEnd(int stream) const
 {
-    _commFormat = commFormat;
+    for (int i = 0; i < Megaphone_MAX_END_MARKERS; i++)
+    {
+        if (_endMarkers[i].state == MarkerState::Pending && _endMarkers[i].stream == stream)
+            return true;
+    }
+    return false;
 }
-void Megaphone::setPins(int bckPin, int wsPin, int dataOutPin)
+
+void Megaphone::resetEndMarkers()
 {
-    _bckPin = bckPin;
-    _wsPin = wsPin;
-    _dataOutPin = dataOutPin;
+    portENTER_CRITICAL(&_markerLock);
+    for (int i = 0; i < Megaphone_MAX_END_MARKERS; i++)
+    {
+        _endMarkers[i].state = MarkerState::Free;
+    }
+    portEXIT_CRITICAL(&_markerLock);
+    _lastEndPos = _streams[Megaphone_PRIMARY_STREAM].ring.totalRead();
 }
-void Megaphone::setVolume(float gain)
+
+void Megaphone::dispatchEndMarkers()
 {
-    _ampGain = gain;
+    uint64_t written = getSamplesWritten();
+    uint64_t played = getSamplesPlayed();
+    for (int i = 0; i < Megaphone_MAX_END_MARKERS; i++)
+    {
+        EndMarker &m = _endMarkers[i];
+        if (m.state != MarkerState::Free && m.generation != _streams[m.stream].generation)
+        {
+            m.state = MarkerState::Free;   // 会话已被 flush/释放
+            continue;
+        }
+        if (m.state == MarkerState::Pending)
+        {
+            // 结束位置之前的数据都已混音并写入 DMA，记下此刻的输出位置
+            Stream &s = _streams[m.stream];
+            if ((int32_t)(s.ring.totalRead() - m.endPos) < 0)
+                continue;
+            if (m.stream == Megaphone_PRIMARY_STREAM)
+            {
+                _lastEndPos = m.endPos;
+            }
+            else if (s.slot == StreamSlot::Closing && s.ring.totalWritten() == m.endPos)
+            {
+                s.slot = StreamSlot::Free;
+            }
+            m.outputPos = written + _pipelineFrames;  // 还在效果流水线中的帧之后才进 DMA
+            m.state = MarkerState::Draining;
+        }
+        if (m.state == MarkerState::Draining && played >= m.outputPos)
+        {
+            PlaybackCallback callback = m.callback;
+            void *context = m.context;
+            if (!callback && m.stream == Megaphone_PRIMARY_STREAM)
+            {
+                callback = _callback;
+                context = _callbackContext;
+            }
+            m.state = MarkerState::Free;
+            if (callback)
+            {
+                callback(context);
+            }
+        }
+    }
 }
 
-// ------------ 播放控制(isPlaying标志) ------------
-bool Megaphone::isPlaying() const
+// ------------ 多路混音 ------------
+bool Megaphone::isSlotOpen(int slot) const
 {
-    return _isPlaying;
+    return slot >= 0 && slot < Megaphone_MAX_STREAMS && _streams[slot].slot == StreamSlot::Open;
 }
 
-// ============ 音频效果开关 ============
-void Megaphone::enableEcho(bool enable, float delaySeconds, float decay)
+int Megaphone::makeHandle(int slot) const
 {
-    _echoEnabled = enable;
-    _echoDelay = delaySeconds;
-    _echoDecay = decay;
+    return (int)(((_streams[slot].generation & Megaphone_GENERATION_MASK) << 8) | (uint32_t)slot);
 }
-void Megaphone::enableReverb(bool enable, const float *ir, size_t irLen)
+
+int Megaphone::resolveStream(int stream) const
 {
-    _reverbEnabled = enable;
-    _reverbImpulse = ir;
-    _reverbLen = irLen;
+    if (stream < 0)
+        return -1;
+    int slot = stream & 0xFF;
+    if (slot >= Megaphone_MAX_STREAMS)
+        return -1;
+    if (((uint32_t)stream >> 8) != (_streams[slot].generation & Megaphone_GENERATION_MASK))
+        return -1;
+    return slot;
 }
-void Megaphone::enableCompressor(bool enable, float threshold, float ratio, float attack, float release)
+
+int Megaphone::primaryStream() const
 {
-    _compressorEnabled = enable;
-    _compressorThreshold = threshold;
-    _compressorRatio = ratio;
-    _compressorAttack = attack;
-    _compressorRelease = release;
+    return makeHandle(Megaphone_PRIMARY_STREAM);
 }
 
-// ------------ 清空DMA缓冲 ------------
-void Megaphone::clearBuffer()
+bool Megaphone::isStreamValid(int stream) const
 {
-    _star_pal = 0; // 用于确保队列中有相应的数据包的时候才开始播放！
-
-    i2s_zero_dma_buffer(_i2s_num);
-    Serial.println("Megaphone: DMA buffer cleared.");
+    return isSlotOpen(resolveStream(stream));
 }
 
-// ------------ 获取队列可用空间 ------------
-size_t Megaphone::getBufferFree() const
+int Megaphone::openStream(uint8_t priority, float gain)
 {
-    if (!_audioQueue)
-        return 0;
-    return uxQueueSpacesAvailable(_audioQueue);
+    return openSlot(priority, gain, 0, 0);
 }
 
-// ------------ 回调 ------------
-void Megaphone::setPlaybackCallback(PlaybackCallback callback, void *context)
+int Megaphone::openSegment(uint32_t crossfadeMs, float gain)
 {
-    _callback = callback;
-    _callbackContext = context;
+    if (crossfadeMs > Megaphone_MAX_CROSSFADE_MS)
+        crossfadeMs = Megaphone_MAX_CROSSFADE_MS;
+    uint32_t segment = ++_segmentSeq;
+    if (segment == 0)
+        segment = ++_segmentSeq; // 0 表示普通流
+    return openSlot(Megaphone_PRIORITY_NORMAL, gain, segment, crossfadeMs * _sampleRate / 1000);
 }
 
-// ------------ 音频处理(音量+效果等) ------------
-void Megaphone::processAudioBuffer(int16_t *buffer, size_t sampleCount)
+int Megaphone::openSlot(uint8_t priority, float gain, uint32_t segment, uint32_t crossfadeFrames)
 {
-    // 1. 音量增益
-    if (_ampGain != 1.0f)
+    if (!isSlotOpen(Megaphone_PRIMARY_STREAM))
+        return -1;
+
+    // 查找和占用在同一个临界区内完成，两个任务不会拿到同一个槽位
+    int claimed = -1;
+    portENTER_CRITICAL(&_slotLock);
+    for (int i = 0; i < Megaphone_MAX_STREAMS; i++)
+    {
+        if (i != Megaphone_PRIMARY_STREAM && _streams[i].slot == StreamSlot::Free)
+        {
+            _streams[i].slot = StreamSlot::Opening;
+            claimed = i;
+            break;
+        }
+    }
+    portEXIT_CRITICAL(&_slotLock);
+
+    if (claimed >= 0)
+    {
+        Stream &s = _streams[claimed];
+        s.priority = priority;
+        s.routing = _priorityRouting[priority > Megaphone_PRIORITY_HIGH ? Megaphone_PRIORITY_HIGH : priority];
+        s.gain = gain;
+        s.duck = 1.0f;
+        s.sampleRate = 0;
+        s.channels = 1;
+        s.segment = segment;
+        s.xfadeFrames = crossfadeFrames;
+        s.segStarted = false;
+        s.fadeLen = 0;
+        s.fadeDelay = 0;
+        s.ring.detach();
+        s.generation++;
+        s.slot = StreamSlot::Open;
+        return makeHandle(claimed);
+    }
+    Serial.println("Megaphone: No free stream slot!");
+    return -1;
+}
+
+bool Megaphone::closeStream(int stream, PlaybackCallback onDone, void *context)
+{
+    int slot = resolveStream(stream);
+    if (!isSlotOpen(slot))
+        return false;
+    if (!addEndMarker(slot, onDone, context))
+        return false;
+    if (slot != Megaphone_PRIMARY_STREAM)
+    {
+        _streams[slot].slot = StreamSlot::Closing;
+    }
+    notifyWriter();
+    return true;
+}
+
+void Megaphone::releaseStream(int stream)
+{
+    int slot = resolveStream(stream);
+    if (slot <= Megaphone_PRIMARY_STREAM)
+        return;
+    StreamSlot state = _streams[slot].slot;
+    if (state != StreamSlot::Open && state != StreamSlot::Closing)
+        return;
+
+    _streams[slot].generation++;
+    if (_writerTaskHandle)
+    {
+        // 缓冲区的读端属于后台任务，由它丢弃剩余数据
+        _streams[slot].slot = StreamSlot::Releasing;
+        notifyWriter();
+    }
+    else
+    {
+        _streams[slot].ring.discard();
+        _streams[slot].slot = StreamSlot::Free;
+    }
+}
+
+size_t Megaphone::writeStream(int stream, const int16_t *buffer, size_t sampleCount)
+{
+    int slot = resolveStream(stream);
+    bool isPrimary = slot == Megaphone_PRIMARY_STREAM;
+    if (isPrimary)
+        syncProducer();
+    if (!isSlotOpen(slot) || !buffer || sampleCount == 0)
+        return 0;
+    Stream &s = _streams[slot];
+    if (!syncFormat(s))
+        return 0;
+
+    // 和附加流一样只写入放得下的部分(queuePCM 仍是整块接收或整块拒绝)
+    size_t frames = sampleCount / s.channels;
+    size_t fit = s.resampler.inputFor(s.ring.freeSpace());
+    if (frames > fit)
+    {
+        frames = fit;
+        if (isPrimary)
+            _jitter.onOverrun();
+    }
+    size_t written = appendConverted(s, buffer, frames);
+    if (written > 0)
+    {
+        if (isPrimary)
+            _jitter.onArrival(written, micros());
+        notifyWriter();
+    }
+    return frames * s.channels;
+}
+
+int Megaphone::playBuffer(const int16_t *pcm, size_t samples, uint8_t priority, float gain,
+                          PlaybackCallback onDone, void *context)
+{
+    if (!pcm || samples == 0)
+        return -1;
+    int stream = openStream(priority, gain);
+    if (stream < 0)
+        return -1;
+
+    // 挂接后立即关闭：不再接受写入，最后一个采样播完时释放并回调
+    Stream &s = _streams[resolveStream(stream)];
+    if (!s.ring.attach(pcm, samples) || !closeStream(stream, onDone, context))
+    {
+        releaseStream(stream);
+        return -1;
+    }
+    return stream;
+}
+
+bool Megaphone::isBufferInUse(const int16_t *pcm) const
+{
+    for (int i = 0; i < Megaphone_MAX_STREAMS; i++)
+    {
+        if (_streams[i].slot != StreamSlot::Free && _streams[i].ring.attached() == pcm)
+            return true;
+    }
+    return false;
+}
+
+bool Megaphone::setStreamFormat(int stream, uint32_t sampleRate, uint8_t channels)
+{
+    int slot = resolveStream(stream);
+    if (!isSlotOpen(slot) || channels == 0)
+        return false;
+    Stream &s = _streams[slot];
+    s.sampleRate = sampleRate;
+    s.channels = channels;
+    return syncFormat(s);
+}
+
+bool Megaphone::syncFormat(Stream &s)
+{
+    uint32_t inRate = s.sampleRate ? s.sampleRate : _sampleRate;
+    if (s.resampler.inputRate() == inRate && s.resampler.outputRate() == _sampleRate &&
+        s.resampler.channels() == s.channels)
+        return true;
+    return s.resampler.configure(inRate, _sampleRate, s.channels);
+}
+
+size_t Megaphone::inputFree(const Stream &s) const
+{
+    size_t free = s.ring.freeSpace();
+    if (s.resampler.isPassthrough())
+        return free;
+    return s.resampler.inputFor(free) * s.resampler.channels();
+}
+
+size_t Megaphone::appendConverted(Stream &s, const int16_t *in, size_t frames)
+{
+    if (s.resampler.isPassthrough())
+        return s.ring.write(in, frames);
+
+    // 直接重采样进缓冲区的连续空间，回绕处分两次
+    size_t total = 0;
+    size_t used = 0;
+    while (used < frames)
+    {
+        size_t wanted = s.resampler.outputFor(frames - used);
+        int16_t *dst = nullptr;
+        size_t space = wanted > 0 ? s.ring.reserve(&dst, wanted) : 0;
+        if (wanted > 0 && space == 0)
+            break;
+        size_t consumed = 0;
+        size_t n = s.resampler.process(in + used * s.channels, frames - used, dst, space, consumed);
+        if (n > 0)
+            s.ring.commit(n);
+        total += n;
+        used += consumed;
+        if (n == 0 && consumed == 0)
+            break;
+    }
+    return total;
+}
+
+size_t Megaphone::getStreamFree(int stream) const
+{
+    int slot = resolveStream(stream);
+    return isSlotOpen(slot) ? inputFree(_streams[slot]) : 0;
+}
+
+size_t Megaphone::getStreamBuffered(int stream) const
+{
+    int slot = resolveStream(stream);
+    return slot >= 0 ? _streams[slot].ring.available() : 0;
+}
+
+void Megaphone::setStreamGain(int stream, float gain)
+{
+    int slot = resolveStream(stream);
+    if (slot >= 0)
+        _streams[slot].gain = gain;
+}
+
+void Megaphone::setStreamPriority(int stream, uint8_t priority)
+{
+    int slot = resolveStream(stream);
+    if (slot >= 0)
+        _streams[slot].priority = priority;
+}
+
+void Megaphone::setDucking(float duckGain, uint32_t rampMs)
+{
+    if (duckGain < 0.0f)
+        duckGain = 0.0f;
+    if (duckGain > 1.0f)
+        duckGain = 1.0f;
+    _duckGain = duckGain;
+    _duckRampMs = rampMs;
+}
+
+void Megaphone::setStreamRouting(int stream, uint8_t mask)
+{
+    int slot = resolveStream(stream);
+    if (slot >= 0)
+        _streams[slot].routing = mask;
+}
+
+void Megaphone::setPriorityRouting(uint8_t priority, uint8_t mask)
+{
+    _priorityRouting[priority > Megaphone_PRIORITY_HIGH ? Megaphone_PRIORITY_HIGH : priority] = mask;
+}
+
+uint8_t Megaphone::effectiveRouting(uint8_t mask) const
+{
+    if (_outChannels <= 1)
+        return 0x01;
+    return mask & (uint8_t)((1u << _outChannels) - 1);
+}
+
+void Megaphone::reapStreams()
+{
+    for (int i = 0; i < Megaphone_MAX_STREAMS; i++)
+    {
+        if (_streams[i].slot == StreamSlot::Releasing)
+        {
+            _streams[i].ring.discard();
+            _streams[i].slot = StreamSlot::Free;
+        }
+    }
+}
+
+size_t Megaphone::mixStream(Stream &s, int32_t *accumulator, size_t count, int32_t gainFrom, int32_t gainTo, bool primary,
+                            uint8_t routing, size_t planeStride)
+{
+    // 回绕处分两段取切片；增益过渡按两段的长度分配
+    size_t mixed = 0;
+    while (mixed < count)
+    {
+        int16_t *slice = nullptr;
+        size_t n = s.ring.peek(&slice, count - mixed);
+        if (n == 0)
+            break;
+        if (primary)
+        {
+            // 欠载后恢复的第一块与补偿信号交叉淡化
+            _concealer.resume(slice, n);
+            _concealer.observe(slice, n);
+        }
+        int32_t from = gainFrom + (int32_t)((int64_t)(gainTo - gainFrom) * mixed / count);
+        int32_t to = gainFrom + (int32_t)((int64_t)(gainTo - gainFrom) * (mixed + n) / count);
+        // 同一切片累加进每个选中的声道；没有选中声道时只消费(静音)
+        for (uint8_t c = 0; (routing >> c) != 0; c++)
+        {
+            if (routing & (1u << c))
+                AudioProcessor::mixAccumulate(accumulator + c * planeStride + mixed, slice, n, from, to);
+        }
+        s.ring.consume(n);
+        mixed += n;
+    }
+    return mixed;
+}
+
+// ------------ 片段流 ------------
+int Megaphone::segmentAt(int rank) const
+{
+    int first = -1;
+    int second = -1;
+    for (int i = 0; i < Megaphone_MAX_STREAMS; i++)
+    {
+        const Stream &s = _streams[i];
+        if (s.segment == 0 || (s.slot != StreamSlot::Open && s.slot != StreamSlot::Closing))
+            continue;
+        // 序号回绕后仍按先后比较
+        if (first < 0 || (int32_t)(s.segment - _streams[first].segment) < 0)
+        {
+            second = first;
+            first = i;
+        }
+        else if (second < 0 || (int32_t)(s.segment - _streams[second].segment) < 0)
+        {
+            second = i;
+        }
+    }
+    return rank == 0 ? first : second;
+}
+
+bool Megaphone::segmentReady(const Stream &s) const
+{
+    size_t avail = s.ring.available();
+    if (avail == 0)
+        return false;
+    return s.slot == StreamSlot::Closing ||
+           avail >= (size_t)((uint64_t)Megaphone_SEGMENT_PREBUFFER_MS * _sampleRate / 1000);
+}
+
+void Megaphone::startSegments()
+{
+    // 前一段没能接上(后一段来得太晚)时，后一段成为最早的片段，缓冲够了再开始
+    int head = segmentAt(0);
+    if (head < 0 || _streams[head].segStarted || !segmentReady(_streams[head]))
+        return;
+    _streams[head].segStarted = true;
+    _streams[head].fadeLen = 0;
+}
+
+void Megaphone::handoffSegment(size_t n, size_t *available, size_t *offsets)
+{
+    int head = segmentAt(0);
+    int next = segmentAt(1);
+    if (head < 0 || next < 0 || n == 0)
+        return;
+    Stream &h = _streams[head];
+    Stream &x = _streams[next];
+    if (!h.segStarted || x.segStarted || h.slot != StreamSlot::Closing || !segmentReady(x))
+        return;
+
+    // 前一段已写完，剩余长度确定；剩余不超过 本块 + 重叠长度 时，后一段在本块中接上
+    size_t remaining = h.ring.available();
+    if (remaining >= n + x.xfadeFrames)
+        return;
+    size_t offset = remaining > x.xfadeFrames ? remaining - x.xfadeFrames : 0;
+    uint32_t overlap = (uint32_t)(remaining - offset);  // 剩余不够时缩短交叉淡化
+
+    x.segStarted = true;
+    x.fadeOut = false;
+    x.fadeLen = overlap;
+    x.fadePos = 0;
+    x.fadeDelay = 0;
+    size_t avail = x.ring.available();
+    available[next] = avail < n - offset ? avail : n - offset;
+    offsets[next] = offset;
+
+    if (overlap > 0)
+    {
+        h.fadeOut = true;
+        h.fadeLen = overlap;
+        h.fadePos = 0;
+        h.fadeDelay = (uint32_t)offset;
+    }
+}
+
+size_t Megaphone::mixSegment(Stream &s, int32_t *accumulator, size_t offset, size_t count, int32_t gainFrom,
+                             int32_t gainTo, uint8_t routing, size_t planeStride)
+{
+    if (s.fadeLen == 0)
+        return mixStream(s, accumulator + offset, count, gainFrom, gainTo, false, routing, planeStride);
+
+    // 最多三段: 淡出开始前(原增益)、交叉淡化、淡化结束后(淡入为原增益，淡出为静音)
+    size_t mixed = 0;
+    while (mixed < count)
+    {
+        size_t len = count - mixed;
+        float f0 = 1.0f;
+        float f1 = 1.0f;
+        bool fading = false;
+        if (s.fadeDelay > 0)
+        {
+            len = s.fadeDelay < len ? s.fadeDelay : len;
+        }
+        else if (s.fadePos < s.fadeLen)
+        {
+            size_t left = s.fadeLen - s.fadePos;
+            len = left < len ? left : len;
+            f0 = (float)s.fadePos / s.fadeLen;
+            f1 = (float)(s.fadePos + len) / s.fadeLen;
+            if (s.fadeOut)
+            {
+                f0 = 1.0f - f0;
+                f1 = 1.0f - f1;
+            }
+            fading = true;
+        }
+        else if (s.fadeOut)
+        {
+            f0 = f1 = 0.0f;
+        }
+
+        // 按本段在块中的位置插值出原增益，再乘上淡化系数
+        int32_t base0 = gainFrom + (int32_t)((int64_t)(gainTo - gainFrom) * mixed / count);
+        int32_t base1 = gainFrom + (int32_t)((int64_t)(gainTo - gainFrom) * (mixed + len) / count);
+        size_t got = mixStream(s, accumulator + offset + mixed, len, (int32_t)(base0 * f0), (int32_t)(base1 * f1),
+                               false, routing, planeStride);
+        if (s.fadeDelay > 0)
+            s.fadeDelay -= got;
+        else if (fading)
+            s.fadePos += got;
+        mixed += got;
+        if (got < len)
+            break;
+        if (!s.fadeOut && s.fadePos >= s.fadeLen && s.fadeDelay == 0)
+        {
+            s.fadeLen = 0;  // 淡入结束，之后按原增益
+            if (mixed < count)
+                mixed += mixStream(s, accumulator + offset + mixed, count - mixed,
+                                   gainFrom + (int32_t)((int64_t)(gainTo - gainFrom) * mixed / count), gainTo,
+                                   false, routing, planeStride);
+            break;
+        }
+    }
+    return mixed;
+}
+
+// ------------ 从文件读取并播放(阻塞示例) ------------
+void Megaphone::playFromFile(const char *filename)
+{
+    // 已挂载时 begin() 直接返回，播放结束后也不卸载
+    if (!SPIFFS.begin(true))
+    {
+        Serial.println("Megaphone: Failed to mount SPIFFS");
+        return;
+    }
+
+    File audioFile = SPIFFS.open(filename, "r");
+    if (!audioFile)
+    {
+        Serial.println("Megaphone: Failed to open audio file");
+        return;
+    }
+
+    Serial.println("Megaphone: Starting playback from file...");
+    int16_t buffer[256];
+    size_t bytesRead;
+
+    while ((bytesRead = audioFile.read((uint8_t *)buffer, sizeof(buffer))) > 0)
+    {
+        size_t samples = bytesRead / sizeof(int16_t);
+        // 阻塞播放 (也可改用 queuePCM 让后台播放)
+        AudioProcessor::applyGainQ15(buffer, samples, _muted ? 0 : _volumeQ15);
+        playPCM(buffer, samples);
+    }
+
+    audioFile.close();
+    Serial.println("Megaphone: Playback finished.");
+}
+
+// ------------ 参数设置 ------------
+void Megaphone::setSampleRate(uint32_t sampleRate)
+{
+    if (sampleRate == 0 || sampleRate > Concealer_MAX_SAMPLE_RATE)
+    {
+        Serial.println("Megaphone: Unsupported sample rate");
+        return;
+    }
+    if (!_writerTaskHandle)
+    {
+        _sampleRate = sampleRate; // begin() 之前直接生效
+        return;
+    }
+    sendCommand(WriterCommand::Reconfigure, sampleRate, true);
+}
+void Megaphone::setBitsPerSample(i2s_bits_per_sample_t bitsPerSample)
+{
+    _bitsPerSample = bitsPerSample;
+}
+void Megaphone::setChannelFormat(i2s_channel_fmt_t channelFormat)
+{
+    if (_writerTaskHandle)
+    {
+        Serial.println("Megaphone: Channel format must be set before begin()");
+        return;
+    }
+    _channelFormat = channelFormat;
+    uint8_t channels = channelsForFormat(channelFormat);
+    if (channels > 0 || _outChannels <= 2)
+        _outChannels = channels;   // TDM 保留 setOutputChannels() 设置的声道数
+}
+bool Megaphone::setOutputChannels(uint8_t channels)
+{
+    if (_writerTaskHandle)
+    {
+        Serial.println("Megaphone: Output channels must be set before begin()");
+        return false;
+    }
+    if (channels == 0 || channels > Megaphone_MAX_OUT_CHANNELS)
+    {
+        Serial.println("Megaphone: Unsupported channel count");
+        return false;
+    }
+    if (channels <= 2)
+    {
+        _channelFormat = channels == 1 ? I2S_CHANNEL_FMT_ONLY_LEFT : I2S_CHANNEL_FMT_RIGHT_LEFT;
+    }
+    else
+    {
+#if SOC_I2S_SUPPORTS_TDM
+        _channelFormat = I2S_CHANNEL_FMT_MULTIPLE;
+#else
+        Serial.println("Megaphone: TDM is not supported on this chip");
+        return false;
+#endif
+    }
+    _outChannels = channels;
+    return true;
+}
+uint8_t Megaphone::channelsForFormat(i2s_channel_fmt_t format)
+{
+    switch (format)
+    {
+    case I2S_CHANNEL_FMT_RIGHT_LEFT:
+        return 2;
+    case I2S_CHANNEL_FMT_ONLY_LEFT:
+    case I2S_CHANNEL_FMT_ONLY_RIGHT:
+    case I2S_CHANNEL_FMT_ALL_LEFT:    // 单声道数据，由硬件复制到两个声道
+    case I2S_CHANNEL_FMT_ALL_RIGHT:
+        return 1;
+    default:
+        return 0;   // TDM: 声道数由 setOutputChannels() 指定
+    }
+}
+void Megaphone::setCommFormat(i2s_comm_format_t commFormat)
+{
+    _commFormat = commFormat;
+}
+void Megaphone::setPins(int bckPin, int wsPin, int dataOutPin)
+{
+    _bckPin = bckPin;
+    _wsPin = wsPin;
+    _dataOutPin = dataOutPin;
+}
+// ------------ 音量 ------------
+bool Megaphone::setVolumeCurve(float minDb, float maxDb, uint8_t steps)
+{
+    if (steps < 2 || steps > Megaphone_VOLUME_MAX_STEPS || minDb >= maxDb)
+    {
+        Serial.println("Megaphone: Invalid volume curve");
+        return false;
+    }
+    if (maxDb > 6.0f)
+        maxDb = 6.0f;
+    _volumeTable[0] = 0;
+    for (uint8_t i = 1; i < steps; i++)
     {
-        AudioProcessor::applyGain(buffer, sampleCount, _ampGain);
+        float db = steps == 2 ? maxDb : minDb + (maxDb - minDb) * (i - 1) / (steps - 2);
+        _volumeTable[i] = AudioProcessor::gainToQ15(powf(10.0f, db / 20.0f));
     }
-    // 2. 压缩
+    _volumeSteps = steps;
+    if (_volumeStep >= steps)
+        _volumeStep = steps - 1;
+    return true;
+}
+
+void Megaphone::setVolumeStep(uint8_t step)
+{
+    if (step >= _volumeSteps)
+        step = _volumeSteps - 1;
+    _volumeStep = step;
+    _volumeQ15 = _volumeTable[step];
+}
+
+void Megaphone::volumeUp()
+{
+    if (_volumeStep + 1 < _volumeSteps)
+        setVolumeStep(_volumeStep + 1);
+}
+
+void Megaphone::volumeDown()
+{
+    if (_volumeStep > 0)
+        setVolumeStep(_volumeStep - 1);
+}
+
+void Megaphone::setVolume(float gain)
+{
+    int32_t q15 = AudioProcessor::gainToQ15(gain);
+    _volumeQ15 = q15;
+    // 档位取最接近的一档，之后 volumeUp/volumeDown 从这里继续
+    uint8_t best = 0;
+    for (uint8_t i = 1; i < _volumeSteps; i++)
+    {
+        if (abs(_volumeTable[i] - q15) < abs(_volumeTable[best] - q15))
+            best = i;
+    }
+    _volumeStep = best;
+}
+
+void Megaphone::setVolumeDb(float db)
+{
+    setVolume(powf(10.0f, db / 20.0f));
+}
+
+float Megaphone::getVolumeDb() const
+{
+    int32_t q15 = _muted ? 0 : _volumeQ15;
+    return q15 > 0 ? 20.0f * log10f((float)q15 / 32768.0f) : -INFINITY;
+}
+
+// ------------ 播放时钟与状态 ------------
+void Megaphone::advanceClock(size_t samples)
+{
+    uint32_t now = micros();
+    size_t dmaCapacity = (size_t)_dmaBufCount * _dmaBufLen;
+    portENTER_CRITICAL(&_clockLock);
+    // 先扣掉上次写入之后已经播放出去的部分，再加上本次写入
+    size_t played = (size_t)((uint64_t)(now - _lastWriteUs) * _sampleRate / 1000000ULL);
+    size_t fill = played >= _dmaFillSamples ? 0 : _dmaFillSamples - played;
+    fill += samples;
+    _dmaFillSamples = fill > dmaCapacity ? dmaCapacity : fill;
+    _samplesWritten += samples;
+    _lastWriteUs = now;
+    portEXIT_CRITICAL(&_clockLock);
+}
+
+void Megaphone::resetClock()
+{
+    portENTER_CRITICAL(&_clockLock);
+    _dmaFillSamples = 0;
+    _lastWriteUs = micros();
+    portEXIT_CRITICAL(&_clockLock);
+}
+
+size_t Megaphone::getDmaQueuedSamples() const
+{
+    uint32_t now = micros();
+    portENTER_CRITICAL(&_clockLock);
+    size_t played = (size_t)((uint64_t)(now - _lastWriteUs) * _sampleRate / 1000000ULL);
+    size_t fill = played >= _dmaFillSamples ? 0 : _dmaFillSamples - played;
+    portEXIT_CRITICAL(&_clockLock);
+    return fill;
+}
+
+uint64_t Megaphone::getSamplesWritten() const
+{
+    portENTER_CRITICAL(&_clockLock);
+    uint64_t written = _samplesWritten;
+    portEXIT_CRITICAL(&_clockLock);
+    return written;
+}
+
+uint64_t Megaphone::getSamplesPlayed() const
+{
+    return getSamplesWritten() - getDmaQueuedSamples();
+}
+
+uint32_t Megaphone::getOutputLatencyMs() const
+{
+    return (uint32_t)((uint64_t)getDmaQueuedSamples() * 1000 / _sampleRate);
+}
+
+uint32_t Megaphone::getDmaLatencyMs() const
+{
+    return (uint32_t)((uint64_t)_dmaBufCount * _dmaBufLen * 1000 / _sampleRate);
+}
+
+uint32_t Megaphone::getBufferedMs() const
+{
+    return (uint32_t)((uint64_t)(_streams[Megaphone_PRIMARY_STREAM].ring.available() + _pipelineFrames + getDmaQueuedSamples()) *
+                      1000 / _sampleRate);
+}
+
+PlaybackState Megaphone::getPlaybackState() const
+{
+    PlaybackState state = _state;
+    // 后台任务只知道缓冲区空了，DMA 是否播完要看时钟
+    if (state == PlaybackState::Draining || state == PlaybackState::Idle)
+    {
+        return getDmaQueuedSamples() > 0 ? PlaybackState::Draining : PlaybackState::Idle;
+    }
+    return state;
+}
+
+bool Megaphone::isPlaying() const
+{
+    PlaybackState state = getPlaybackState();
+    return state == PlaybackState::Playing || state == PlaybackState::Draining;
+}
+
+// ============ 音频效果开关 ============
+void Megaphone::enableEcho(bool enable, float delaySeconds, float decay)
+{
+    _echoEnabled = enable;
+    _echoDelay = delaySeconds;
+    _echoDecay = decay;
+}
+void Megaphone::enableReverb(bool enable, const float *ir, size_t irLen)
+{
+    _reverbEnabled = enable;
+    _reverbImpulse = ir;
+    _reverbLen = irLen;
+}
+void Megaphone::enableCompressor(bool enable, float threshold, float ratio, float attack, float release)
+{
+    _compressorEnabled = enable;
+    _compressorThreshold = threshold;
+    _compressorRatio = ratio;
+    _compressorAttack = attack;
+    _compressorRelease = release;
+}
+
+// ------------ 打断 ------------
+void Megaphone::flush()
+{
+    if (!isSlotOpen(Megaphone_PRIMARY_STREAM))
+        return;
+
+    // 1. 所有旧句柄立即失效，之后用旧句柄写入/关闭都会被拒绝
+    for (int i = 0; i < Megaphone_MAX_STREAMS; i++)
+    {
+        Stream &s = _streams[i];
+        s.generation++;
+        if (i != Megaphone_PRIMARY_STREAM && (s.slot == StreamSlot::Open || s.slot == StreamSlot::Closing))
+        {
+            s.slot = StreamSlot::Releasing;
+        }
+    }
+    // 2. 主流只丢弃此刻之前写入的数据，flush() 之后到达的新回复照常播放
+    _flushPos = _streams[Megaphone_PRIMARY_STREAM].ring.totalWritten();
+    // 解码器和重采样器的状态属于主流的生产者(websocket 任务)，这里可能正在使用，
+    // 只做标记，由生产者下一次写入时自己清除
+    _producerReset.store(true, std::memory_order_release);
+
+    // 3. 缓冲区的读端和 DMA 属于后台任务，由它在下一个块之前执行
+    sendCommand(WriterCommand::Flush);
+}
+
+void Megaphone::applyFlush()
+{
+    PcmRingBuffer &ring = _streams[Megaphone_PRIMARY_STREAM].ring;
+    int32_t stale = (int32_t)(_flushPos - ring.totalRead());
+    if (stale > 0)
+    {
+        size_t available = ring.available();
+        ring.consume((size_t)stale < available ? (size_t)stale : available);
+    }
+    reapStreams();
+    discardPipeline();
+    _lastEndPos = ring.totalRead();
+
+    _prebuffering = true; // 重新积累起播缓冲
+    _jitter.restart();
+    _concealer.reset();
+
+    // 丢掉 DMA 中还没播放的音频。旧驱动拿不到 DMA 缓冲区，无法对正在播放的部分淡出，
+    // 清空的位置仍会有一次截断；之后的新音频从 0 淡入，只避免新音频起点的第二次跳变
+    if (_sink)
+        _sink->clear();
+    else
+        i2s_zero_dma_buffer(_i2s_num);
+    resetClock();
+    _fadeGain = 0.0f;
+    _flushes++;
+    _state = PlaybackState::Idle;
+}
+
+// ------------ 清空DMA缓冲 ------------
+void Megaphone::clearBuffer()
+{
+    flush();
+    Serial.println("Megaphone: Buffers flushed.");
+}
+
+// ------------ 获取缓冲区可用空间 ------------
+size_t Megaphone::getBufferFree() const
+{
+    return getBufferFreeSamples() / Megaphone_CHUNK_SAMPLES;
+}
+
+size_t Megaphone::getBufferFreeSamples() const
+{
+    return inputFree(_streams[Megaphone_PRIMARY_STREAM]);
+}
+
+size_t Megaphone::getBufferedSamples() const
+{
+    return _streams[Megaphone_PRIMARY_STREAM].ring.available();
+}
+
+// ------------ 统计 ------------
+MegaphoneStats Megaphone::getStats() const
+{
+    MegaphoneStats s;
+    s.underruns = _jitter.getUnderruns();
+    s.overruns = _jitter.getOverruns();
+    s.jitterMs = _jitter.getJitterMs();
+    s.targetDelayMs = _jitter.getTargetDelayMs();
+    s.concealEvents = _concealer.getEvents();
+    s.concealedMs = (uint32_t)((uint64_t)_concealer.getConcealedSamples() * 1000 / _sampleRate);
+    s.bufferedSamples = _streams[Megaphone_PRIMARY_STREAM].ring.available();
+    s.bufferedMs = getBufferedMs();
+    s.outputLatencyMs = getOutputLatencyMs();
+    s.samplesPlayed = getSamplesPlayed();
+    s.activeStreams = _activeStreams;
+    s.flushes = _flushes;
+    s.dmaBufCount = (uint16_t)_dmaBufCount;
+    s.dmaBufLen = (uint16_t)_dmaBufLen;
+    s.dmaLatencyMs = getDmaLatencyMs();
+    s.schedJitterUs = _schedJitterUs;
+    s.dspBlocks = _dspProcessed;
+    s.dspMaxUs = _dspMaxUs;
+    s.dspStalls = _dspStalls;
+    return s;
+}
+
+void Megaphone::printStats() const
+{
+    MegaphoneStats s = getStats();
+    Serial.printf("Megaphone: underruns=%u overruns=%u jitter=%ums targetDelay=%ums buffered=%u\n",
+                  s.underruns, s.overruns, s.jitterMs, s.targetDelayMs, (unsigned)s.bufferedSamples);
+    Serial.printf("Megaphone: conceal events=%u total=%ums flushes=%u\n", s.concealEvents, s.concealedMs, s.flushes);
+    Serial.printf("Megaphone: bufferedMs=%u outputLatency=%ums played=%llu streams=%u\n",
+                  s.bufferedMs, s.outputLatencyMs, (unsigned long long)s.samplesPlayed, s.activeStreams);
+    Serial.printf("Megaphone: DMA %u x %u = %ums, sched jitter %uus\n",
+                  s.dmaBufCount, s.dmaBufLen, s.dmaLatencyMs, s.schedJitterUs);
+    if (_dspTaskHandle)
+    {
+        Serial.printf("Megaphone: DSP blocks=%u max=%uus stalls=%u\n", s.dspBlocks, s.dspMaxUs, s.dspStalls);
+    }
+}
+
+// ------------ 回调 ------------
+void Megaphone::setPlaybackCallback(PlaybackCallback callback, void *context)
+{
+    _callback = callback;
+    _callbackContext = context;
+}
+
+// ------------ 音频处理(音量+效果等) ------------
+void Megaphone::processAudioBuffer(int16_t *buffer, size_t sampleCount)
+{
+    // 1. 音量增益(定点)
+    AudioProcessor::applyGainQ15(buffer, sampleCount, _muted ? 0 : _volumeQ15);
+    processEffects(buffer, sampleCount / _outChannels, _outChannels);
+}
+
+bool Megaphone::hasEffects() const
+{
+    return _compressorEnabled || _echoEnabled || (_reverbEnabled && _reverbImpulse && _reverbLen > 0);
+}
+
+void Megaphone::processEffects(int16_t *buffer, size_t frames, uint8_t channels)
+{
+    if (channels <= 1)
+    {
+        applyEffects(buffer, frames);
+        return;
+    }
+
+    // 效果按单声道信号实现(延迟线、包络按采样序号)，交错的多声道逐个声道拆出来处理，
+    // 否则 L/R 会互相串进延迟线，延迟时间也会缩短为 1/channels
+    int16_t channel[Megaphone_WRITE_BLOCK_SAMPLES / 2];
+    const size_t chunk = sizeof(channel) / sizeof(channel[0]);
+    for (size_t start = 0; start < frames; start += chunk)
+    {
+        size_t n = frames - start < chunk ? frames - start : chunk;
+        int16_t *base = buffer + start * channels;
+        for (uint8_t c = 0; c < channels; c++)
+        {
+            for (size_t i = 0; i < n; i++)
+                channel[i] = base[i * channels + c];
+            applyEffects(channel, n);
+            for (size_t i = 0; i < n; i++)
+                base[i * channels + c] = channel[i];
+        }
+    }
+}
+
+void Megaphone::applyEffects(int16_t *buffer, size_t sampleCount)
+{
+    // 1. 压缩
     if (_compressorEnabled)
     {
         AudioProcessor::applyCompressor(buffer, sampleCount,
                                         _compressorThreshold, _compressorRatio,
                                         _compressorAttack, _compressorRelease);
     }
-    // 3. 回声
+    // 2. 回声
     if (_echoEnabled)
     {
         AudioProcessor::applyEcho(buffer, sampleCount, _echoDelay, _echoDecay);
     }
-    // 4. 混响
+    // 3. 混响
     if (_reverbEnabled && _reverbImpulse && _reverbLen > 0)
     {
         AudioProcessor::applyReverb(buffer, sampleCount, _reverbImpulse, _reverbLen);
     }
 }
 
-// ------------ 后台任务 ------------
-void Megaphone::i2sWriterTask(void *parameter)
+// ------------ 效果流水线 ------------
+void Megaphone::drainPipeline()
+{
+    uint32_t done = _dspDone.load(std::memory_order_acquire);
+    while (_dspWritten != done)
+    {
+        DspBlock &b = _dspBlocks[_dspWritten % Megaphone_DSP_BLOCKS];
+        playPCM(b.pcm, b.samples);
+        _pipelineFrames -= b.samples / _outChannels;
+        _dspWritten++;
+    }
+}
+
+void Megaphone::discardPipeline()
 {
-    _star_pal = 0; // 用于确保队列中有相应的数据包的时候才开始播放！
+    if (!_dspTaskHandle)
+        return;
+    // 效果任务最多还在处理一块，等它处理完再整体丢弃
+    while (_dspDone.load(std::memory_order_acquire) != _dspMixed.load(std::memory_order_relaxed))
+    {
+        ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(1));
+    }
+    _dspWritten = _dspMixed.load(std::memory_order_relaxed);
+    _pipelineFrames = 0;
+}
 
-    Megaphone *self = static_cast<Megaphone *>(parameter);  // 获取对象指针 
-    // 清空队列
-    AudioChunk chunk;
-    while (xQueueReceive(self->_audioQueue, &chunk, 0) == pdTRUE)
+void Megaphone::dspTask(void *parameter)
+{
+    Megaphone *self = static_cast<Megaphone *>(parameter);
+    while (!self->_dspQuit)
     {
-        free(chunk.data);
-        
+        uint32_t done = self->_dspDone.load(std::memory_order_relaxed);
+        if (done == self->_dspMixed.load(std::memory_order_acquire))
+        {
+            ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+            continue;
+        }
+        DspBlock &b = self->_dspBlocks[done % Megaphone_DSP_BLOCKS];
+        uint32_t start = micros();
+        self->processEffects(b.pcm, b.samples / b.channels, b.channels);
+        uint32_t elapsed = micros() - start;
+        if (elapsed > self->_dspMaxUs)
+            self->_dspMaxUs = elapsed;
+        self->_dspProcessed++;
+        self->_dspDone.store(done + 1, std::memory_order_release);
+        self->notifyWriter();
     }
+    // 析构时退出: 栈和任务控制块属于本对象，由析构函数删除任务
+    vTaskSuspend(NULL);
+}
 
-    while (true)
+// ------------ 后台任务 ------------
+void Megaphone::i2sWriterTask(void *parameter)
+{
+    Megaphone *self = static_cast<Megaphone *>(parameter);  // 获取对象指针 
+    Stream &primary = self->_streams[Megaphone_PRIMARY_STREAM];
+    // 混音缓冲按声道分块(每块 n 帧)，总长不变；多声道时每次处理的帧数相应减少
+    int32_t mixBuffer[Megaphone_WRITE_BLOCK_SAMPLES];
+    alignas(4) int16_t outBlock[Megaphone_WRITE_BLOCK_SAMPLES];
+    int16_t concealBlock[Concealer_MAX_SAMPLE_RATE * Concealer_BLOCK_MS / 1000];
+    size_t available[Megaphone_MAX_STREAMS];
+    size_t offsets[Megaphone_MAX_STREAMS];    // 片段流在本块中的起点
+    uint32_t dspFullSinceUs = 0;              // 块环从这个时间起一直是满的，0 表示没有满
+
+    while (self->processCommands())
     {
-        AudioChunk chunk;
-        // 当队列中有十个数据是，才开始播放 
+        if (self->_paused)
+        {
+            // 暂停时不再读缓冲区，只处理释放的流和 DMA 中剩余音频的结束回调
+            self->reapStreams();
+            self->dispatchEndMarkers();
+            ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(10));
+            continue;
+        }
+        self->reapStreams();
 
-        if (self->getBufferFree() < 45)
+        // 流水线: 先写出处理好的块；块环满时等效果任务处理完一块。
+        // 流水线填满后块环满是常态，只有超过一个块的播放时长还没有处理好的块才算跟不上
+        bool pipelined = self->_dspTaskHandle != nullptr;
+        if (pipelined)
         {
-            _star_pal = 1;
+            self->drainPipeline();
+            if (self->_dspMixed.load(std::memory_order_relaxed) - self->_dspWritten >= Megaphone_DSP_BLOCKS)
+            {
+                uint32_t now = micros();
+                uint32_t blockUs = (uint32_t)((uint64_t)Megaphone_WRITE_BLOCK_SAMPLES / self->_outChannels *
+                                              1000000ULL / self->_sampleRate);
+                if (dspFullSinceUs == 0)
+                {
+                    dspFullSinceUs = now | 1;   // 0 留给"没有满"
+                }
+                else if (now - dspFullSinceUs > blockUs)
+                {
+                    self->_dspStalls++;
+                    dspFullSinceUs = now | 1;   // 每多等一个块的时长记一次
+                }
+                ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(10));
+                continue;
+            }
+            dspFullSinceUs = 0;
         }
-        if (_star_pal == 1)
+        const uint8_t channels = self->_outChannels;
+        const size_t blockFrames = Megaphone_WRITE_BLOCK_SAMPLES / channels;
+
+        // 1. 主流积累到自适应起播延迟才开始播放；已收到 isLast 时不必等满
+        size_t primaryAvail = primary.ring.available();
+        if (self->_prebuffering && primaryAvail > 0 &&
+            (primaryAvail >= self->_jitter.getTargetSamples() || self->hasPendingEnd(Megaphone_PRIMARY_STREAM)))
         {
+            self->_prebuffering = false;
+        }
+        bool underrun = false;
+        if (!self->_prebuffering && primaryAvail == 0)
+        {
+            // 刚好播完 isLast 是正常结束；否则是网络供不上，重新缓冲并加大起播延迟。
+            // 缓冲区刚被搬进 DMA 时扬声器还有音频可播，流水线和 DMA 快播空才算欠载，在这之前只等下一包
+            if (primary.ring.totalRead() == self->_lastEndPos)
+            {
+                self->_prebuffering = true;
+            }
+            else if (self->_pipelineFrames + self->getDmaQueuedSamples() <=
+                     (size_t)((uint64_t)self->_sampleRate * Megaphone_UNDERRUN_GUARD_MS / 1000))
+            {
+                self->_jitter.onUnderrun();
+                underrun = true;
+                self->_prebuffering = true;
+            }
+        }
+        bool primaryPlaying = !self->_prebuffering && primaryAvail > 0;
 
-            if (xQueueReceive(self->_audioQueue, &chunk, portMAX_DELAY) == pdTRUE)
+        // 2. 块长: 主流在播放时以主流为准，避免主流中间出现空隙；否则取其他流中最多的
+        size_t n = 0;
+        uint8_t topPriority = 0;
+        uint8_t activeCount = 0;
+        if (primaryPlaying)
+        {
+            n = primaryAvail < blockFrames ? primaryAvail : blockFrames;
+            topPriority = primary.priority;
+            activeCount++;
+        }
+        self->startSegments();
+        for (int i = 0; i < Megaphone_MAX_STREAMS; i++)
+        {
+            available[i] = 0;
+            offsets[i] = 0;
+            StreamSlot slot = self->_streams[i].slot;
+            if (i == Megaphone_PRIMARY_STREAM || (slot != StreamSlot::Open && slot != StreamSlot::Closing))
+                continue;
+            if (self->_streams[i].segment != 0 && !self->_streams[i].segStarted)
+                continue;   // 排队中的片段只缓冲，轮到它时再混音
+            size_t avail = self->_streams[i].ring.available();
+            if (avail == 0)
+                continue;
+            available[i] = avail < blockFrames ? avail : blockFrames;
+            if (!primaryPlaying && available[i] > n)
+                n = available[i];
+            if (activeCount == 0 || self->_streams[i].priority > topPriority)
+                topPriority = self->_streams[i].priority;
+            activeCount++;
+        }
+
+        // 欠载时主流由补偿音频顶替，和其他流一样参与混音
+        size_t concealed = 0;
+        if (!primaryPlaying && (underrun || self->_concealer.isConcealing()))
+        {
+            size_t want = sizeof(concealBlock) / sizeof(int16_t);
+            if (want > blockFrames)
+                want = blockFrames;
+            if (n > 0 && n < want)
+                want = n;
+            concealed = self->_concealer.conceal(concealBlock, want);
+            if (concealed > 0)
+            {
+                if (activeCount == 0 || primary.priority > topPriority)
+                    topPriority = primary.priority;
+                if (n == 0)
+                    n = concealed;
+            }
+        }
+
+        // 当前片段在本块中播完时，下一段从同一位置接上
+        self->handoffSegment(n, available, offsets);
+
+        if (n == 0)
+        {
+            if (primaryAvail > 0)
+            {
+                self->_state = PlaybackState::Buffering;
+            }
+            else if (self->_state != PlaybackState::Idle)
+            {
+                self->_state = PlaybackState::Draining;  // 没有数据了，DMA 播完即为 Idle
+            }
+            self->_activeStreams = 0;
+            self->dispatchEndMarkers();   // DMA 播完时触发回调，误差不超过一次等待
+            ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(10));
+            continue;
+        }
+
+        // 3. 按优先级压低，32 位累加后统一饱和
+        memset(mixBuffer, 0, n * channels * sizeof(int32_t));
+        // 音量(含静音)在本块内从上次的增益过渡到目标增益
+        int32_t masterFrom = self->_masterQ15;
+        int32_t masterTo = self->_muted ? 0 : self->_volumeQ15;
+        self->_masterQ15 = masterTo;
+        float duckStep = self->_duckRampMs == 0 ? 1.0f
+                                                : (float)n * 1000.0f / ((float)self->_duckRampMs * self->_sampleRate);
+        // flush 之后的淡入和压低一样并进每个流的增益
+        float fadeFrom = self->_fadeGain;
+        float fadeTo = fadeFrom + (float)n * 1000.0f / ((float)Megaphone_FLUSH_FADE_MS * self->_sampleRate);
+        if (fadeTo > 1.0f)
+            fadeTo = 1.0f;
+        self->_fadeGain = fadeTo;
+        for (int i = 0; i < Megaphone_MAX_STREAMS; i++)
+        {
+            Stream &s = self->_streams[i];
+            bool isPrimary = (i == Megaphone_PRIMARY_STREAM);
+            if (isPrimary ? (!primaryPlaying && concealed == 0) : available[i] == 0)
+                continue;
+
+            float target = s.priority < topPriority ? self->_duckGain : 1.0f;
+            float from = s.duck;
+            float to = from < target ? (from + duckStep > target ? target : from + duckStep)
+                                     : (from - duckStep < target ? target : from - duckStep);
+            s.duck = to;
+            int32_t gainFrom = AudioProcessor::mulQ15(AudioProcessor::gainToQ15(s.gain * from * fadeFrom), masterFrom);
+            int32_t gainTo = AudioProcessor::mulQ15(AudioProcessor::gainToQ15(s.gain * to * fadeTo), masterTo);
+            uint8_t routing = self->effectiveRouting(s.routing);
+
+            if (isPrimary && !primaryPlaying)
             {
+                for (uint8_t c = 0; (routing >> c) != 0; c++)
                 {
-                    if (!chunk.data || chunk.size == 0)
-                    {
-                        if (chunk.data)
-                            free(chunk.data);
-                        continue;
-                    }
-
-                    // 处理(音量/效果等)
-                    // self->processAudioBuffer(chunk.data, chunk.size);
-
-                    // 写I2S(阻塞)
-                    size_t bytesWritten = 0;
-                    // 应用增益
-                    AudioProcessor::applyGain(chunk.data, chunk.size, self->_ampGain);
-                    self->playPCM(chunk.data, chunk.size);
-
-                    free(chunk.data);
-
-                    // 如果是最后一块，则触发回调(如果已设置)
-                    if (chunk.isLast && self->_callback)
-                    {
-                        self->_isPlaying = false;
-
-                        self->_callback(self->_callbackContext);
-                    }
+                    if (routing & (1u << c))
+                        AudioProcessor::mixAccumulate(mixBuffer + c * n, concealBlock, concealed, gainFrom, gainTo);
                 }
             }
+            else if (s.segment != 0)
+            {
+                self->mixSegment(s, mixBuffer, offsets[i], available[i] < n - offsets[i] ? available[i] : n - offsets[i],
+                                 gainFrom, gainTo, routing, n);
+            }
+            else
+            {
+                self->mixStream(s, mixBuffer, isPrimary ? n : (available[i] < n ? available[i] : n),
+                                gainFrom, gainTo, isPrimary, routing, n);
+            }
         }
+        // 饱和与交错在同一次遍历中完成，直接得到 DMA 的帧格式；流水线时直接写进块环
+        uint32_t seq = self->_dspMixed.load(std::memory_order_relaxed);
+        DspBlock *block = pipelined ? &self->_dspBlocks[seq % Megaphone_DSP_BLOCKS] : nullptr;
+        int16_t *out = block ? block->pcm : outBlock;
+        AudioProcessor::saturateInterleave(mixBuffer, n, channels, out, n);
+
+        self->_activeStreams = activeCount;
+        self->_state = activeCount > 0 ? PlaybackState::Playing : PlaybackState::Buffering;
+        if (block)
+        {
+            // 交给效果任务，处理好后在下一轮开头写出
+            block->samples = n * channels;
+            block->channels = channels;
+            self->_pipelineFrames += n;
+            self->_dspMixed.store(seq + 1, std::memory_order_release);
+            xTaskNotifyGive(self->_dspTaskHandle);
+        }
+        else
+        {
+            // 没有流水线时效果在这里处理，会占用写入任务的时间
+            if (self->hasEffects())
+                self->processEffects(outBlock, n, channels);
+            self->playPCM(outBlock, n * channels);
+        }
+
+        // 记录越过结束标记的流，之前的标记播完则触发回调
+        self->dispatchEndMarkers();
     }
+
+    // 收到 Quit: 栈和任务控制块属于本对象，由析构函数删除任务，这里只挂起
+    vTaskSuspend(NULL);
 }
@@ -24,9 +24,24 @@ MicRecorder::MicRecorder(i2s_port_t i2sNum,
       _dataInPin(dataInPin),
       _isRecording(false),
       _gain(1.0f),
-      _voiceThreshold(50.0f)
+      _voiceThreshold(50.0f),
+      _adaptiveThreshold(true),
+      _i2sEventQueue(nullptr),
+      _captureTaskHandle(nullptr),
+      _captureDone(nullptr),
+      _defaultConsumer(-1),
+      _captureCallback(nullptr),
+      _captureContext(nullptr),
+      _currentRms(0.0f),
+      _peakLevel(0.0f),
+      _voiceActive(false),
+      _peakHoldUntilMs(0),
+      _vadHangover(0),
+      _lastBlockUs(0),
+      _statsLock(portMUX_INITIALIZER_UNLOCKED)
 {
     // 构造函数中可进行一些自定义操作
+    memset(&_stats, 0, sizeof(_stats));
 }
 
 bool MicRecorder::begin() {
@@ -34,7 +49,12 @@ bool MicRecorder::begin() {
 }
 
 MicRecorder::~MicRecorder() {
+    stopRecording();
     i2s_driver_uninstall(_i2s_num);
+    if (_captureDone) {
+        vSemaphoreDelete(_captureDone);
+        _captureDone = nullptr;
+    }
 }
 
 bool MicRecorder::initI2S() {   
@@ -61,8 +81,8 @@ bool MicRecorder::initI2S() {
         .data_in_num = _dataInPin
     };
 
-    // 安装 I2S 驱动
-    esp_err_t err = i2s_driver_install(_i2s_num, &i2s_config, 0, NULL);
+    // 安装 I2S 驱动，同时创建事件队列用于统计 DMA 溢出
+    esp_err_t err = i2s_driver_install(_i2s_num, &i2s_config, MicRecorder_EVENT_QUEUE_LEN, &_i2sEventQueue);
     if (err != ESP_OK) {
         Serial.println("MicRecorder: Failed to install I2S driver");
         return false;
@@ -82,13 +102,44 @@ bool MicRecorder::initI2S() {
 
 bool MicRecorder::startRecording() {
     if (_isRecording) return false;
+
+    if (!_ring.begin(MicRecorder_RING_SAMPLES)) {
+        Serial.println("MicRecorder: Failed to allocate capture ring");
+        return false;
+    }
+    if (_defaultConsumer < 0) {
+        _defaultConsumer = _ring.openConsumer();
+    }
+    if (!_captureDone) {
+        _captureDone = xSemaphoreCreateBinary();
+        if (!_captureDone) {
+            Serial.println("MicRecorder: Failed to create capture semaphore");
+            return false;
+        }
+    }
+
     _isRecording = true;
+    _lastBlockUs = 0;
+    if (xTaskCreatePinnedToCore(captureTask, "micCaptureTask", 4096, this, 6, &_captureTaskHandle, 0) != pdPASS) {
+        Serial.println("MicRecorder: Failed to create capture task");
+        _isRecording = false;
+        _captureTaskHandle = nullptr;
+        return false;
+    }
+    Serial.println("MicRecorder: Capture task started.");
     return true;
 }
 
 bool MicRecorder::stopRecording() {
     if (!_isRecording) return false;
     _isRecording = false;
+
+    // 等待采集任务读完当前块后自行退出(DMA 一直在跑，最多一个块的时间)，
+    // 之后才能卸载驱动或释放环形缓冲区
+    if (_captureTaskHandle) {
+        xSemaphoreTake(_captureDone, portMAX_DELAY);
+    }
+    _ring.stop();   // 唤醒还阻塞在 readPCM() 里的消费者
     return true;
 }
 
@@ -96,21 +147,204 @@ bool MicRecorder::isRecording() const {
     return _isRecording;
 }
 
+int MicRecorder::openConsumer() {
+    return _ring.openConsumer();
+}
+
+void MicRecorder::closeConsumer(int id) {
+    if (id == _defaultConsumer) return;
+    _ring.closeConsumer(id);
+}
+
+size_t MicRecorder::readConsumer(int id, int16_t* buffer, size_t maxSamples, TickType_t timeout) {
+    return _ring.read(id, buffer, maxSamples, timeout);
+}
+
+void MicRecorder::flushPCM() {
+    _ring.skipToLatest(_defaultConsumer);
+}
+
+void MicRecorder::setCaptureCallback(CaptureCallback callback, void* context) {
+    _captureContext = context;
+    _captureCallback = callback;
+}
+
 size_t MicRecorder::readPCM(int16_t* buffer, size_t maxSamples) {
     if (!buffer || maxSamples == 0) return 0;
 
+    // 后台采集运行时从环形缓冲区读取，避免和采集任务抢 DMA 数据
+    if (_isRecording && _defaultConsumer >= 0) {
+        return _ring.read(_defaultConsumer, buffer, maxSamples, portMAX_DELAY);
+    }
+    return readFromI2S(buffer, maxSamples);
+}
+
+size_t MicRecorder::readFromI2S(int16_t* buffer, size_t maxSamples) {
     size_t bytesRead = 0;
     size_t bytesToRead = maxSamples * sizeof(int16_t);
 
-    // 读取数据到 buffer 中
+    // 读取数据到 buffer 中，并记录阻塞时间
+    uint32_t startUs = micros();
     esp_err_t err = i2s_read(_i2s_num, (void*)buffer, bytesToRead, &bytesRead, portMAX_DELAY);
+    uint32_t endUs = micros();
+
+    pollI2SEvents();
+
     if (err != ESP_OK) {
+        portENTER_CRITICAL(&_statsLock);
+        _stats.readErrors++;
+        portEXIT_CRITICAL(&_statsLock);
         Serial.println("MicRecorder: I2S read failed");
         return 0;
     }
 
+    size_t samplesRead = bytesRead / sizeof(int16_t);
+    uint32_t latencyUs = endUs - startUs;
+    // 理论块周期 = 采样数 / 采样率
+    uint32_t periodUs = (uint32_t)((uint64_t)samplesRead * 1000000ULL / _sampleRate);
+
+    portENTER_CRITICAL(&_statsLock);
+    _stats.blocksRead++;
+    _stats.samplesRead += samplesRead;
+    if (samplesRead < maxSamples) _stats.shortReads++;
+    _stats.readLatencySumUs += latencyUs;
+    if (latencyUs > _stats.readLatencyMaxUs) _stats.readLatencyMaxUs = latencyUs;
+    _stats.readLatencyHist[histBucket(latencyUs)]++;
+    if (_lastBlockUs != 0) {
+        uint32_t intervalUs = endUs - _lastBlockUs;
+        uint32_t jitterUs = intervalUs > periodUs ? intervalUs - periodUs : periodUs - intervalUs;
+        if (jitterUs > _stats.jitterMaxUs) _stats.jitterMaxUs = jitterUs;
+        _stats.jitterHist[histBucket(jitterUs)]++;
+    }
+    _lastBlockUs = endUs;
+    portEXIT_CRITICAL(&_statsLock);
+
+    updateMetrics(buffer, samplesRead);
+
     // 返回读取到的采样数量
-    return bytesRead / sizeof(int16_t);
+    return samplesRead;
+}
+
+void MicRecorder::updateMetrics(const int16_t* buffer, size_t sampleCount) {
+    if (sampleCount == 0) return;
+
+    float rms = AudioProcessor::calculateRMS(buffer, sampleCount);
+    float peak = AudioProcessor::calculatePeak(buffer, sampleCount);
+    bool voice = AudioProcessor::detectVoiceActivity(buffer, sampleCount, getVoiceThreshold());
+    _calibrator.update(rms);
+
+    // 峰值保持：新峰值立即生效，保持一段时间后再逐块衰减
+    uint32_t now = millis();
+    if (peak >= _peakLevel) {
+        _peakLevel = peak;
+        _peakHoldUntilMs = now + MicRecorder_PEAK_HOLD_MS;
+    } else if ((int32_t)(now - _peakHoldUntilMs) >= 0) {
+        float decayed = _peakLevel * MicRecorder_PEAK_DECAY;
+        _peakLevel = decayed > peak ? decayed : peak;
+    }
+
+    // VAD 拖尾：语音结束后保持几块，避免字间停顿被判成静音
+    if (voice) {
+        _vadHangover = MicRecorder_VAD_HANGOVER_BLOCKS;
+    } else if (_vadHangover > 0) {
+        _vadHangover--;
+    }
+
+    _currentRms = rms;
+    _voiceActive = voice || _vadHangover > 0;
+}
+
+void MicRecorder::pollI2SEvents() {
+    if (!_i2sEventQueue) return;
+
+    i2s_event_t event;
+    while (xQueueReceive(_i2sEventQueue, &event, 0) == pdTRUE) {
+        portENTER_CRITICAL(&_statsLock);
+        if (event.type == I2S_EVENT_RX_Q_OVF) {
+            _stats.dmaOverflows++;
+        } else if (event.type == I2S_EVENT_DMA_ERROR) {
+            _stats.dmaErrors++;
+        }
+        portEXIT_CRITICAL(&_statsLock);
+    }
+}
+
+int MicRecorder::histBucket(uint32_t us) {
+    // 以 0.5ms 为起点按 2 倍递增
+    int bucket = 0;
+    uint32_t edge = 500;
+    while (bucket < MicRecorder_HIST_BUCKETS - 1 && us >= edge) {
+        edge <<= 1;
+        bucket++;
+    }
+    return bucket;
+}
+
+void MicRecorder::captureTask(void* parameter) {
+    MicRecorder* self = static_cast<MicRecorder*>(parameter);
+    int16_t block[MicRecorder_CAPTURE_BLOCK_SAMPLES];
+
+    while (self->_isRecording) {
+        size_t samplesRead = self->readFromI2S(block, MicRecorder_CAPTURE_BLOCK_SAMPLES);
+        if (samplesRead > 0) {
+            self->_ring.write(block, samplesRead);
+            CaptureCallback callback = self->_captureCallback;
+            if (callback) {
+                callback(block, samplesRead, self->_captureContext);
+            }
+        }
+    }
+
+    self->_captureTaskHandle = nullptr;
+    xSemaphoreGive(self->_captureDone);
+    vTaskDelete(NULL);
+}
+
+// ------------------- 采集健康统计 -------------------
+MicRecorderStats MicRecorder::getStats() const {
+    MicRecorderStats snapshot;
+    portENTER_CRITICAL(&_statsLock);
+    snapshot = _stats;
+    portEXIT_CRITICAL(&_statsLock);
+    for (int i = 0; i < CaptureRing_MAX_CONSUMERS; i++) {
+        snapshot.consumerOverruns[i] = _ring.getOverruns(i);
+    }
+    return snapshot;
+}
+
+void MicRecorder::resetStats() {
+    portENTER_CRITICAL(&_statsLock);
+    memset(&_stats, 0, sizeof(_stats));
+    _lastBlockUs = 0;
+    portEXIT_CRITICAL(&_statsLock);
+    _ring.resetOverruns();
+}
+
+void MicRecorder::printStats() const {
+    MicRecorderStats s = getStats();
+    static const char* labels[MicRecorder_HIST_BUCKETS] = {
+        "<0.5ms", "<1ms", "<2ms", "<4ms", "<8ms", "<16ms", "<32ms", ">=32ms"
+    };
+
+    Serial.printf("MicRecorder: blocks=%u samples=%u dmaOverflow=%u dmaError=%u readError=%u shortRead=%u\n",
+                  s.blocksRead, s.samplesRead, s.dmaOverflows, s.dmaErrors, s.readErrors, s.shortReads);
+    Serial.printf("MicRecorder: latency avg=%uus max=%uus, jitter max=%uus\n",
+                  s.blocksRead ? (uint32_t)(s.readLatencySumUs / s.blocksRead) : 0,
+                  s.readLatencyMaxUs, s.jitterMaxUs);
+    for (int i = 0; i < MicRecorder_HIST_BUCKETS; i++) {
+        Serial.printf("  %-7s latency=%-8u jitter=%u\n", labels[i], s.readLatencyHist[i], s.jitterHist[i]);
+    }
+    for (int i = 0; i < CaptureRing_MAX_CONSUMERS; i++) {
+        if (s.consumerOverruns[i]) {
+            Serial.printf("MicRecorder: consumer %d overruns=%u\n", i, s.consumerOverruns[i]);
+        }
+    }
+
+    // DMA 总缓冲时长需要覆盖最长的调度抖动，否则就会出现 dmaOverflow
+    uint32_t dmaDepthUs = (uint32_t)((uint64_t)_dmaBufCount * _dmaBufLen * 1000000ULL / _sampleRate);
+    Serial.printf("MicRecorder: DMA %d x %d = %uus buffered, worst jitter %uus -> %s\n",
+                  _dmaBufCount, _dmaBufLen, dmaDepthUs, s.jitterMaxUs,
+                  (s.dmaOverflows || s.jitterMaxUs * 2 > dmaDepthUs) ? "increase DMA_BUF_COUNT" : "OK");
 }
 
 size_t MicRecorder::readPCMProcessed(int16_t* buffer, size_t maxSamples, bool autoGain) {
@@ -118,7 +352,13 @@ size_t MicRecorder::readPCMProcessed(int16_t* buffer, size_t maxSamples, bool au
     if (samplesRead > 0) {
         processAudioBuffer(buffer, samplesRead);
         if (autoGain) {
-            applyGain(buffer, samplesRead, _gain);
+            // 自适应模式下按噪声基底限制增益，放大后的底噪不超过 NoiseFloor_AGC_NOISE_CEIL
+            float gain = _gain;
+            if (_adaptiveThreshold) {
+                float maxGain = _calibrator.getAgcMaxGain();
+                if (gain > maxGain) gain = maxGain;
+            }
+            applyGain(buffer, samplesRead, gain);
         }
     }
     return samplesRead;
@@ -131,22 +371,23 @@ void MicRecorder::processAudioBuffer(int16_t* buffer, size_t sampleCount) {
     }
     
     // 添加降噪处理，很基本的降噪处理：低通滤波 + 噪声门限（低于阈值的部分置为0）
-    AudioProcessor::applyNoiseGate(buffer, sampleCount, _voiceThreshold);
+    float gateThreshold = _adaptiveThreshold ? _calibrator.getNoiseGateThreshold() : _voiceThreshold;
+    AudioProcessor::applyNoiseGate(buffer, sampleCount, gateThreshold);
     
     // 添加低通滤波
     AudioProcessor::applyLowPassFilter(buffer, sampleCount, 8000.0f, _sampleRate);
 }
 
-float MicRecorder::getCurrentVolume() {
-    int16_t buffer[256];
-    size_t samplesRead = readPCM(buffer, 256);  //read 256 samples
-    return AudioProcessor::calculateRMS(buffer, samplesRead);
+float MicRecorder::getCurrentVolume() const {
+    return _currentRms;
 }
 
-bool MicRecorder::isVoiceDetected() {
-    int16_t buffer[256];
-    size_t samplesRead = readPCM(buffer, 256);
-    return AudioProcessor::detectVoiceActivity(buffer, samplesRead, _voiceThreshold);
+float MicRecorder::getPeakLevel() const {
+    return _peakLevel;
+}
+
+bool MicRecorder::isVoiceDetected() const {
+    return _voiceActive;
 }
 
 // ------------------- 设置参数函数 -------------------
@@ -172,5 +413,49 @@ void MicRecorder::setGain(float gain) {
 }
 void MicRecorder::setVoiceDetectionThreshold(float threshold) {
     _voiceThreshold = threshold;
+    _adaptiveThreshold = false;
+}
+
+// ------------------- 噪声基底自适应 -------------------
+bool MicRecorder::calibrateNoiseFloor(uint32_t durationMs) {
+    if (!_isRecording) {
+        Serial.println("MicRecorder: Call startRecording() before calibrating");
+        return false;
+    }
+
+    int consumer = _ring.openConsumer();
+    if (consumer < 0) return false;
+
+    int16_t block[MicRecorder_CAPTURE_BLOCK_SAMPLES];
+    float blockRms[NoiseFloor_CALIB_MAX_BLOCKS];
+    size_t blocks = 0;
+    size_t wanted = (size_t)((uint64_t)durationMs * _sampleRate / 1000 / MicRecorder_CAPTURE_BLOCK_SAMPLES);
+    if (wanted == 0) wanted = 1;
+    if (wanted > NoiseFloor_CALIB_MAX_BLOCKS) wanted = NoiseFloor_CALIB_MAX_BLOCKS;
+
+    while (blocks < wanted) {
+        size_t n = _ring.read(consumer, block, MicRecorder_CAPTURE_BLOCK_SAMPLES, pdMS_TO_TICKS(200));
+        if (n == 0) break;
+        blockRms[blocks++] = AudioProcessor::calculateRMS(block, n);
+    }
+    _ring.closeConsumer(consumer);
+
+    if (blocks == 0) {
+        Serial.println("MicRecorder: Noise floor calibration got no audio");
+        return false;
+    }
+    _calibrator.calibrate(blockRms, blocks);
+    Serial.printf("MicRecorder: Noise floor %.1f (VAD %.1f, EOS %.1f)\n",
+                  _calibrator.getNoiseFloor(), _calibrator.getVadThreshold(),
+                  _calibrator.getEndOfSpeechThreshold());
+    return true;
+}
+
+void MicRecorder::setAdaptiveThreshold(bool enable) {
+    _adaptiveThreshold = enable;
+}
+
+float MicRecorder::getVoiceThreshold() const {
+    return _adaptiveThreshold ? _calibrator.getVadThreshold() : _voiceThreshold;
 }
 
@@ -0,0 +1,61 @@
+#include "MicRecorder/NoiseFloorCalibrator.hpp"
+
+// ====================== 实现部分 ======================
+
+NoiseFloorCalibrator::NoiseFloorCalibrator()
+    : _floor(NoiseFloor_DEFAULT_FLOOR),
+      _tracking(true),
+      _calibrated(false)
+{
+}
+
+void NoiseFloorCalibrator::reset(float initialFloor) {
+    _floor = clampFloor(initialFloor);
+    _calibrated = false;
+}
+
+void NoiseFloorCalibrator::calibrate(const float* blockRms, size_t count) {
+    if (!blockRms || count == 0) return;
+    if (count > NoiseFloor_CALIB_MAX_BLOCKS) count = NoiseFloor_CALIB_MAX_BLOCKS;
+
+    // 插入排序后取 25% 分位数
+    float sorted[NoiseFloor_CALIB_MAX_BLOCKS];
+    for (size_t i = 0; i < count; i++) {
+        float v = blockRms[i];
+        size_t j = i;
+        while (j > 0 && sorted[j - 1] > v) {
+            sorted[j] = sorted[j - 1];
+            j--;
+        }
+        sorted[j] = v;
+    }
+    _floor = clampFloor(sorted[count / 4]);
+    _calibrated = true;
+}
+
+void NoiseFloorCalibrator::update(float blockRms) {
+    if (!_tracking) return;
+
+    float floor = _floor;
+    if (blockRms < floor) {
+        floor += (blockRms - floor) * NoiseFloor_FALL_RATE;
+    } else if (blockRms < floor * NoiseFloor_VAD_RATIO) {
+        floor += (blockRms - floor) * NoiseFloor_RISE_RATE;
+    } else {
+        floor *= NoiseFloor_LOUD_RISE;
+    }
+    _floor = clampFloor(floor);
+}
+
+float NoiseFloorCalibrator::getAgcMaxGain() const {
+    float gain = NoiseFloor_AGC_NOISE_CEIL / _floor;
+    if (gain < 1.0f) gain = 1.0f;
+    if (gain > NoiseFloor_AGC_MAX_GAIN) gain = NoiseFloor_AGC_MAX_GAIN;
+    return gain;
+}
+
+float NoiseFloorCalibrator::clampFloor(float floor) {
+    if (floor < NoiseFloor_MIN_FLOOR) return NoiseFloor_MIN_FLOOR;
+    if (floor > NoiseFloor_MAX_FLOOR) return NoiseFloor_MAX_FLOOR;
+    return floor;
+}
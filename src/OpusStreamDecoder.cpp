@@ -0,0 +1,373 @@
+#include "Megaphone/OpusStreamDecoder.hpp"
+#include "AudioMemory/AudioMemory.hpp"
+#include <esp_timer.h>
+
+// ====================== 实现部分 ======================
+
+OpusStreamDecoder::OpusStreamDecoder(Megaphone &megaphone)
+    : _megaphone(megaphone),
+      _sampleRate(0),
+      _decoder(nullptr),
+      _packets(nullptr),
+      _pcm(nullptr),
+      _maxFrameSamples(0),
+      _lastFrameSamples(0),
+      _jobQueue(nullptr),
+      _freeSlots(nullptr),
+      _doneSem(nullptr),
+      _taskHandle(nullptr),
+      _expectedSeq(-1),
+      _lastStream(-1),
+      _abort(false),
+      _framesDecoded(0),
+      _plcFrames(0),
+      _decodeErrors(0),
+      _packetsDropped(0),
+      _framesDropped(0),
+      _decodeUsLast(0),
+      _decodeUsMax(0),
+      _decodeUsAvg(0.0f)
+{
+}
+
+OpusStreamDecoder::~OpusStreamDecoder()
+{
+    end();
+}
+
+bool OpusStreamDecoder::begin(uint32_t sampleRate)
+{
+    if (_taskHandle)
+        return true;
+
+    _sampleRate = sampleRate;
+    _maxFrameSamples = sampleRate * OpusStream_MAX_FRAME_MS / 1000;
+    _lastFrameSamples = sampleRate * OpusStream_DEFAULT_FRAME_MS / 1000;
+
+    // 解码器状态和 PCM 缓冲每帧都要访问，放内部 RAM；包缓冲放 PSRAM
+    _decoder = (OpusDecoder *)AudioMemory::alloc(opus_decoder_get_size(1), AudioPool::Internal);
+    _pcm = (int16_t *)AudioMemory::alloc(_maxFrameSamples * sizeof(int16_t), AudioPool::Internal);
+    _packets = (uint8_t *)AudioMemory::alloc(OpusStream_PACKET_SLOTS * OpusStream_MAX_PACKET_BYTES, AudioPool::Psram);
+    _jobQueue = xQueueCreate(OpusStream_PACKET_SLOTS + 4, sizeof(Job));
+    _freeSlots = xQueueCreate(OpusStream_PACKET_SLOTS, sizeof(int8_t));
+    _doneSem = xSemaphoreCreateBinary();
+    if (!_decoder || !_pcm || !_packets || !_jobQueue || !_freeSlots || !_doneSem)
+    {
+        Serial.println("OpusStreamDecoder: Failed to allocate buffers!");
+        releaseResources();
+        return false;
+    }
+
+    int err = opus_decoder_init(_decoder, sampleRate, 1);
+    if (err != OPUS_OK)
+    {
+        Serial.printf("OpusStreamDecoder: opus_decoder_init failed (%d)\n", err);
+        releaseResources();
+        return false;
+    }
+    for (int8_t i = 0; i < OpusStream_PACKET_SLOTS; i++)
+    {
+        xQueueSend(_freeSlots, &i, 0);
+    }
+    _expectedSeq = -1;
+    _abort = false;
+
+    if (xTaskCreatePinnedToCore(decoderTask, "opusDecTask", OpusStream_TASK_STACK, this,
+                                OpusStream_TASK_PRIORITY, &_taskHandle, 0) != pdPASS)
+    {
+        Serial.println("OpusStreamDecoder: Failed to create decoder task!");
+        _taskHandle = nullptr;
+        releaseResources();
+        return false;
+    }
+    return true;
+}
+
+void OpusStreamDecoder::end()
+{
+    if (_taskHandle)
+    {
+        _abort = true;   // 解码任务可能正在等主流空间
+        Job quit = {JobKind::Quit, -1, 0, -1, nullptr, nullptr};
+        xQueueSend(_jobQueue, &quit, portMAX_DELAY);
+        xSemaphoreTake(_doneSem, portMAX_DELAY);
+        _taskHandle = nullptr;
+    }
+    releaseResources();
+}
+
+void OpusStreamDecoder::releaseResources()
+{
+    if (_decoder)
+    {
+        AudioMemory::free(_decoder);
+        _decoder = nullptr;
+    }
+    if (_pcm)
+    {
+        AudioMemory::free(_pcm);
+        _pcm = nullptr;
+    }
+    if (_packets)
+    {
+        AudioMemory::free(_packets);
+        _packets = nullptr;
+    }
+    if (_jobQueue)
+    {
+        vQueueDelete(_jobQueue);
+        _jobQueue = nullptr;
+    }
+    if (_freeSlots)
+    {
+        vQueueDelete(_freeSlots);
+        _freeSlots = nullptr;
+    }
+    if (_doneSem)
+    {
+        vSemaphoreDelete(_doneSem);
+        _doneSem = nullptr;
+    }
+}
+
+// ------------ 生产者 ------------
+bool OpusStreamDecoder::sendJob(JobKind kind, uint16_t len, Megaphone::PlaybackCallback onDone, void *context)
+{
+    if (!_taskHandle)
+        return false;
+    Job job = {kind, -1, len, _megaphone.primaryStream(), onDone, context};
+    return xQueueSend(_jobQueue, &job, 0) == pdTRUE;
+}
+
+bool OpusStreamDecoder::pushPacket(const uint8_t *data, size_t len, int32_t seq)
+{
+    if (!_taskHandle || !data || len == 0)
+        return false;
+    if (len > OpusStream_MAX_PACKET_BYTES)
+    {
+        _packetsDropped++;
+        return false;
+    }
+
+    // 序号跳跃说明中间的包丢了，先排入 PLC 帧
+    if (seq >= 0)
+    {
+        if (_expectedSeq >= 0 && seq > _expectedSeq)
+        {
+            pushLost((uint32_t)(seq - _expectedSeq));
+        }
+        else if (_expectedSeq >= 0 && seq < _expectedSeq)
+        {
+            _packetsDropped++;   // 迟到的包，对应的帧已经用 PLC 补过了
+            return false;
+        }
+        _expectedSeq = seq + 1;
+    }
+
+    int8_t slot;
+    if (xQueueReceive(_freeSlots, &slot, 0) != pdTRUE)
+    {
+        _packetsDropped++;
+        return false;
+    }
+    memcpy(_packets + slot * OpusStream_MAX_PACKET_BYTES, data, len);
+    Job job = {JobKind::Packet, slot, (uint16_t)len, _megaphone.primaryStream(), nullptr, nullptr};
+    if (xQueueSend(_jobQueue, &job, 0) != pdTRUE)
+    {
+        xQueueSend(_freeSlots, &slot, 0);
+        _packetsDropped++;
+        return false;
+    }
+    return true;
+}
+
+bool OpusStreamDecoder::pushLost(uint32_t frames)
+{
+    if (frames == 0)
+        return true;
+    if (frames > OpusStream_MAX_PLC_FRAMES)
+        frames = OpusStream_MAX_PLC_FRAMES;
+    return sendJob(JobKind::Lost, (uint16_t)frames);
+}
+
+bool OpusStreamDecoder::endOfStream(Megaphone::PlaybackCallback onDone, void *context)
+{
+    _expectedSeq = -1;
+    return sendJob(JobKind::End, 0, onDone, context);
+}
+
+void OpusStreamDecoder::reset()
+{
+    if (!_taskHandle)
+        return;
+
+    // 取出还没解码的包并归还缓冲，再让解码任务清除解码器状态；
+    // 正在等主流空间的那一帧也不再需要
+    _abort = true;
+    Job job;
+    while (xQueueReceive(_jobQueue, &job, 0) == pdTRUE)
+    {
+        if (job.kind == JobKind::Packet)
+        {
+            xQueueSend(_freeSlots, &job.slot, 0);
+        }
+        else if (job.kind == JobKind::Quit)
+        {
+            xQueueSendToFront(_jobQueue, &job, 0);
+            return;
+        }
+    }
+    _expectedSeq = -1;
+    sendJob(JobKind::Reset, 0);
+}
+
+// ------------ 统计 ------------
+OpusDecoderStats OpusStreamDecoder::getStats() const
+{
+    OpusDecoderStats s;
+    s.framesDecoded = _framesDecoded;
+    s.plcFrames = _plcFrames;
+    s.decodeErrors = _decodeErrors;
+    s.packetsDropped = _packetsDropped;
+    s.framesDropped = _framesDropped;
+    s.decodeUsLast = _decodeUsLast;
+    s.decodeUsAvg = (uint32_t)_decodeUsAvg;
+    s.decodeUsMax = _decodeUsMax;
+    s.frameUs = _sampleRate ? (uint32_t)((uint64_t)_lastFrameSamples * 1000000ULL / _sampleRate) : 0;
+    s.cpuLoadPct = s.frameUs ? s.decodeUsAvg * 100 / s.frameUs : 0;
+    return s;
+}
+
+void OpusStreamDecoder::resetStats()
+{
+    _framesDecoded = 0;
+    _plcFrames = 0;
+    _decodeErrors = 0;
+    _packetsDropped = 0;
+    _framesDropped = 0;
+    _decodeUsLast = 0;
+    _decodeUsMax = 0;
+    _decodeUsAvg = 0.0f;
+}
+
+void OpusStreamDecoder::printStats() const
+{
+    OpusDecoderStats s = getStats();
+    Serial.printf("OpusStreamDecoder: frames=%u plc=%u errors=%u dropped=%u packets / %u frames\n",
+                  s.framesDecoded, s.plcFrames, s.decodeErrors, s.packetsDropped, s.framesDropped);
+    Serial.printf("OpusStreamDecoder: decode last=%uus avg=%uus max=%uus per %uus frame (cpu %u%%)\n",
+                  s.decodeUsLast, s.decodeUsAvg, s.decodeUsMax, s.frameUs, s.cpuLoadPct);
+}
+
+// ------------ 解码 ------------
+void OpusStreamDecoder::decodeFrame(const uint8_t *data, size_t len, int stream)
+{
+    // flush() 之后推送时的句柄已失效，这一帧属于被丢弃的回复，不用解码
+    if (!_megaphone.isStreamValid(stream))
+    {
+        _framesDropped++;
+        return;
+    }
+    // 新会话的第一帧不能接着上一个回复的解码状态
+    if (stream != _lastStream)
+    {
+        opus_decoder_ctl(_decoder, OPUS_RESET_STATE);
+        _lastStream = stream;
+    }
+
+    // data 为空时是 PLC: 按上一帧的长度外推
+    int frameSize = data ? (int)_maxFrameSamples : _lastFrameSamples;
+    int64_t start = esp_timer_get_time();
+    int samples = opus_decode(_decoder, data, (opus_int32)len, _pcm, frameSize, 0);
+    uint32_t elapsed = (uint32_t)(esp_timer_get_time() - start);
+
+    if (samples < 0)
+    {
+        _decodeErrors++;
+        Serial.printf("OpusStreamDecoder: decode error %d\n", samples);
+        return;
+    }
+
+    _decodeUsLast = elapsed;
+    if (elapsed > _decodeUsMax)
+        _decodeUsMax = elapsed;
+    _decodeUsAvg = (_framesDecoded + _plcFrames == 0) ? elapsed : _decodeUsAvg * 0.95f + elapsed * 0.05f;
+    if (data)
+    {
+        _framesDecoded++;
+        _lastFrameSamples = samples;
+    }
+    else
+    {
+        _plcFrames++;
+    }
+    outputPCM((size_t)samples, stream);
+}
+
+void OpusStreamDecoder::outputPCM(size_t samples, int stream)
+{
+    // 按推送时的句柄写入，flush() 之后旧句柄写不进去，不会混进新会话。
+    // 等播放任务腾出空间再写，避免被算成溢出；播放暂停或停止时空间不会再增加，
+    // 超时、句柄失效或被 reset()/end() 打断就丢掉这一帧剩下的部分
+    TickType_t start = xTaskGetTickCount();
+    size_t written = 0;
+    while (written < samples)
+    {
+        if (_abort || !_megaphone.isStreamValid(stream) ||
+            xTaskGetTickCount() - start >= pdMS_TO_TICKS(OpusStream_OUTPUT_TIMEOUT_MS))
+        {
+            _framesDropped++;
+            return;
+        }
+        if (_megaphone.getStreamFree(stream) < samples - written)
+        {
+            vTaskDelay(pdMS_TO_TICKS(5));
+            continue;
+        }
+        written += _megaphone.writeStream(stream, _pcm + written, samples - written);
+    }
+}
+
+// ------------ 后台任务 ------------
+void OpusStreamDecoder::decoderTask(void *parameter)
+{
+    OpusStreamDecoder *self = static_cast<OpusStreamDecoder *>(parameter);
+    Job job;
+
+    while (xQueueReceive(self->_jobQueue, &job, portMAX_DELAY) == pdTRUE)
+    {
+        if (job.kind == JobKind::Quit)
+            break;
+
+        switch (job.kind)
+        {
+        case JobKind::Packet:
+            self->decodeFrame(self->_packets + job.slot * OpusStream_MAX_PACKET_BYTES, job.len, job.stream);
+            xQueueSend(self->_freeSlots, &job.slot, 0);
+            break;
+        case JobKind::Lost:
+            for (uint16_t i = 0; i < job.len; i++)
+            {
+                self->decodeFrame(nullptr, 0, job.stream);
+            }
+            break;
+        case JobKind::End:
+            // 推送时的会话已被 flush() 丢弃就不再关闭，也不通知，不能结束新的会话
+            if (self->_megaphone.isStreamValid(job.stream) &&
+                !self->_megaphone.closeStream(job.stream, job.onDone, job.context) && job.onDone)
+            {
+                job.onDone(job.context);   // 结束标记已满，直接通知，避免调用者一直等
+            }
+            break;
+        case JobKind::Reset:
+            opus_decoder_ctl(self->_decoder, OPUS_RESET_STATE);
+            self->_abort = false;   // 之前的帧都已丢弃，之后推送的包正常输出
+            break;
+        default:
+            break;
+        }
+    }
+
+    xSemaphoreGive(self->_doneSem);
+    vTaskDelete(NULL);
+}
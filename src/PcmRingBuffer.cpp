@@ -0,0 +1,184 @@
+#include "Megaphone/PcmRingBuffer.hpp"
+
+// ====================== 实现部分 ======================
+
+PcmRingBuffer::PcmRingBuffer()
+    : _buffer(nullptr),
+      _size(0),
+      _mask(0),
+      _limit(0),
+      _head(0),
+      _tail(0),
+      _external(nullptr),
+      _externalBase(0)
+{
+}
+
+PcmRingBuffer::~PcmRingBuffer()
+{
+    end();
+}
+
+bool PcmRingBuffer::begin(size_t capacitySamples, AudioPool pool)
+{
+    if (_buffer)
+        return true;
+    if (capacitySamples == 0)
+        return false;
+
+    size_t size = 1;
+    while (size < capacitySamples)
+        size <<= 1;
+
+    _buffer = (int16_t *)AudioMemory::calloc(size * sizeof(int16_t), pool);
+    if (!_buffer)
+    {
+        Serial.println("PcmRingBuffer: Malloc failed!");
+        return false;
+    }
+    _size = size;
+    _mask = size - 1;
+    _limit = capacitySamples;
+    _head.store(0);
+    _tail.store(0);
+    return true;
+}
+
+void PcmRingBuffer::end()
+{
+    if (_buffer)
+    {
+        AudioMemory::free(_buffer);
+        _buffer = nullptr;
+    }
+    _size = 0;
+    _mask = 0;
+    _limit = 0;
+}
+
+size_t PcmRingBuffer::available() const
+{
+    return _head.load(std::memory_order_acquire) - _tail.load(std::memory_order_acquire);
+}
+
+size_t PcmRingBuffer::freeSpace() const
+{
+    if (_external)
+        return 0;
+    size_t used = available();
+    return used >= _limit ? 0 : _limit - used;
+}
+
+// ------------ 生产者 ------------
+size_t PcmRingBuffer::reserve(int16_t **ptr, size_t wanted)
+{
+    if (!_buffer || !ptr || _external)
+        return 0;
+
+    uint32_t head = _head.load(std::memory_order_relaxed);
+    size_t n = freeSpace();
+    if (n > wanted)
+        n = wanted;
+    size_t offset = head & _mask;
+    if (n > _size - offset)
+        n = _size - offset;
+
+    *ptr = _buffer + offset;
+    return n;
+}
+
+void PcmRingBuffer::commit(size_t count)
+{
+    _head.store(_head.load(std::memory_order_relaxed) + count, std::memory_order_release);
+}
+
+size_t PcmRingBuffer::write(const int16_t *data, size_t count)
+{
+    if (!data)
+        return 0;
+
+    size_t total = 0;
+    while (total < count)
+    {
+        int16_t *dst;
+        size_t n = reserve(&dst, count - total);
+        if (n == 0)
+            break;
+        memcpy(dst, data + total, n * sizeof(int16_t));
+        commit(n);
+        total += n;
+    }
+    return total;
+}
+
+bool PcmRingBuffer::attach(const int16_t *data, size_t count)
+{
+    if (!data || count == 0 || _external || available() > 0)
+        return false;
+
+    // 先写指针再发布写入位置，消费者看到新位置时一定能看到外部数据
+    uint32_t head = _head.load(std::memory_order_relaxed);
+    _externalBase = head;
+    _external = data;
+    _head.store(head + count, std::memory_order_release);
+    return true;
+}
+
+void PcmRingBuffer::detach()
+{
+    if (available() == 0)
+        _external = nullptr;
+}
+
+// ------------ 消费者 ------------
+size_t PcmRingBuffer::peek(int16_t **ptr, size_t wanted)
+{
+    if (!_buffer || !ptr)
+        return 0;
+
+    uint32_t tail = _tail.load(std::memory_order_relaxed);
+    size_t n = available();
+    if (n > wanted)
+        n = wanted;
+    if (_external)
+    {
+        // 外部数据是线性的，没有回绕；只读，调用者不能原地修改
+        *ptr = const_cast<int16_t *>(_external) + (tail - _externalBase);
+        return n;
+    }
+    size_t offset = tail & _mask;
+    if (n > _size - offset)
+        n = _size - offset;
+
+    *ptr = _buffer + offset;
+    return n;
+}
+
+void PcmRingBuffer::consume(size_t count)
+{
+    _tail.store(_tail.load(std::memory_order_relaxed) + count, std::memory_order_release);
+}
+
+size_t PcmRingBuffer::read(int16_t *out, size_t count)
+{
+    if (!out)
+        return 0;
+
+    size_t total = 0;
+    while (total < count)
+    {
+        int16_t *src;
+        size_t n = peek(&src, count - total);
+        if (n == 0)
+            break;
+        memcpy(out + total, src, n * sizeof(int16_t));
+        consume(n);
+        total += n;
+    }
+    return total;
+}
+
+void PcmRingBuffer::discard()
+{
+    _tail.store(_head.load(std::memory_order_acquire), std::memory_order_release);
+}
@@ -0,0 +1,308 @@
+#include "Megaphone/PromptCache.hpp"
+#include "Megaphone/FileSource.hpp"
+#include "Megaphone/Resampler.hpp"
+
+// ====================== 实现部分 ======================
+
+PromptCache::PromptCache(Megaphone &megaphone, fs::FS &fs)
+    : _megaphone(megaphone),
+      _fs(fs),
+      _count(0),
+      _budget(PromptCache_DEFAULT_BUDGET),
+      _usedBytes(0),
+      _clock(0),
+      _lock(nullptr),
+      _hits(0),
+      _misses(0),
+      _evictions(0)
+{
+}
+
+PromptCache::~PromptCache()
+{
+    end();
+    if (_lock)
+    {
+        vSemaphoreDelete(_lock);
+        _lock = nullptr;
+    }
+}
+
+bool PromptCache::begin(const PromptSpec *manifest, size_t count, size_t budgetBytes)
+{
+    if (!_lock)
+    {
+        _lock = xSemaphoreCreateMutex();
+        if (!_lock)
+        {
+            Serial.println("PromptCache: Failed to create lock!");
+            return false;
+        }
+    }
+    end();
+    if (!manifest)
+        count = 0;
+    if (count > PromptCache_MAX_CLIPS)
+    {
+        Serial.printf("PromptCache: Manifest has %u clips, only %u kept\n", (unsigned)count, PromptCache_MAX_CLIPS);
+        count = PromptCache_MAX_CLIPS;
+    }
+
+    xSemaphoreTake(_lock, portMAX_DELAY);
+    _budget = budgetBytes;
+    _count = count;
+    for (size_t i = 0; i < count; i++)
+    {
+        Entry &e = _entries[i];
+        e.id = manifest[i].id;
+        e.pinned = manifest[i].pinned;
+        strncpy(e.path, manifest[i].path ? manifest[i].path : "", PromptCache_MAX_PATH - 1);
+        e.path[PromptCache_MAX_PATH - 1] = '\0';
+        e.pcm = nullptr;
+        e.samples = 0;
+        e.bytes = 0;
+        e.sampleRate = 0;
+        e.lastUsed = 0;
+    }
+
+    // 常驻片段优先，其他片段只在预算有剩余时预加载，不淘汰
+    bool ok = true;
+    for (size_t i = 0; i < _count; i++)
+    {
+        if (_entries[i].pinned && !load(_entries[i], false))
+            ok = false;
+    }
+    for (size_t i = 0; i < _count; i++)
+    {
+        if (!_entries[i].pinned)
+            load(_entries[i], false);
+    }
+    xSemaphoreGive(_lock);
+
+    Serial.printf("PromptCache: %u clips, %u bytes in PSRAM\n", (unsigned)getStats().loadedClips, (unsigned)_usedBytes);
+    return ok;
+}
+
+void PromptCache::end()
+{
+    for (size_t i = 0; i < _count; i++)
+    {
+        if (_entries[i].pcm)
+        {
+            AudioMemory::free(_entries[i].pcm);
+            _entries[i].pcm = nullptr;
+        }
+    }
+    _count = 0;
+    _usedBytes = 0;
+}
+
+// ------------ 播放 ------------
+int PromptCache::play(uint16_t id, uint8_t priority, float gain, Megaphone::PlaybackCallback onDone, void *context)
+{
+    if (!_lock)
+        return -1;
+
+    xSemaphoreTake(_lock, portMAX_DELAY);
+    Entry *e = find(id);
+    if (!e)
+    {
+        xSemaphoreGive(_lock);
+        Serial.printf("PromptCache: Unknown clip %u\n", id);
+        return -1;
+    }
+
+    // 输出采样率变了，没有在播放的话按新采样率重新加载
+    if (e->pcm && e->sampleRate != _megaphone.getSampleRate() && !_megaphone.isBufferInUse(e->pcm))
+    {
+        evict(*e);
+    }
+    if (e->pcm)
+    {
+        _hits++;
+    }
+    else
+    {
+        _misses++;
+        if (!load(*e, true))
+        {
+            xSemaphoreGive(_lock);
+            return -1;
+        }
+    }
+    e->lastUsed = ++_clock;
+    int stream = _megaphone.playBuffer(e->pcm, e->samples, priority, gain, onDone, context);
+    xSemaphoreGive(_lock);
+    return stream;
+}
+
+bool PromptCache::preload(uint16_t id)
+{
+    if (!_lock)
+        return false;
+
+    xSemaphoreTake(_lock, portMAX_DELAY);
+    Entry *e = find(id);
+    bool ok = e && (e->pcm || load(*e, true));
+    if (ok)
+    {
+        e->lastUsed = ++_clock;
+    }
+    xSemaphoreGive(_lock);
+    return ok;
+}
+
+bool PromptCache::isLoaded(uint16_t id) const
+{
+    for (size_t i = 0; i < _count; i++)
+    {
+        if (_entries[i].id == id)
+            return _entries[i].pcm != nullptr;
+    }
+    return false;
+}
+
+PromptCache::Entry *PromptCache::find(uint16_t id)
+{
+    for (size_t i = 0; i < _count; i++)
+    {
+        if (_entries[i].id == id)
+            return &_entries[i];
+    }
+    return nullptr;
+}
+
+// ------------ 加载 & 淘汰 ------------
+bool PromptCache::load(Entry &e, bool allowEvict)
+{
+    File file = _fs.open(e.path, "r");
+    if (!file)
+    {
+        Serial.printf("PromptCache: Failed to open %s\n", e.path);
+        return false;
+    }
+
+    WavInfo info;
+    if (!FileSource::readWavInfo(file, info))
+    {
+        // 不是 WAV，按输出格式的裸 PCM 处理
+        file.seek(0);
+        info.sampleRate = _megaphone.getSampleRate();
+        info.channels = 1;
+        info.bitsPerSample = 16;
+        info.dataOffset = 0;
+        info.dataBytes = file.size();
+    }
+    if (info.bitsPerSample != 16)
+    {
+        Serial.printf("PromptCache: %s is not 16-bit PCM, skipped\n", e.path);
+        file.close();
+        return false;
+    }
+
+    // 加载时一次转换成输出格式，播放时不再做任何处理
+    uint32_t outRate = _megaphone.getSampleRate();
+    Resampler resampler;
+    if (!resampler.configure(info.sampleRate, outRate, (uint8_t)info.channels))
+    {
+        file.close();
+        return false;
+    }
+    size_t frames = info.dataBytes / sizeof(int16_t) / info.channels;
+    size_t samples = resampler.outputFor(frames);
+    size_t bytes = samples * sizeof(int16_t);
+    if (samples == 0 || (allowEvict ? !makeRoom(bytes) : _usedBytes + bytes > _budget))
+    {
+        if (allowEvict || e.pinned)
+            Serial.printf("PromptCache: No room for %s (%u bytes)\n", e.path, (unsigned)bytes);
+        file.close();
+        return false;
+    }
+    int16_t *pcm = (int16_t *)AudioMemory::alloc(bytes, AudioPool::Psram);
+    if (!pcm)
+    {
+        Serial.println("PromptCache: Malloc failed!");
+        file.close();
+        return false;
+    }
+
+    int16_t chunk[PromptCache_READ_SAMPLES];
+    size_t chunkFrames = PromptCache_READ_SAMPLES / info.channels;
+    size_t written = 0;
+    while (frames > 0)
+    {
+        size_t want = frames < chunkFrames ? frames : chunkFrames;
+        size_t got = file.read((uint8_t *)chunk, want * info.channels * sizeof(int16_t)) / sizeof(int16_t) / info.channels;
+        if (got == 0)
+            break;
+        size_t used = 0;
+        written += resampler.process(chunk, got, pcm + written, samples - written, used);
+        frames -= got;
+    }
+    file.close();
+
+    e.pcm = pcm;
+    e.samples = written;
+    e.bytes = bytes;
+    e.sampleRate = outRate;
+    e.lastUsed = ++_clock;
+    _usedBytes += bytes;
+    return true;
+}
+
+bool PromptCache::makeRoom(size_t bytes)
+{
+    while (_usedBytes + bytes > _budget)
+    {
+        // 最近最少使用、非常驻、不在播放
+        Entry *victim = nullptr;
+        for (size_t i = 0; i < _count; i++)
+        {
+            Entry &e = _entries[i];
+            if (!e.pcm || e.pinned || _megaphone.isBufferInUse(e.pcm))
+                continue;
+            if (!victim || e.lastUsed < victim->lastUsed)
+                victim = &e;
+        }
+        if (!victim)
+            return false;
+        evict(*victim);
+        _evictions++;
+    }
+    return true;
+}
+
+void PromptCache::evict(Entry &e)
+{
+    if (!e.pcm)
+        return;
+    _usedBytes -= e.bytes;
+    AudioMemory::free(e.pcm);
+    e.pcm = nullptr;
+    e.samples = 0;
+    e.bytes = 0;
+}
+
+// ------------ 统计 ------------
+PromptCacheStats PromptCache::getStats() const
+{
+    PromptCacheStats s;
+    s.hits = _hits;
+    s.misses = _misses;
+    s.evictions = _evictions;
+    s.loadedClips = 0;
+    for (size_t i = 0; i < _count; i++)
+    {
+        if (_entries[i].pcm)
+            s.loadedClips++;
+    }
+    s.usedBytes = _usedBytes;
+    return s;
+}
+
+void PromptCache::printStats() const
+{
+    PromptCacheStats s = getStats();
+    Serial.printf("PromptCache: clips=%u used=%u/%u bytes hits=%u misses=%u evictions=%u\n",
+                  s.loadedClips, (unsigned)s.usedBytes, (unsigned)_budget, s.hits, s.misses, s.evictions);
+}
@@ -0,0 +1,227 @@
+#include "Megaphone/Resampler.hpp"
+
+// ====================== 实现部分 ======================
+
+static uint32_t gcd(uint32_t a, uint32_t b)
+{
+    while (b)
+    {
+        uint32_t t = a % b;
+        a = b;
+        b = t;
+    }
+    return a;
+}
+
+Resampler::Resampler()
+    : _inRate(0),
+      _outRate(0),
+      _channels(1),
+      _L(1),
+      _M(1),
+      _taps(Resampler_TAPS),
+      _coeffs(nullptr),
+      _phase(0),
+      _need(1),
+      _histPos(0)
+{
+    memset(_hist, 0, sizeof(_hist));
+}
+
+Resampler::~Resampler()
+{
+    releaseCoeffs();
+}
+
+bool Resampler::configure(uint32_t inRate, uint32_t outRate, uint8_t channels)
+{
+    if (inRate == 0 || outRate == 0 || channels == 0 || channels > Resampler_MAX_CHANNELS)
+    {
+        Serial.println("Resampler: Unsupported format");
+        return false;
+    }
+    uint32_t g = gcd(inRate, outRate);
+    uint32_t L = outRate / g;
+    uint32_t M = inRate / g;
+    if (L > Resampler_MAX_PHASES)
+    {
+        Serial.printf("Resampler: %u -> %u Hz needs %u phases, max %u\n", inRate, outRate, L, Resampler_MAX_PHASES);
+        return false;
+    }
+    // 抽取时截止频率按 M 缩小，原型滤波器要按同样的倍数加长，过渡带才不会变宽；
+    // 过渡带还要落在输出奈奎斯特频率以内，每倍用更多的抽头
+    uint32_t taps = M > L ? Resampler_DECIMATE_TAPS * ((M + L - 1) / L) : Resampler_TAPS;
+    if (taps > Resampler_MAX_TAPS)
+    {
+        Serial.printf("Resampler: %u -> %u Hz needs %u taps, max %u\n", inRate, outRate, taps, Resampler_MAX_TAPS);
+        return false;
+    }
+
+    bool sameRatio = (L == _L && M == _M && _coeffs);
+    _inRate = inRate;
+    _outRate = outRate;
+    _channels = channels;
+    _L = L;
+    _M = M;
+    _taps = taps;
+    if (!sameRatio)
+    {
+        releaseCoeffs();
+        if ((L != 1 || M != 1) && !buildCoeffs())
+        {
+            _L = _M = 1;
+            Serial.println("Resampler: Malloc failed!");
+            return false;
+        }
+    }
+    reset();
+    return true;
+}
+
+void Resampler::reset()
+{
+    _phase = 0;
+    _need = 1;
+    _histPos = 0;
+    memset(_hist, 0, sizeof(_hist));
+}
+
+void Resampler::releaseCoeffs()
+{
+    if (_coeffs)
+    {
+        AudioMemory::free(_coeffs);
+        _coeffs = nullptr;
+    }
+}
+
+bool Resampler::buildCoeffs()
+{
+    // 原型滤波器工作在 L 倍输入采样率上，长度 L * _taps，截止在两边较低的奈奎斯特频率附近
+    const size_t N = _L * _taps;
+    size_t bytes = N * sizeof(int16_t);
+    _coeffs = (int16_t *)AudioMemory::alloc(bytes, bytes <= Resampler_INTERNAL_TABLE_BYTES ? AudioPool::Internal
+                                                                                        : AudioPool::Psram);
+    if (!_coeffs)
+        return false;
+
+    float fc = Resampler_CUTOFF * 0.5f / (float)(_L > _M ? _L : _M);
+    float center = (float)(N - 1) / 2.0f;
+    float taps[Resampler_MAX_TAPS];
+    for (uint32_t p = 0; p < _L; p++)
+    {
+        // 每个相位单独归一化，直流增益为 1，相位之间没有纹波
+        float sum = 0.0f;
+        for (size_t k = 0; k < _taps; k++)
+        {
+            size_t n = k * _L + p;
+            float x = (float)n - center;
+            float sinc = x == 0.0f ? 1.0f : sinf(2.0f * PI * fc * x) / (PI * x * 2.0f * fc);
+            float w = 0.42f - 0.5f * cosf(2.0f * PI * n / (N - 1)) + 0.08f * cosf(4.0f * PI * n / (N - 1));
+            taps[k] = sinc * w;
+            sum += taps[k];
+        }
+        for (size_t k = 0; k < _taps; k++)
+        {
+            float c = sum != 0.0f ? taps[k] / sum : 0.0f;
+            int32_t q = (int32_t)lrintf(c * 32768.0f);
+            _coeffs[p * _taps + k] = (int16_t)(q > 32767 ? 32767 : (q < -32768 ? -32768 : q));
+        }
+    }
+    return true;
+}
+
+// ------------ 长度换算 ------------
+size_t Resampler::outputFor(size_t inFrames) const
+{
+    if (inFrames < _need)
+        return 0;
+    // 第一个输出消耗 _need 帧；之后产生 k 个输出共消耗 floor((phase + k*M) / L) 帧
+    uint64_t a = inFrames - _need;
+    return 1 + (size_t)(((a + 1) * _L - _phase - 1) / _M);
+}
+
+size_t Resampler::inputFor(size_t maxOut) const
+{
+    uint64_t frames = (uint64_t)_need + ((uint64_t)maxOut * _M + _phase) / _L;
+    if (maxOut == 0)
+        frames = _need;
+    return frames > 0 ? (size_t)(frames - 1) : 0;
+}
+
+// ------------ 处理 ------------
+int16_t Resampler::downmix(const int16_t *frame) const
+{
+    if (_channels == 1)
+        return frame[0];
+    int32_t sum = 0;
+    for (uint8_t c = 0; c < _channels; c++)
+        sum += frame[c];
+    return (int16_t)(sum / _channels);
+}
+
+void Resampler::push(int16_t sample)
+{
+    _histPos = _histPos == 0 ? _taps - 1 : _histPos - 1;
+    _hist[_histPos] = sample;
+    _hist[_histPos + _taps] = sample;
+}
+
+int16_t Resampler::filter() const
+{
+    // _hist[_histPos + k] 是倒数第 k 个输入
+    const int16_t *c = _coeffs + _phase * _taps;
+    const int16_t *x = _hist + _histPos;
+    int32_t acc = 1 << 14;
+    for (size_t k = 0; k < _taps; k += 4)
+    {
+        acc += (int32_t)c[k] * x[k] + (int32_t)c[k + 1] * x[k + 1] +
+               (int32_t)c[k + 2] * x[k + 2] + (int32_t)c[k + 3] * x[k + 3];
+    }
+    acc >>= 15;
+    return (int16_t)(acc > 32767 ? 32767 : (acc < -32768 ? -32768 : acc));
+}
+
+size_t Resampler::process(const int16_t *in, size_t inFrames, int16_t *out, size_t maxOut, size_t &consumedFrames)
+{
+    consumedFrames = 0;
+    if (!in)
+        return 0;
+
+    // 同采样率: 只下混(或直接拷贝)
+    if (_L == 1 && _M == 1)
+    {
+        size_t n = inFrames < maxOut ? inFrames : maxOut;
+        if (_channels == 1)
+        {
+            memcpy(out, in, n * sizeof(int16_t));
+        }
+        else
+        {
+            for (size_t i = 0; i < n; i++)
+                out[i] = downmix(in + i * _channels);
+        }
+        consumedFrames = n;
+        return n;
+    }
+
+    size_t produced = 0;
+    size_t used = 0;
+    while (true)
+    {
+        while (_need > 0 && used < inFrames)
+        {
+            push(downmix(in + used * _channels));
+            used++;
+            _need--;
+        }
+        if (_need > 0 || produced == maxOut)
+            break;
+        out[produced++] = filter();
+        _phase += _M;
+        _need = _phase / _L;
+        _phase %= _L;
+    }
+    consumedFrames = used;
+    return produced;
+}
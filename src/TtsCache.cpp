@@ -0,0 +1,535 @@
+#include "llm/TtsCache.hpp"
+#include "Megaphone/Resampler.hpp"
+#include <rom/crc.h>
+#include <stddef.h>
+
+// ====================== 实现部分 ======================
+
+TtsCache::TtsCache(Megaphone &megaphone, fs::FS &fs)
+    : _megaphone(megaphone),
+      _fs(fs),
+      _budget(TtsCache_DEFAULT_BUDGET),
+      _count(0),
+      _usedBytes(0),
+      _clock(0),
+      _lock(nullptr),
+      _writerTaskHandle(nullptr),
+      _staging(nullptr),
+      _stagingBytes(0),
+      _recordKey(0),
+      _recordRate(0),
+      _recordCrc(0),
+      _recordState(RecordState::Idle),
+      _playPcm(nullptr),
+      _playSamples(0),
+      _playKey(0),
+      _lookups(0),
+      _hits(0),
+      _misses(0),
+      _corrupt(0),
+      _evictions(0),
+      _stored(0),
+      _skipped(0),
+      _bytesSaved(0)
+{
+    _dir[0] = '\0';
+}
+
+TtsCache::~TtsCache()
+{
+    end();
+}
+
+bool TtsCache::begin(size_t budgetBytes, const char *dir)
+{
+    if (_writerTaskHandle)
+        return true;
+
+    strncpy(_dir, dir ? dir : "", TtsCache_MAX_DIR - 1);
+    _dir[TtsCache_MAX_DIR - 1] = '\0';
+    _budget = budgetBytes;
+
+    _staging = (uint8_t *)AudioMemory::alloc(TtsCache_MAX_ENTRY_BYTES, AudioPool::Psram);
+    _lock = xSemaphoreCreateMutex();
+    if (!_staging || !_lock)
+    {
+        Serial.println("TtsCache: Failed to allocate buffers!");
+        end();
+        return false;
+    }
+
+    _fs.mkdir(_dir);
+    scan();
+
+    if (xTaskCreatePinnedToCore(writerTask, "ttsCacheTask", 4096, this,
+                                TtsCache_TASK_PRIORITY, &_writerTaskHandle, 0) != pdPASS)
+    {
+        Serial.println("TtsCache: Failed to create writer task!");
+        _writerTaskHandle = nullptr;
+        end();
+        return false;
+    }
+
+    Serial.printf("TtsCache: %u entries, %u/%u bytes\n", (unsigned)_count, (unsigned)_usedBytes, (unsigned)_budget);
+    return true;
+}
+
+void TtsCache::end()
+{
+    if (_writerTaskHandle)
+    {
+        // 等正在进行的写入结束
+        while (_recordState == RecordState::Writing)
+        {
+            vTaskDelay(pdMS_TO_TICKS(10));
+        }
+        vTaskDelete(_writerTaskHandle);
+        _writerTaskHandle = nullptr;
+    }
+    _recordState = RecordState::Idle;
+    if (_staging)
+    {
+        AudioMemory::free(_staging);
+        _staging = nullptr;
+    }
+    if (_playPcm)
+    {
+        AudioMemory::free(_playPcm);
+        _playPcm = nullptr;
+    }
+    if (_lock)
+    {
+        vSemaphoreDelete(_lock);
+        _lock = nullptr;
+    }
+    _count = 0;
+    _usedBytes = 0;
+}
+
+uint64_t TtsCache::makeKey(const String &text, const String &voice)
+{
+    uint64_t hash = 14695981039346656037ULL;
+    const String *parts[2] = {&voice, &text};
+    for (int p = 0; p < 2; p++)
+    {
+        const char *s = parts[p]->c_str();
+        for (size_t i = 0; i < parts[p]->length(); i++)
+        {
+            hash ^= (uint8_t)s[i];
+            hash *= 1099511628211ULL;
+        }
+        // 分隔符，避免 ("ab", "c") 和 ("a", "bc") 相同
+        hash ^= 0xFF;
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
+
+void TtsCache::makePath(uint64_t key, char *path, size_t size) const
+{
+    snprintf(path, size, "%s/%08x%08x.pcm", _dir, (unsigned)(key >> 32), (unsigned)(key & 0xFFFFFFFF));
+}
+
+// ------------ 索引 ------------
+void TtsCache::scan()
+{
+    _count = 0;
+    _usedBytes = 0;
+    _clock = 0;
+
+    File dir = _fs.open(_dir);
+    if (!dir || !dir.isDirectory())
+        return;
+
+    // 先记下要删除的文件，遍历目录时不删除
+    char stale[TtsCache_MAX_ENTRIES][40];
+    size_t staleCount = 0;
+    File f = dir.openNextFile();
+    while (f)
+    {
+        FileHeader header;
+        char expected[40];
+        bool valid = f.read((uint8_t *)&header, sizeof(header)) == sizeof(header) &&
+                     header.magic == TtsCache_MAGIC && header.version == TtsCache_VERSION &&
+                     header.headerBytes == sizeof(FileHeader) &&
+                     f.size() == sizeof(FileHeader) + header.dataBytes;
+        if (valid)
+        {
+            makePath(header.key, expected, sizeof(expected));
+            valid = strcmp(expected, f.path()) == 0;
+        }
+        if (valid)
+        {
+            valid = checkData(f, header);
+        }
+        if (valid && _count < TtsCache_MAX_ENTRIES)
+        {
+            Entry &e = _entries[_count++];
+            e.key = header.key;
+            e.bytes = f.size();
+            e.lastUsed = header.lastUsed;
+            _usedBytes += e.bytes;
+            if (header.lastUsed > _clock)
+                _clock = header.lastUsed;
+        }
+        else if (staleCount < TtsCache_MAX_ENTRIES)
+        {
+            strncpy(stale[staleCount], f.path(), sizeof(stale[0]) - 1);
+            stale[staleCount][sizeof(stale[0]) - 1] = '\0';
+            staleCount++;
+        }
+        f.close();
+        f = dir.openNextFile();
+    }
+    dir.close();
+
+    for (size_t i = 0; i < staleCount; i++)
+    {
+        Serial.printf("TtsCache: Removing invalid %s\n", stale[i]);
+        _fs.remove(stale[i]);
+        _corrupt++;
+    }
+}
+
+bool TtsCache::checkData(File &file, const FileHeader &header)
+{
+    // 按写入块大小分段读进录制缓冲计算 CRC，启动时还没有录制在进行
+    uint32_t crc = 0;
+    size_t left = header.dataBytes;
+    while (left > 0)
+    {
+        size_t n = left < TtsCache_WRITE_CHUNK ? left : TtsCache_WRITE_CHUNK;
+        if (file.read(_staging, n) != n)
+            return false;
+        crc = crc32_le(crc, _staging, n);
+        left -= n;
+    }
+    return crc == header.crc;
+}
+
+TtsCache::Entry *TtsCache::find(uint64_t key)
+{
+    for (size_t i = 0; i < _count; i++)
+    {
+        if (_entries[i].key == key)
+            return &_entries[i];
+    }
+    return nullptr;
+}
+
+bool TtsCache::contains(uint64_t key) const
+{
+    for (size_t i = 0; i < _count; i++)
+    {
+        if (_entries[i].key == key)
+            return true;
+    }
+    return false;
+}
+
+void TtsCache::removeEntry(Entry *e)
+{
+    char path[40];
+    makePath(e->key, path, sizeof(path));
+    _fs.remove(path);
+    _usedBytes -= e->bytes;
+    *e = _entries[--_count];
+}
+
+// ------------ 命中播放 ------------
+int TtsCache::play(uint64_t key, uint8_t priority, Megaphone::PlaybackCallback onDone, void *context)
+{
+    if (!_lock)
+        return -1;
+
+    xSemaphoreTake(_lock, portMAX_DELAY);
+    _lookups++;
+    Entry *e = find(key);
+    int stream = -1;
+    if (e)
+    {
+        bool ready = _playPcm && _playKey == key;
+        if (!ready && !(_playPcm && _megaphone.isBufferInUse(_playPcm)))
+        {
+            ready = loadEntry(*e);
+            if (!ready)
+            {
+                // 校验失败: 删掉，这次走网络，回复会被重新缓存
+                removeEntry(e);
+                _corrupt++;
+                e = nullptr;
+            }
+        }
+        if (ready && _playKey == key && !_megaphone.isBufferInUse(_playPcm))
+        {
+            stream = _megaphone.playBuffer(_playPcm, _playSamples, priority, 1.0f, onDone, context);
+        }
+    }
+
+    if (stream >= 0)
+    {
+        _hits++;
+        _bytesSaved += e->bytes - sizeof(FileHeader);
+        e->lastUsed = ++_clock;
+        touch(*e);
+    }
+    else
+    {
+        _misses++;
+    }
+    xSemaphoreGive(_lock);
+    return stream;
+}
+
+bool TtsCache::loadEntry(const Entry &e)
+{
+    char path[40];
+    makePath(e.key, path, sizeof(path));
+    File file = _fs.open(path, "r");
+    if (!file)
+        return false;
+
+    FileHeader header;
+    if (file.read((uint8_t *)&header, sizeof(header)) != sizeof(header) ||
+        header.magic != TtsCache_MAGIC || header.key != e.key ||
+        sizeof(FileHeader) + header.dataBytes != e.bytes || header.dataBytes == 0)
+    {
+        file.close();
+        return false;
+    }
+
+    if (_playPcm)
+    {
+        AudioMemory::free(_playPcm);
+        _playPcm = nullptr;
+    }
+    int16_t *raw = (int16_t *)AudioMemory::alloc(header.dataBytes, AudioPool::Psram);
+    if (!raw)
+    {
+        Serial.println("TtsCache: Malloc failed!");
+        file.close();
+        return false;
+    }
+    bool ok = file.read((uint8_t *)raw, header.dataBytes) == header.dataBytes &&
+              crc32_le(0, (const uint8_t *)raw, header.dataBytes) == header.crc;
+    file.close();
+    if (!ok)
+    {
+        Serial.printf("TtsCache: CRC mismatch in %s\n", path);
+        AudioMemory::free(raw);
+        return false;
+    }
+
+    // 播放时零拷贝，需要提前转换成输出格式
+    size_t samples = header.dataBytes / sizeof(int16_t);
+    uint32_t outRate = _megaphone.getSampleRate();
+    if (header.sampleRate != outRate)
+    {
+        Resampler resampler;
+        int16_t *pcm = nullptr;
+        size_t outSamples = 0;
+        if (resampler.configure(header.sampleRate, outRate, 1))
+        {
+            outSamples = resampler.outputFor(samples);
+            pcm = (int16_t *)AudioMemory::alloc(outSamples * sizeof(int16_t), AudioPool::Psram);
+        }
+        if (!pcm)
+        {
+            AudioMemory::free(raw);
+            return false;
+        }
+        size_t used = 0;
+        samples = resampler.process(raw, samples, pcm, outSamples, used);
+        AudioMemory::free(raw);
+        raw = pcm;
+    }
+
+    _playPcm = raw;
+    _playSamples = samples;
+    _playKey = e.key;
+    return true;
+}
+
+void TtsCache::touch(const Entry &e)
+{
+    // 只改写文件头里的时间戳，重启后 LRU 顺序仍然有效
+    char path[40];
+    makePath(e.key, path, sizeof(path));
+    File file = _fs.open(path, "r+");
+    if (!file)
+        return;
+    file.seek(offsetof(FileHeader, lastUsed));
+    file.write((const uint8_t *)&e.lastUsed, sizeof(e.lastUsed));
+    file.close();
+}
+
+// ------------ 录制 ------------
+bool TtsCache::beginRecord(uint64_t key, uint32_t sampleRate)
+{
+    if (!_writerTaskHandle || _recordState == RecordState::Writing)
+    {
+        _skipped++;
+        return false;
+    }
+    _recordKey = key;
+    _recordRate = sampleRate;
+    _recordCrc = 0;
+    _stagingBytes = 0;
+    _recordState = RecordState::Recording;
+    return true;
+}
+
+void TtsCache::record(const int16_t *pcm, size_t samples)
+{
+    if (_recordState != RecordState::Recording || !pcm || samples == 0)
+        return;
+
+    size_t bytes = samples * sizeof(int16_t);
+    if (_stagingBytes + bytes > TtsCache_MAX_ENTRY_BYTES)
+    {
+        _recordState = RecordState::Overflow;
+        return;
+    }
+    memcpy(_staging + _stagingBytes, pcm, bytes);
+    _recordCrc = crc32_le(_recordCrc, (const uint8_t *)pcm, bytes);
+    _stagingBytes += bytes;
+}
+
+void TtsCache::commitRecord()
+{
+    RecordState state = _recordState;
+    if (state == RecordState::Overflow)
+    {
+        _skipped++;
+        _recordState = RecordState::Idle;
+        return;
+    }
+    if (state != RecordState::Recording)
+        return;
+    if (_stagingBytes == 0)
+    {
+        _recordState = RecordState::Idle;
+        return;
+    }
+    _recordState = RecordState::Writing;
+    xTaskNotifyGive(_writerTaskHandle);
+}
+
+void TtsCache::abortRecord()
+{
+    if (_recordState == RecordState::Recording || _recordState == RecordState::Overflow)
+    {
+        _recordState = RecordState::Idle;
+    }
+}
+
+bool TtsCache::store()
+{
+    size_t total = sizeof(FileHeader) + _stagingBytes;
+    if (total > _budget)
+        return false;
+
+    // 1. 腾出空间: 同键的旧条目直接替换，其他按最近最少使用淘汰
+    xSemaphoreTake(_lock, portMAX_DELAY);
+    Entry *old = find(_recordKey);
+    if (old)
+    {
+        removeEntry(old);
+    }
+    while (_count > 0 && (_usedBytes + total > _budget || _count >= TtsCache_MAX_ENTRIES))
+    {
+        Entry *victim = &_entries[0];
+        for (size_t i = 1; i < _count; i++)
+        {
+            if (_entries[i].lastUsed < victim->lastUsed)
+                victim = &_entries[i];
+        }
+        removeEntry(victim);
+        _evictions++;
+    }
+    uint32_t stamp = ++_clock;
+    xSemaphoreGive(_lock);
+
+    // 2. 写文件(不持有锁，命中查询不会被 flash 写入阻塞)
+    char path[40];
+    makePath(_recordKey, path, sizeof(path));
+    File file = _fs.open(path, FILE_WRITE);
+    if (!file)
+    {
+        Serial.println("TtsCache: Failed to open file");
+        return false;
+    }
+    FileHeader header = {TtsCache_MAGIC, TtsCache_VERSION, sizeof(FileHeader), _recordKey,
+                         _recordRate, (uint32_t)_stagingBytes, _recordCrc, stamp};
+    bool ok = file.write((const uint8_t *)&header, sizeof(header)) == sizeof(header);
+    for (size_t offset = 0; ok && offset < _stagingBytes; offset += TtsCache_WRITE_CHUNK)
+    {
+        size_t n = _stagingBytes - offset < TtsCache_WRITE_CHUNK ? _stagingBytes - offset : TtsCache_WRITE_CHUNK;
+        ok = file.write(_staging + offset, n) == n;
+    }
+    file.close();
+    if (!ok)
+    {
+        Serial.println("TtsCache: Flash write failed (disk full?)");
+        _fs.remove(path);
+        return false;
+    }
+
+    // 3. 写完才加入索引，半截文件不会被命中
+    xSemaphoreTake(_lock, portMAX_DELAY);
+    if (_count < TtsCache_MAX_ENTRIES)
+    {
+        Entry &e = _entries[_count++];
+        e.key = _recordKey;
+        e.bytes = total;
+        e.lastUsed = stamp;
+        _usedBytes += total;
+    }
+    xSemaphoreGive(_lock);
+    return true;
+}
+
+// ------------ 后台任务 ------------
+void TtsCache::writerTask(void *parameter)
+{
+    TtsCache *self = static_cast<TtsCache *>(parameter);
+    while (true)
+    {
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+        if (self->_recordState != RecordState::Writing)
+            continue;
+
+        if (self->store())
+            self->_stored++;
+        else
+            self->_skipped++;
+        self->_recordState = RecordState::Idle;
+    }
+}
+
+// ------------ 统计 ------------
+TtsCacheStats TtsCache::getStats() const
+{
+    TtsCacheStats s;
+    s.lookups = _lookups;
+    s.hits = _hits;
+    s.misses = _misses;
+    s.corrupt = _corrupt;
+    s.evictions = _evictions;
+    s.stored = _stored;
+    s.skipped = _skipped;
+    s.entries = _count;
+    s.usedBytes = _usedBytes;
+    s.bytesSaved = _bytesSaved;
+    s.hitRatioPct = _lookups ? (uint8_t)(_hits * 100 / _lookups) : 0;
+    return s;
+}
+
+void TtsCache::printStats() const
+{
+    TtsCacheStats s = getStats();
+    Serial.printf("TtsCache: entries=%u used=%u/%u bytes stored=%u skipped=%u evictions=%u corrupt=%u\n",
+                  s.entries, (unsigned)s.usedBytes, (unsigned)_budget, s.stored, s.skipped, s.evictions, s.corrupt);
+    Serial.printf("TtsCache: lookups=%u hits=%u (%u%%) saved=%u bytes\n",
+                  s.lookups, s.hits, s.hitRatioPct, s.bytesSaved);
+}
@@ -0,0 +1,145 @@
+#include "Megaphone/UnderrunConcealer.hpp"
+
+// ====================== 实现部分 ======================
+
+UnderrunConcealer::UnderrunConcealer()
+    : _sampleRate(16000),
+      _historyLen(0),
+      _historyFill(0),
+      _concealing(false),
+      _period(0),
+      _position(0),
+      _repeatSamples(0),
+      _blockSamples(0),
+      _crossfadeSamples(0),
+      _events(0),
+      _concealedSamples(0)
+{
+}
+
+void UnderrunConcealer::begin(uint32_t sampleRate)
+{
+    if (sampleRate == 0 || sampleRate > Concealer_MAX_SAMPLE_RATE)
+        sampleRate = 16000;
+    _sampleRate = sampleRate;
+    _historyLen = sampleRate * Concealer_HISTORY_MS / 1000;
+    _repeatSamples = sampleRate * Concealer_REPEAT_MS / 1000;
+    _blockSamples = sampleRate * Concealer_BLOCK_MS / 1000;
+    _crossfadeSamples = sampleRate * Concealer_CROSSFADE_MS / 1000;
+    reset();
+}
+
+void UnderrunConcealer::reset()
+{
+    _historyFill = 0;
+    _concealing = false;
+    _position = 0;
+}
+
+void UnderrunConcealer::observe(const int16_t *samples, size_t count)
+{
+    if (!samples || count == 0 || _historyLen == 0)
+        return;
+
+    if (count >= _historyLen)
+    {
+        memcpy(_history, samples + count - _historyLen, _historyLen * sizeof(int16_t));
+        _historyFill = _historyLen;
+        return;
+    }
+
+    // 保留最新的 _historyLen 个采样
+    size_t keep = _historyFill + count > _historyLen ? _historyLen - count : _historyFill;
+    memmove(_history, _history + _historyFill - keep, keep * sizeof(int16_t));
+    memcpy(_history + keep, samples, count * sizeof(int16_t));
+    _historyFill = keep + count;
+}
+
+size_t UnderrunConcealer::estimatePeriod() const
+{
+    // 在历史末尾做归一化自相关，找最像的基音周期
+    size_t minLag = _sampleRate / Concealer_MAX_PITCH_HZ;
+    size_t maxLag = _sampleRate / Concealer_MIN_PITCH_HZ;
+    if (maxLag * 2 > _historyFill)
+        maxLag = _historyFill / 2;
+    if (maxLag <= minLag)
+        return _historyFill > 0 ? _historyFill : 1;
+
+    const int16_t *tail = _history + _historyFill - maxLag;
+    size_t bestLag = maxLag;
+    float bestScore = 0.0f;
+    for (size_t lag = minLag; lag <= maxLag; lag++)
+    {
+        const int16_t *prev = tail - lag;
+        int64_t corr = 0, energy = 0;
+        for (size_t i = 0; i < maxLag; i++)
+        {
+            corr += (int32_t)tail[i] * prev[i];
+            energy += (int32_t)prev[i] * prev[i];
+        }
+        if (energy == 0)
+            continue;
+        float score = (float)corr / sqrtf((float)energy);
+        if (score > bestScore)
+        {
+            bestScore = score;
+            bestLag = lag;
+        }
+    }
+    return bestLag;
+}
+
+int16_t UnderrunConcealer::concealSample(size_t position) const
+{
+    if (position >= _repeatSamples || _historyFill == 0)
+        return 0;
+
+    // 重复最后一个基音周期，线性淡出
+    int32_t s = _history[_historyFill - _period + (position % _period)];
+    return (int16_t)(s * (int32_t)(_repeatSamples - position) / (int32_t)_repeatSamples);
+}
+
+size_t UnderrunConcealer::conceal(int16_t *out, size_t maxSamples)
+{
+    if (!out || maxSamples == 0)
+        return 0;
+
+    if (!_concealing)
+    {
+        _concealing = true;
+        _position = 0;
+        _period = estimatePeriod();
+        _events++;
+    }
+    if (_position >= _repeatSamples)
+        return 0;
+
+    size_t n = _blockSamples < maxSamples ? _blockSamples : maxSamples;
+    if (n > _repeatSamples - _position)
+        n = _repeatSamples - _position;
+    for (size_t i = 0; i < n; i++)
+    {
+        out[i] = concealSample(_position + i);
+    }
+    _position += n;
+    _concealedSamples += n;
+    return n;
+}
+
+void UnderrunConcealer::resume(int16_t *samples, size_t count)
+{
+    if (!_concealing)
+        return;
+    _concealing = false;
+    if (!samples || count == 0)
+        return;
+
+    // 从补偿信号(已淡出时为静音)过渡到新数据
+    size_t n = _crossfadeSamples < count ? _crossfadeSamples : count;
+    for (size_t i = 0; i < n; i++)
+    {
+        int32_t from = concealSample(_position + i);
+        int32_t to = samples[i];
+        samples[i] = (int16_t)((from * (int32_t)(n - i) + to * (int32_t)i) / (int32_t)n);
+    }
+}
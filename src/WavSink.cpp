@@ -0,0 +1,285 @@
+#include "Megaphone/WavSink.hpp"
+
+// ====================== 实现部分 ======================
+
+WavSink::WavSink(fs::FS &fs, bool realtime)
+    : _fs(fs),
+      _recorder(fs),
+      _realtime(realtime),
+      _sampleRate(0),
+      _channels(1),
+      _capacity(0),
+      _queued(0),
+      _lastUs(0),
+      _started(false),
+      _startUs(0),
+      _recording(false),
+      _trace(nullptr),
+      _traceCount(0),
+      _lock(nullptr)
+{
+    memset(&_stats, 0, sizeof(_stats));
+}
+
+WavSink::~WavSink()
+{
+    stop();
+    if (_lock)
+    {
+        vSemaphoreDelete(_lock);
+        _lock = nullptr;
+    }
+}
+
+// ------------ AudioSink ------------
+bool WavSink::begin(uint32_t sampleRate, uint8_t channels, size_t bufferFrames)
+{
+    if (!_lock)
+    {
+        _lock = xSemaphoreCreateMutex();
+        if (!_lock)
+        {
+            Serial.println("WavSink: Failed to create lock!");
+            return false;
+        }
+    }
+    _sampleRate = sampleRate;
+    _channels = channels ? channels : 1;
+    _capacity = bufferFrames;
+    _queued = 0;
+    _started = false;
+    _lastUs = micros();
+    Serial.printf("WavSink: %u Hz x %u, buffer %u frames%s\n", sampleRate, _channels, (unsigned)bufferFrames,
+                  _realtime ? "" : " (offline)");
+    return true;
+}
+
+size_t WavSink::advance()
+{
+    // 按采样率推进模拟的播放位置，余下不足一帧的时间留到下次
+    uint32_t now = micros();
+    size_t played = (size_t)((uint64_t)(now - _lastUs) * _sampleRate / 1000000ULL);
+    _lastUs += (uint32_t)((uint64_t)played * 1000000ULL / _sampleRate);
+
+    size_t gap = 0;
+    if (played >= _queued)
+    {
+        // 缓冲播空之后扬声器输出的是静音(tx_desc_auto_clear)
+        gap = _started ? played - _queued : 0;
+        _queued = 0;
+    }
+    else
+    {
+        _queued -= played;
+    }
+    return gap;
+}
+
+size_t WavSink::write(const int16_t *pcm, size_t samples)
+{
+    if (!pcm || samples == 0 || _sampleRate == 0)
+        return 0;
+    size_t frames = samples / _channels;
+
+    size_t gap = 0;
+    if (_realtime)
+    {
+        // 像 i2s_write 一样等缓冲腾出空间
+        gap = advance();
+        while (_queued > 0 && _queued + frames > _capacity)
+        {
+            size_t over = _queued + frames - _capacity;
+            vTaskDelay(pdMS_TO_TICKS(over * 1000 / _sampleRate + 1));
+            gap += advance();
+        }
+    }
+    size_t queued = _queued;
+    if (_realtime)
+    {
+        _queued += frames;
+        _started = true;
+    }
+
+    _stats.writes++;
+    _stats.frames += frames;
+    if (gap > 0)
+    {
+        uint32_t gapMs = (uint32_t)((uint64_t)gap * 1000 / _sampleRate);
+        _stats.gaps++;
+        _stats.gapFrames += gap;
+        if (gapMs > _stats.maxGapMs)
+            _stats.maxGapMs = gapMs;
+    }
+    uint32_t queuedMs = (uint32_t)((uint64_t)queued * 1000 / _sampleRate);
+    if (queuedMs > _stats.maxQueuedMs)
+        _stats.maxQueuedMs = queuedMs;
+
+    if (_recording && xSemaphoreTake(_lock, portMAX_DELAY) == pdTRUE)
+    {
+        if (_recording)
+        {
+            addTrace('W', frames, queued, gap);
+            if (gap > 0)
+                recordSilence(gap);
+            _recorder.push(pcm, frames * _channels);
+        }
+        xSemaphoreGive(_lock);
+    }
+    return frames * _channels;
+}
+
+void WavSink::clear()
+{
+    if (_realtime)
+        advance();
+    size_t queued = _queued;
+    _queued = 0;
+    _started = false;   // flush 之后的静音是有意的，不算断流
+    _stats.clears++;
+    if (_recording && xSemaphoreTake(_lock, portMAX_DELAY) == pdTRUE)
+    {
+        if (_recording)
+            addTrace('C', 0, queued, 0);
+        xSemaphoreGive(_lock);
+    }
+}
+
+void WavSink::setSampleRate(uint32_t sampleRate)
+{
+    if (_realtime)
+        advance();
+    _sampleRate = sampleRate;
+    // WAV 头只有一个采样率，切换只记在 trace 里
+    if (_recording && xSemaphoreTake(_lock, portMAX_DELAY) == pdTRUE)
+    {
+        if (_recording)
+            addTrace('R', sampleRate, _queued, 0);
+        xSemaphoreGive(_lock);
+    }
+}
+
+void WavSink::addTrace(char event, uint32_t frames, uint32_t queued, uint32_t gap)
+{
+    if (!_trace)
+        return;     // start() 没有给 trace 路径，只录 WAV
+    if (_traceCount >= WavSink_TRACE_ENTRIES)
+    {
+        _stats.traceDropped++;
+        return;
+    }
+    TraceEntry &e = _trace[_traceCount++];
+    e.us = micros() - _startUs;
+    e.event = event;
+    e.frames = frames;
+    e.queuedFrames = queued;
+    e.gapFrames = gap;
+}
+
+void WavSink::recordSilence(uint32_t frames)
+{
+    static const int16_t zeros[256] = {0};
+    size_t maxFrames = (size_t)((uint64_t)WavSink_MAX_SILENCE_MS * _sampleRate / 1000);
+    size_t samples = (frames < maxFrames ? frames : maxFrames) * _channels;
+    while (samples > 0)
+    {
+        size_t n = samples < 256 ? samples : 256;
+        _recorder.push(zeros, n);
+        samples -= n;
+    }
+}
+
+// ------------ 录制控制 ------------
+bool WavSink::start(const char *wavPath, const char *tracePath, size_t maxBytes)
+{
+    if (_recording)
+    {
+        Serial.println("WavSink: Already recording!");
+        return false;
+    }
+    if (!_lock || _sampleRate == 0)
+    {
+        Serial.println("WavSink: Call Megaphone::begin() first!");
+        return false;
+    }
+
+    if (tracePath)
+    {
+        _trace = (TraceEntry *)AudioMemory::alloc(WavSink_TRACE_ENTRIES * sizeof(TraceEntry), AudioPool::Psram);
+        if (!_trace)
+        {
+            Serial.println("WavSink: Failed to allocate trace!");
+            return false;
+        }
+        _tracePath = tracePath;
+    }
+    if (!_recorder.start(wavPath, _sampleRate, maxBytes, _channels))
+    {
+        if (_trace)
+        {
+            AudioMemory::free(_trace);
+            _trace = nullptr;
+        }
+        return false;
+    }
+
+    xSemaphoreTake(_lock, portMAX_DELAY);
+    memset(&_stats, 0, sizeof(_stats));
+    _traceCount = 0;
+    _startUs = micros();
+    _recording = true;
+    xSemaphoreGive(_lock);
+    return true;
+}
+
+bool WavSink::stop()
+{
+    if (!_recording)
+        return false;
+
+    xSemaphoreTake(_lock, portMAX_DELAY);
+    _recording = false;
+    xSemaphoreGive(_lock);
+
+    bool ok = _recorder.stop();
+    _stats.wavDropped = _recorder.getDroppedSamples();
+    if (_trace)
+    {
+        ok = writeTrace() && ok;
+        AudioMemory::free(_trace);
+        _trace = nullptr;
+    }
+    printStats();
+    return ok;
+}
+
+bool WavSink::writeTrace()
+{
+    File file = _fs.open(_tracePath.c_str(), FILE_WRITE);
+    if (!file)
+    {
+        Serial.println("WavSink: Failed to open trace file");
+        return false;
+    }
+    char line[64];
+    int len = snprintf(line, sizeof(line), "us,event,frames,queued,gap\n");
+    bool ok = file.write((const uint8_t *)line, len) == (size_t)len;
+    for (size_t i = 0; ok && i < _traceCount; i++)
+    {
+        const TraceEntry &e = _trace[i];
+        len = snprintf(line, sizeof(line), "%u,%c,%u,%u,%u\n",
+                       e.us, e.event, e.frames, e.queuedFrames, e.gapFrames);
+        ok = file.write((const uint8_t *)line, len) == (size_t)len;
+    }
+    file.close();
+    return ok;
+}
+
+// ------------ 统计 ------------
+void WavSink::printStats() const
+{
+    Serial.printf("WavSink: writes=%u clears=%u frames=%llu maxQueued=%ums\n",
+                  _stats.writes, _stats.clears, (unsigned long long)_stats.frames, _stats.maxQueuedMs);
+    Serial.printf("WavSink: gaps=%u (%llu frames, max %ums) traceDropped=%u wavDropped=%u\n",
+                  _stats.gaps, (unsigned long long)_stats.gapFrames, _stats.maxGapMs,
+                  _stats.traceDropped, _stats.wavDropped);
+}
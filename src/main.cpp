@@ -1,10 +1,16 @@
 #include <Arduino.h>
 #include <WiFi.h>
 #include <functional>
+#include <ArduinoJson.h>
 #include "WiFi_Network_Configuration/WiFi_Network_Configuration.hpp"
 #include "STT/XunFeiSttService.hpp"
 #include "MicRecorder/MicRecorder.hpp"
 #include "Megaphone/Megaphone.hpp"
+#include "Megaphone/PromptCache.hpp"
+#include "llm/TtsCache.hpp"
+#ifdef Megaphone_CAPTURE_OUTPUT
+#include "Megaphone/WavSink.hpp"
+#endif
 #include "llm/LLMWebSocketClient.hpp"
 #include "Strip_light/Strip_light.hpp"
 
@@ -16,30 +22,134 @@ XunFeiSttService stt(APP_ID, API_SECRET, API_KEY, "zh_cn");
 WiFi_Network_Configuration webServer("AI-toys", "12345678");
 MicRecorder recorder; // 可以直接传入参数，也可以直接使用默认参数
 Megaphone megaphone;
+PromptCache promptCache(megaphone);
+TtsCache ttsCache(megaphone);
+#ifdef Megaphone_CAPTURE_OUTPUT
+WavSink outputSink; // 不接扬声器，把第一轮回复实际会播出的声音录到 SPIFFS，检查断流和延迟
+#endif
 LLMWebSocketClient llmClient("device_002");
 StripLight stripLight;
 
-unsigned long lastFeedTime = 0; // 记录最后一次接收数据的时间,座位看门狗，停止播放任务
-const unsigned long WATCHDOG_TIMEOUT = 2000; // 看门狗超时时间，单位：毫秒
+unsigned long lastFeedTime = 0; // 记录最后一次接收音频的时间
+const unsigned long RESPONSE_IDLE_TIMEOUT = 2000; // 服务端没有发结束消息时，超过这个时间没有新音频就认为本轮回复结束
+volatile bool ttsActive = false;   // 本轮回复的音频已经开始写入主流
+volatile bool followUpTurn = false; // 回复播完后自动开始下一轮录音
+portMUX_TYPE ttsLock = portMUX_INITIALIZER_UNLOCKED;
 int start_task = 0; // 确保有20个数据包
 int send_exit = 0;  // 发送exit
+const uint32_t TTS_SAMPLE_RATE = 16000;    // 服务端 TTS 的采样率，和播放采样率不同时由 Megaphone 重采样
+const char *TTS_VOICE = "device_002";      // 音色/角色参数，参与回复缓存的键，服务端换音色时要一起改
+const uint32_t FLOW_HIGH_WATER_MS = 1280; // 待播放音频超过这个时长就暂停向服务器拉取(原来的 20 块)
+const unsigned long TTS_WRITE_TIMEOUT_MS = 500; // 播放缓冲一直没有空间时放弃这一包的剩余部分
+const char *LLM_END_MESSAGE = "end";            // 服务端本轮回复结束的文本帧: 纯文本 "end" 或 {"type":"end"}
+int earconStream = -1; // 本地提示音使用的高优先级流
+int ttsStream = -1;    // 当前这轮回复写入的主流句柄，打断后旧句柄失效
+int thinkingStream = -1; // 等待大模型回复时的思考音，首包到达时停止
+
+// 本地提示音，启动时解码进 PSRAM，播放时不读 flash。文件在 data/ 中，随文件系统镜像上传(pio run -t uploadfs)；
+// 缺少文件时"嗯"用生成的短音代替，思考音不播放
+enum PromptId : uint16_t
+{
+    PROMPT_ACK = 1,      // 说完话后的"嗯"
+    PROMPT_THINKING = 2, // 等待回复时的思考音
+};
+const PromptSpec PROMPT_MANIFEST[] = {
+    {PROMPT_ACK, "/prompt_ack.wav", true},
+    {PROMPT_THINKING, "/prompt_thinking.wav", true},
+};
+
+// 说完话立即播放一声提示音，掩盖等待服务器首包的时间；TTS 同时到达时会被自动压低
+void playEarcon()
+{
+    if (promptCache.play(PROMPT_ACK) >= 0)
+        return;
+    // 没有提示音文件时用生成的短音代替
+    const size_t toneSamples = Megaphone_DEFAULT_SAMPLE_RATE / 10; // 100ms
+    static int16_t tone[toneSamples];
+    static bool toneReady = false;
+    if (!megaphone.isStreamValid(earconStream)) // 打断会释放所有副流
+        earconStream = megaphone.openStream(Megaphone_PRIORITY_HIGH);
+    if (earconStream < 0)
+        return;
+    if (!toneReady)
+    {
+        for (size_t i = 0; i < toneSamples; i++)
+        {
+            float env = (float)(toneSamples - i) / toneSamples; // 线性淡出，避免结尾爆音
+            tone[i] = (int16_t)(8000.0f * env * sinf(2.0f * PI * 880.0f * i / Megaphone_DEFAULT_SAMPLE_RATE));
+        }
+        toneReady = true;
+    }
+    megaphone.writeStream(earconStream, tone, toneSamples);
+}
 
 /*******************llmtts************************** */
+// 最后一个采样离开 DMA 时由播放任务调用：马上重新打开麦克风
+void onTtsDone(void *context)
+{
+    Serial.println("[TTS] Playback finished");
+    recorder.getCalibrator().setTrackingEnabled(true); // 回复已经播完，扬声器不再有回声，恢复跟踪噪声基底
+    followUpTurn = true;
+}
+
+// 结束本轮回复的流会话，可能同时从 websocket 回调和流控任务调用，只结束一次
+void finishTtsResponse()
+{
+    bool active;
+    portENTER_CRITICAL(&ttsLock);
+    active = ttsActive;
+    ttsActive = false;
+    portEXIT_CRITICAL(&ttsLock);
+    if (active)
+    {
+        megaphone.closeStream(ttsStream, onTtsDone);
+    }
+}
+
 void onBinaryData(const int16_t *data, size_t len)
 {
-    lastFeedTime = millis(); // 更新看门狗时间
+    // 被打断的回复还在陆续到达，直接丢弃
+    if (!megaphone.isStreamValid(ttsStream))
+        return;
+    if (thinkingStream >= 0) // 回复到了，停掉思考音
+    {
+        megaphone.releaseStream(thinkingStream);
+        thinkingStream = -1;
+    }
+    lastFeedTime = millis();
+    ttsActive = true;
 
     if (start_task == 0)
     {
         start_task = 1;
     }
-    Serial.println("bufferFree: " + String(megaphone.getBufferFree()));
-    megaphone.queuePCM(data, 1024);
-    megaphone.queuePCM(data + 1024, 1024);
-    megaphone.queuePCM(data + 2048, 1024);
-    megaphone.queuePCM(data + 3072, 1024);
+    Serial.println("bufferedMs: " + String(megaphone.getBufferedMs()));
+    // 缓冲满时 writeStream 只写入放得下的部分，剩余的等播放腾出空间再写；
+    // 等太久(播放暂停)或回复被打断时丢弃剩余部分
+    size_t samples = len / sizeof(int16_t); // len 是字节数
+    size_t accepted = 0;
+    unsigned long waitStart = millis();
+    while (accepted < samples && megaphone.isStreamValid(ttsStream))
+    {
+        size_t n = megaphone.writeStream(ttsStream, data + accepted, samples - accepted);
+        if (n > 0)
+        {
+            ttsCache.record(data + accepted, n); // 只缓存真正写进播放缓冲的数据
+            accepted += n;
+            waitStart = millis();
+            continue;
+        }
+        if (millis() - waitStart > TTS_WRITE_TIMEOUT_MS)
+            break;
+        vTaskDelay(pdMS_TO_TICKS(5));
+    }
+    if (accepted < samples)
+    {
+        Serial.printf("[TTS] Dropped %u samples\n", (unsigned)(samples - accepted));
+        ttsCache.abortRecord(); // 回复不完整，不缓存
+    }
 
-    if (megaphone.getBufferFree() < 30)
+    if (megaphone.getBufferedMs() > FLOW_HIGH_WATER_MS)
     {
         vTaskDelay(10);
     }
@@ -50,18 +160,51 @@ void onBinaryData(const int16_t *data, size_t len)
     // llmClient.sendRequest("ok"); // 这里一定不能删除，否则会导致数据包不足，后续数据包无法补充就会卡顿
 }
 
-// 创建一个任务确保queue有20个数据包
+// 服务端的文本帧除了回复结束，还可能是状态、中间识别结果等，只有结束消息才结束本轮回复
+bool isEndOfResponse(const String &message)
+{
+    String text = message;
+    text.trim();
+    if (text == LLM_END_MESSAGE)
+        return true;
+    if (!text.startsWith("{"))
+        return false;
+    JsonDocument doc;
+    if (deserializeJson(doc, text))
+        return false;
+    const char *type = doc["type"];
+    return type && strcmp(type, LLM_END_MESSAGE) == 0;
+}
+
+void onTextMessage(const String &message)
+{
+    if (!isEndOfResponse(message))
+    {
+        Serial.println("[LLM] Ignored: " + message);
+        return;
+    }
+    Serial.println("[LLM] End of response");
+    ttsCache.commitRecord(); // 收到结束消息才算完整的回复
+    finishTtsResponse();
+}
+
+// 创建一个任务确保缓冲区有足够的数据
 void task(void *pvParameters)
 {
     while (1)
     {
-        size_t bufferFree_task = megaphone.getBufferFree();
-        // Serial.println("bufferFree_task: " + String(bufferFree_task));
-        if (bufferFree_task > 30)
+        // 按实际缓冲的毫秒数(缓冲区 + DMA)做流控，而不是猜块数
+        if (megaphone.getBufferedMs() < FLOW_HIGH_WATER_MS)
         {
             llmClient.sendRequest("ok");
             vTaskDelay(100 / portTICK_PERIOD_MS);
         }
+        // 服务端没有发结束消息时的兜底
+        if (ttsActive && millis() - lastFeedTime > RESPONSE_IDLE_TIMEOUT)
+        {
+            ttsCache.abortRecord(); // 不确定回复是否完整，不缓存
+            finishTtsResponse();
+        }
         vTaskDelay(1);
         // if (send_exit == 1)
         // {
@@ -71,25 +214,6 @@ void task(void *pvParameters)
     }
 }
 
-// 看门狗任务
-void watchdogTask(void *pvParameters)
-{
-    while (1)
-    {
-        unsigned long currentTime = millis();
-        if ((currentTime - lastFeedTime) > WATCHDOG_TIMEOUT)
-        {
-            Serial.println("Watchdog timeout! Closing WebSocket...");
-            // llmClient.close();          // 关闭 WebSocket 连接
-
-            megaphone.startWriterTask(); // 重新启动播放任务    看门狗读取队列的数据防止在回调函数卡死
-            vTaskDelete(NULL);          // 删除看门狗任务
-        }
-        vTaskDelay(500 / portTICK_PERIOD_MS); // 每 500ms 检查一次
-
-    }
-}
-
 void onEvent(LLMWebsocketEvent event, const String &eventData)
 {
     Serial.print("Event: ");
@@ -117,7 +241,12 @@ void myMessageCallback(const String &recognizedText)
 {
 
     Serial.println("[STT] Recognized: " + recognizedText);
-    megaphone.startWriterTask();
+    if (recognizedText.isEmpty())
+    {
+        Serial.println("[STT] Empty result, conversation ends");
+        recorder.getCalibrator().setTrackingEnabled(true); // 没有回复要播放，回到空闲
+        return;
+    }
 
     if (send_exit == 1)
     {
@@ -125,14 +254,28 @@ void myMessageCallback(const String &recognizedText)
         send_exit = 0;
     }
     vTaskDelay(100 / portTICK_PERIOD_MS); // 要加入延时，否则会导致堵塞然后不能正常播放，反应会很慢
+    ttsStream = megaphone.primaryStream(); // 新一轮回复使用打断之后的新句柄
+
+    // 同样的问题之前完整回答过: 直接播放本地缓存，不请求服务端
+    uint64_t cacheKey = TtsCache::makeKey(recognizedText, TTS_VOICE);
+    if (ttsCache.play(cacheKey, Megaphone_PRIORITY_NORMAL, onTtsDone) >= 0)
+    {
+        Serial.println("[LLM] Cached reply: " + recognizedText);
+        ttsCache.printStats();
+        return;
+    }
+    ttsCache.beginRecord(cacheKey, TTS_SAMPLE_RATE);
+
     // 将识别结果发送给大模型服务
     if (llmClient.sendRequest(recognizedText))
     {
         Serial.println("[LLM] Request sent: " + recognizedText);
+        thinkingStream = promptCache.play(PROMPT_THINKING, Megaphone_PRIORITY_LOW, 0.5f);
     }
     else
     {
         Serial.println("[LLM] Failed to send request");
+        recorder.getCalibrator().setTrackingEnabled(true);
     }
     vTaskDelay(100 / portTICK_PERIOD_MS); // 要加入延时，否则会导致堵塞然后不能正常播放，反应会很慢
     llmClient.sendRequest("ok");
@@ -207,9 +350,20 @@ void setup()
     {
         heath++;
         Serial.println("MicRecorder 初始化成功");
+        recorder.startRecording(); // 启动后台采集，音量/VAD 由采集任务持续更新
+        recorder.calibrateNoiseFloor(1000); // 测量环境噪声基底，后续在空闲时持续跟踪
     }
 
     //  3. 初始化llmtts
+    megaphone.setDmaAutoTune(true); // DMA 越小打断越快，按实测调度抖动选最小的可用大小
+#ifdef Megaphone_CAPTURE_OUTPUT
+    megaphone.setSink(&outputSink);
+#endif
+#ifdef Megaphone_STEREO_OUTPUT
+    // 双扬声器: TTS 走左声道，提示音(高优先级流)走右声道
+    megaphone.setOutputChannels(2);
+    megaphone.setPriorityRouting(Megaphone_PRIORITY_HIGH, Megaphone_ROUTE_RIGHT);
+#endif
     if (!megaphone.begin())
     {
         Serial.println("Megaphone initialization failed!");
@@ -218,13 +372,28 @@ void setup()
     {
         heath++;
         Serial.println("Megaphone initialization success!");
+        earconStream = megaphone.openStream(Megaphone_PRIORITY_HIGH);
+        ttsStream = megaphone.primaryStream();
+        megaphone.setStreamFormat(ttsStream, TTS_SAMPLE_RATE);
+#ifdef Megaphone_STEREO_OUTPUT
+        megaphone.setStreamRouting(ttsStream, Megaphone_ROUTE_LEFT);
+#endif
+        if (SPIFFS.begin(true))
+        {
+            promptCache.begin(PROMPT_MANIFEST, sizeof(PROMPT_MANIFEST) / sizeof(PROMPT_MANIFEST[0]));
+            ttsCache.begin();
+#ifdef Megaphone_CAPTURE_OUTPUT
+            outputSink.start("/playback.wav", "/playback.csv");
+#endif
+        }
     }
 
-    megaphone.startWriterTask(); // 启动写入任务
-    megaphone.setVolume(0.1);    // 设置音量
+    megaphone.startWriterTask(); // 后台任务在 begin() 中创建，这里开始播放
+    megaphone.setVolumeDb(-20.0f); // 设置音量(原来的 0.1 倍)，之后可以用 volumeUp/volumeDown 按档调节
 
     // 4. 初始化llmtts（）设置回调。连接到 WebSocket 服务
     llmClient.setBinaryCallback(onBinaryData);
+    llmClient.setResponseCallback(onTextMessage);
     llmClient.setEventCallback(onEvent);
     if (llmClient.connect("ws://47.108.223.146:8000/ws"))
     {
@@ -235,7 +404,7 @@ void setup()
     {
         Serial.println("WebSocket connection failed");
     }
-    lastFeedTime = millis(); // 初始化看门狗时间
+    lastFeedTime = millis();
 
     // 5. 初始化stt
     stt.setMessageCallback(myMessageCallback);
@@ -296,14 +465,6 @@ void loop()
         xTaskCreatePinnedToCore(task, "task", 4096, NULL, 5, NULL, 1);
         start_task = 2;
     }
-    // 启动看门狗任务
-    static bool watchdogStarted = false;
-    if (!watchdogStarted)
-    {
-        xTaskCreatePinnedToCore(watchdogTask, "WatchdogTask", 2048, NULL, 5, NULL, 1);
-        watchdogStarted = true;
-    }
-
     /******************stt***************** */
     // stt.poll();
 
@@ -316,23 +477,33 @@ void loop()
     // float rms = recorder.calculateRMS(buffer, samplesRead);
     // Serial.println("RMS: " + String(rms));
     int state = digitalRead(0);
+    bool followUp = followUpTurn;
 
-    if (state == LOW)
+#ifdef Megaphone_CAPTURE_OUTPUT
+    if (followUp && outputSink.isRecording())
     {
-
+        outputSink.stop(); // 第一轮回复播完，写出 WAV 和 trace
+    }
+#endif
+    if (state == LOW || followUp)
+    {
+        followUpTurn = false;
         havepeople = 6; // 如果是打断的情况下，重新计数，否则就会导致打断的情况下很快就判断为无人
 
         stripLight.setBrightness(20);
         stripLight.show_flash(100, {255, 0, 0});
         vTaskDelay(10 / portTICK_PERIOD_MS);
 
-        // megaphone.stopWriterTask(); /// 多轮对话打断的时候，不正常
-        vTaskDelay(10 / portTICK_PERIOD_MS);
-        megaphone.clearBuffer();
-        vTaskDelay(10 / portTICK_PERIOD_MS);
-        megaphone.startWriterTask(); // 防止停止任务后，队列快速堆积导致在websocket消息回调的时候堵死
+        if (!followUp) // 按键打断正在播放的回复；回复播完后的追问不需要
+        {
+            megaphone.flush(); // 旧回复的句柄立即失效，迟到的音频不会再播放；后台任务不需要重启
+            send_exit = 1;
+            ttsActive = false; // 被打断的回复不再触发追问
+            ttsCache.abortRecord(); // 被打断的回复不完整，不缓存
+        }
         Serial.println("开始录音");
-        send_exit = 1;
+        recorder.flushPCM(); // 丢弃按键之前积压的音频
+        recorder.getCalibrator().setTrackingEnabled(false); // 说话期间冻结噪声基底
 
         bool ok = stt.connect(wsUrl);
         if (!ok)
@@ -353,7 +524,7 @@ void loop()
             stt.sendAudioData((uint8_t *)buffer, samplesRead * sizeof(int16_t), false);
 
             Serial.println("RMS: " + String(rms));
-            if (rms < 30)
+            if (rms < recorder.getCalibrator().getEndOfSpeechThreshold())
             {
                 havepeople--;
                 Serial.println("检测到声音");
@@ -365,6 +536,7 @@ void loop()
                 // 关闭录音的时候，显示绿色
                 stripLight.setBrightness(20);
                 stripLight.show_flash(100, {0, 255, 0});
+                playEarcon();
                 break;
             }
         }
@@ -0,0 +1,207 @@
+#include <Arduino.h>
+#include <unity.h>
+#include <string>
+#include <vector>
+
+#include "Megaphone/Megaphone.hpp"
+#include "Megaphone/WavSink.hpp"
+#include "Megaphone/FileSource.hpp"
+
+// 主机端回放测试: 把录下的服务端 TTS(output.wav)按网络包的节奏写进主流，
+// 输出端换成 WavSink，播完后检查 trace 里有没有断流、Megaphone 有没有欠载
+
+#ifndef NativeShims_PROJECT_DIR
+#define NativeShims_PROJECT_DIR "."
+#endif
+
+#define REPLAY_STREAM_PATH   "/output.wav"   // 工程根目录下录制的服务端回复
+#define REPLAY_PACKET_MS     20              // 服务端每包的时长
+#define REPLAY_MAX_MS        3000            // 只回放开头这么长，控制测试时间
+#define REPLAY_STALL_AT_MS   1000            // 断网测试: 从这里开始停止送包
+#define REPLAY_STALL_MS      1500            // 比播放缓冲 + DMA 长，必然播空
+#define REPLAY_WRITE_TIMEOUT_MS 500
+#define REPLAY_DONE_MARGIN_MS   3000         // 送完之后等待播完的额外时间
+
+static fs::FS projectFs(NativeShims_PROJECT_DIR);
+static fs::FS outputFs(NativeShims_PROJECT_DIR "/.pio/test_output");
+
+struct TraceSummary {
+    uint32_t writes;
+    uint32_t gaps;          // gap 不为 0 的写入
+    uint32_t gapFrames;
+    uint32_t maxQueued;
+};
+
+struct ReplayResult {
+    WavSinkStats   sink;
+    MegaphoneStats player;
+    TraceSummary   trace;
+    size_t         inputFrames;   // 实际写进主流的输入帧
+    uint32_t       inputRate;
+    bool           done;          // 播放完成回调到达
+};
+
+static void onPlaybackDone(void *context)
+{
+    xSemaphoreGive((SemaphoreHandle_t)context);
+}
+
+static bool readTrace(const char *path, TraceSummary &out)
+{
+    memset(&out, 0, sizeof(out));
+    File file = outputFs.open(path, FILE_READ);
+    if (!file)
+        return false;
+    std::string text(file.size(), '\0');
+    file.read((uint8_t *)&text[0], text.size());
+    file.close();
+
+    size_t pos = text.find('\n');   // 跳过表头 us,event,frames,queued,gap
+    while (pos != std::string::npos && pos + 1 < text.size())
+    {
+        size_t next = text.find('\n', pos + 1);
+        std::string line = text.substr(pos + 1, next == std::string::npos ? std::string::npos : next - pos - 1);
+        pos = next;
+
+        unsigned us, frames, queued, gap;
+        char event;
+        if (sscanf(line.c_str(), "%u,%c,%u,%u,%u", &us, &event, &frames, &queued, &gap) != 5 || event != 'W')
+            continue;
+        out.writes++;
+        if (gap > 0)
+        {
+            out.gaps++;
+            out.gapFrames += gap;
+        }
+        if (queued > out.maxQueued)
+            out.maxQueued = queued;
+    }
+    return true;
+}
+
+/**
+ * @brief 按 REPLAY_PACKET_MS 的节奏把录音写进主流，可以在中途停一段时间模拟断网
+ */
+static ReplayResult replay(const char *name, uint32_t stallAtMs, uint32_t stallMs)
+{
+    ReplayResult result;
+    memset(&result, 0, sizeof(result));
+
+    File file = projectFs.open(REPLAY_STREAM_PATH, FILE_READ);
+    WavInfo info;
+    TEST_ASSERT_TRUE_MESSAGE((bool)file, "output.wav not found");
+    TEST_ASSERT_TRUE_MESSAGE(FileSource::readWavInfo(file, info), "output.wav is not a WAV file");
+    TEST_ASSERT_EQUAL_UINT16(16, info.bitsPerSample);
+
+    Megaphone *megaphone = new Megaphone();
+    WavSink sink(outputFs);
+    megaphone->setSink(&sink);
+    TEST_ASSERT_TRUE(megaphone->begin());
+    int stream = megaphone->primaryStream();
+    TEST_ASSERT_TRUE(megaphone->setStreamFormat(stream, info.sampleRate, (uint8_t)info.channels));
+
+    std::string wavPath = std::string("/") + name + ".wav";
+    std::string tracePath = std::string("/") + name + ".csv";
+    TEST_ASSERT_TRUE(sink.start(wavPath.c_str(), tracePath.c_str()));
+    TEST_ASSERT_TRUE(megaphone->startWriterTask());
+
+    const size_t packetFrames = info.sampleRate * REPLAY_PACKET_MS / 1000;
+    size_t totalFrames = info.dataBytes / (sizeof(int16_t) * info.channels);
+    size_t maxFrames = (size_t)((uint64_t)info.sampleRate * REPLAY_MAX_MS / 1000);
+    if (totalFrames > maxFrames)
+        totalFrames = maxFrames;
+    std::vector<int16_t> packet(packetFrames * info.channels);
+
+    // 按包的到达时间送入，不因写入耗时累积漂移；断网期间的包晚到，到达后一次补齐
+    TickType_t start = xTaskGetTickCount();
+    uint32_t packetIndex = 0;
+    size_t sent = 0;
+    while (sent < totalFrames)
+    {
+        uint32_t dueMs = packetIndex * REPLAY_PACKET_MS;
+        if (stallMs > 0 && dueMs >= stallAtMs && dueMs < stallAtMs + stallMs)
+            dueMs = stallAtMs + stallMs;
+        TickType_t due = start + pdMS_TO_TICKS(dueMs);
+        TickType_t now = xTaskGetTickCount();
+        if ((int32_t)(due - now) > 0)
+            vTaskDelay(due - now);
+
+        size_t frames = totalFrames - sent < packetFrames ? totalFrames - sent : packetFrames;
+        size_t samples = file.read((uint8_t *)packet.data(), frames * info.channels * sizeof(int16_t)) / sizeof(int16_t);
+        // 和 onBinaryData 一样: 主流只接收放得下的部分，剩下的等播放腾出空间再写
+        size_t written = 0;
+        TickType_t writeStart = xTaskGetTickCount();
+        while (written < samples &&
+               xTaskGetTickCount() - writeStart < pdMS_TO_TICKS(REPLAY_WRITE_TIMEOUT_MS))
+        {
+            written += megaphone->writeStream(stream, packet.data() + written, samples - written);
+            if (written < samples)
+                vTaskDelay(pdMS_TO_TICKS(5));
+        }
+        TEST_ASSERT_EQUAL_MESSAGE(samples, written, "primary stream did not accept a packet");
+        sent += frames;
+        packetIndex++;
+    }
+    file.close();
+    result.inputFrames = sent;
+    result.inputRate = info.sampleRate;
+
+    SemaphoreHandle_t doneSem = xSemaphoreCreateBinary();
+    TEST_ASSERT_TRUE(megaphone->closeStream(stream, onPlaybackDone, doneSem));
+    uint32_t playMs = (uint32_t)((uint64_t)sent * 1000 / info.sampleRate);
+    result.done = xSemaphoreTake(doneSem, pdMS_TO_TICKS(playMs + REPLAY_DONE_MARGIN_MS)) == pdTRUE;
+
+    result.player = megaphone->getStats();
+    delete megaphone;   // 先停掉后台任务，sink 不再被写入
+    sink.stop();
+    result.sink = sink.getStats();
+    vSemaphoreDelete(doneSem);
+    TEST_ASSERT_TRUE_MESSAGE(readTrace(tracePath.c_str(), result.trace), "trace was not written");
+    return result;
+}
+
+// ------------ 用例 ------------
+void test_replay_plays_without_gaps()
+{
+    ReplayResult r = replay("replay", 0, 0);
+
+    TEST_ASSERT_TRUE_MESSAGE(r.done, "playback callback did not fire");
+    TEST_ASSERT_EQUAL_UINT32(0, r.player.underruns);
+    TEST_ASSERT_EQUAL_UINT32(0, r.player.overruns);
+    TEST_ASSERT_EQUAL_UINT32(0, r.sink.gaps);
+    TEST_ASSERT_EQUAL_UINT32(0, r.trace.gaps);
+    TEST_ASSERT_EQUAL_UINT32(r.sink.writes, r.trace.writes);
+    TEST_ASSERT_EQUAL_UINT32(0, r.sink.traceDropped);
+    TEST_ASSERT_EQUAL_UINT32(0, r.sink.wavDropped);
+
+    // 重采样到 16kHz 后的长度，允许滤波器延迟和最后一块的差别
+    uint64_t expected = (uint64_t)r.inputFrames * Megaphone_DEFAULT_SAMPLE_RATE / r.inputRate;
+    TEST_ASSERT_TRUE_MESSAGE(r.sink.frames + Megaphone_WRITE_BLOCK_SAMPLES >= expected, "audio went missing");
+
+    // 写入时缓冲中的音频不超过 DMA 容量，即输出延迟有上限
+    TEST_ASSERT_LESS_OR_EQUAL_UINT32(r.player.dmaLatencyMs, r.sink.maxQueuedMs);
+}
+
+void test_stalled_stream_is_reported()
+{
+    ReplayResult r = replay("replay_stall", REPLAY_STALL_AT_MS, REPLAY_STALL_MS);
+
+    TEST_ASSERT_TRUE_MESSAGE(r.done, "playback callback did not fire");
+    // 断网超过缓冲时长: 播放端必须报告欠载，trace 里能看到扬声器断流
+    TEST_ASSERT_GREATER_OR_EQUAL_UINT32(1, r.player.underruns);
+    TEST_ASSERT_GREATER_OR_EQUAL_UINT32(1, r.trace.gaps);
+    TEST_ASSERT_EQUAL_UINT32(r.sink.gaps, r.trace.gaps);
+}
+
+void setUp() {}
+void tearDown() {}
+
+int main(int argc, char **argv)
+{
+    (void)argc;
+    (void)argv;
+    UNITY_BEGIN();
+    RUN_TEST(test_replay_plays_without_gaps);
+    RUN_TEST(test_stalled_stream_is_reported);
+    return UNITY_END();
+}